@@ -0,0 +1,13 @@
+// only the changed parameters are submitted, the inputs get their names when their value differs from the rendered one
+document.addEventListener('change', function(e)
+{
+	var input = e.target;
+	if (!input.id)
+		return;
+
+	var changed = (input.tagName == 'SELECT') ? !input.options[input.selectedIndex].defaultSelected : input.value != input.defaultValue;
+	if (changed)
+		input.name = input.id;
+	else
+		input.removeAttribute('name');
+});
@@ -0,0 +1,160 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "analyzer.h"
+
+void T4Analyzer::init()
+{
+	m_mutex = createMutex(m_mutexBuffer);
+}
+
+void T4Analyzer::onByte()
+{
+	// only the UART task touches the pending count, it's published with the frame or error ending the bytes
+	m_pendingBytes++;
+}
+
+void T4Analyzer::publishBytes(uint32_t now)
+{
+	m_total.bytes += m_pendingBytes;
+	m_window.at(now).bytes += m_pendingBytes;
+	m_pendingBytes = 0;
+}
+
+void T4Analyzer::onFrame(const T4Packet& packet, uint32_t start, uint32_t end)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	uint32_t now = millis() / 1000;
+
+	publishBytes(now);
+	m_total.frames++;
+	m_window.at(now).frames++;
+
+	// gap between end of the previous frame and start of this one
+	if (m_lastEndValid)
+	{
+		uint32_t gap = start - m_lastEnd;
+		m_gapMin = std::min(m_gapMin, gap);
+		m_gapMax = std::max(m_gapMax, gap);
+		m_gaps[std::min<size_t>(std::bit_width(gap / 1000), T4AnalyzerGapBuckets - 1)]++;
+	}
+	m_lastEnd = end;
+	m_lastEndValid = true;
+
+	// frames per source, there are only a few devices on the bus, so linear search is fine
+	const T4Source& from = packet.header.from;
+	size_t n = 0;
+	while (n < m_sourcesCount && !(m_sources[n].source == from))
+		++n;
+	if (n == m_sourcesCount && m_sourcesCount < std::size(m_sources))
+		m_sources[m_sourcesCount++].source = from;
+	if (n < m_sourcesCount)
+	{
+		m_sources[n].total++;
+		m_sources[n].recent.at(now)++;
+	}
+
+	// frames per device and command
+	uint16_t key = (packet.message.device << 8) | packet.message.command;
+	bool counted = false;
+	size_t slot = ((packet.message.device * 31) ^ packet.message.command) % std::size(m_commands);
+	for (size_t probe = 0; probe < std::size(m_commands); ++probe, slot = (slot + 1) % std::size(m_commands))
+	{
+		auto& command = m_commands[slot];
+		if (!command.used)
+		{
+			if (m_commandsCount >= std::size(m_commands) * 3 / 4)
+				// keep the table sparse enough to have short probes
+				break;
+
+			command.used = true;
+			command.key = key;
+			m_commandsCount++;
+		}
+
+		if (command.key == key)
+		{
+			command.total++;
+			command.recent.at(now)++;
+			counted = true;
+			break;
+		}
+	}
+	if (!counted)
+		m_otherCommands++;
+
+	xSemaphoreGive(m_mutex);
+}
+
+void T4Analyzer::onError(T4AnalyzerError error)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	uint32_t now = millis() / 1000;
+
+	publishBytes(now);
+	m_total.errors++;
+	m_window.at(now).errors++;
+	m_errors[error]++;
+
+	xSemaphoreGive(m_mutex);
+}
+
+void T4Analyzer::getSnapshot(T4AnalyzerSnapshot& snapshot)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	uint32_t now = millis() / 1000;
+
+	snapshot.seconds = now;
+	snapshot.total = m_total;
+
+	m_window.at(now);
+	for (size_t n = 0; n < std::size(T4AnalyzerWindows); ++n)
+		snapshot.windows[n] = m_window.sum(T4AnalyzerWindows[n]);
+
+	memcpy(snapshot.errors, m_errors, sizeof(m_errors));
+	memcpy(snapshot.gaps, m_gaps, sizeof(m_gaps));
+	snapshot.gapMin = (m_gapMin != UINT32_MAX) ? m_gapMin : 0;
+	snapshot.gapMax = m_gapMax;
+
+	snapshot.sourcesCount = m_sourcesCount;
+	for (size_t n = 0; n < m_sourcesCount; ++n)
+	{
+		m_sources[n].recent.at(now);
+		snapshot.sources[n] = { m_sources[n].source, m_sources[n].total, m_sources[n].recent.sum(T4AnalyzerRateWindow) };
+	}
+
+	snapshot.commandsCount = 0;
+	for (auto& command : m_commands)
+	{
+		if (!command.used)
+			continue;
+
+		command.recent.at(now);
+		snapshot.commands[snapshot.commandsCount++] = { uint8_t(command.key >> 8), uint8_t(command.key), command.total, command.recent.sum(T4AnalyzerRateWindow) };
+	}
+	snapshot.otherCommands = m_otherCommands;
+
+	xSemaphoreGive(m_mutex);
+
+	// the most frequent commands first
+	std::sort(snapshot.commands, snapshot.commands + snapshot.commandsCount, [](const auto& a, const auto& b) { return a.total > b.total; });
+}
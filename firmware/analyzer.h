@@ -0,0 +1,164 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include <Arduino.h>
+
+#include "t4.h"
+
+enum T4AnalyzerError : uint8_t
+{
+	FRAMING_ERROR = 0,
+	CHECKSUM_ERROR = 1,
+	TIMEOUT_ERROR = 2,
+};
+
+struct T4AnalyzerCounters
+{
+	uint32_t bytes = 0;
+	uint32_t frames = 0;
+	uint32_t errors = 0;
+
+	T4AnalyzerCounters& operator+=(const T4AnalyzerCounters& other)
+	{
+		bytes += other.bytes;
+		frames += other.frames;
+		errors += other.errors;
+		return *this;
+	}
+};
+
+// per-second counters of the last N seconds, rolled lazily when touched
+template <typename T, size_t N>
+struct T4AnalyzerRing
+{
+	uint32_t second = 0;
+	T slots[N] = {};
+
+	T& at(uint32_t now)
+	{
+		if (now - second >= N)
+			std::fill(std::begin(slots), std::end(slots), T());
+		else
+			while (second != now)
+				slots[++second % N] = T();
+
+		second = now;
+		return slots[now % N];
+	}
+
+	// sum of the last n complete seconds, ring must be rolled to the current second
+	T sum(size_t n) const
+	{
+		T total = T();
+		for (size_t k = 1; k <= n && k <= second; ++k)
+			total += slots[(second - k) % N];
+		return total;
+	}
+};
+
+constexpr size_t T4AnalyzerWindows[] = { 1, 10, 60 };
+constexpr size_t T4AnalyzerRateWindow = 10;
+constexpr size_t T4AnalyzerGapBuckets = 11;
+constexpr size_t T4AnalyzerSources = 8;
+constexpr size_t T4AnalyzerCommands = 32;
+
+struct T4AnalyzerSnapshot
+{
+	uint32_t seconds = 0;
+
+	T4AnalyzerCounters total;
+	T4AnalyzerCounters windows[std::size(T4AnalyzerWindows)];
+	uint32_t errors[3] = {};
+
+	// inter-frame gaps in power of two buckets of milliseconds (<1, 1-2, 2-4 ... >=512); bytes are timestamped when
+	// the UART task reads them from the driver, which is up to 2 ms (the idle yield of the task) after they arrive
+	uint32_t gaps[T4AnalyzerGapBuckets] = {};
+	uint32_t gapMin = 0;
+	uint32_t gapMax = 0;
+
+	struct
+	{
+		T4Source source;
+		uint32_t total;
+		uint32_t recent;
+	} sources[T4AnalyzerSources] = {};
+	size_t sourcesCount = 0;
+
+	struct
+	{
+		uint8_t device;
+		uint8_t command;
+		uint32_t total;
+		uint32_t recent;
+	} commands[T4AnalyzerCommands] = {};
+	size_t commandsCount = 0;
+	uint32_t otherCommands = 0;
+};
+
+class T4Analyzer
+{
+public:
+	void init();
+
+	// called from T4Client::uartTask, all of them are O(1), the mutex is taken once per frame or error, not per byte
+	void onByte();
+	void onFrame(const T4Packet& packet, uint32_t start, uint32_t end);
+	void onError(T4AnalyzerError error);
+
+	void getSnapshot(T4AnalyzerSnapshot& snapshot);
+
+private:
+	void publishBytes(uint32_t now);
+
+	SemaphoreHandle_t m_mutex = nullptr;
+	MutexBuffer m_mutexBuffer;
+
+	uint32_t m_pendingBytes = 0;
+
+	T4AnalyzerCounters m_total;
+	T4AnalyzerRing<T4AnalyzerCounters, 61> m_window;
+	uint32_t m_errors[3] = {};
+
+	uint32_t m_lastEnd = 0;
+	bool m_lastEndValid = false;
+	uint32_t m_gaps[T4AnalyzerGapBuckets] = {};
+	uint32_t m_gapMin = UINT32_MAX;
+	uint32_t m_gapMax = 0;
+
+	struct
+	{
+		T4Source source;
+		uint32_t total;
+		T4AnalyzerRing<uint32_t, T4AnalyzerRateWindow + 1> recent;
+	} m_sources[T4AnalyzerSources] = {};
+	size_t m_sourcesCount = 0;
+
+	// open addressing hash table keyed by device and command
+	struct
+	{
+		uint16_t key;
+		bool used;
+		uint32_t total;
+		T4AnalyzerRing<uint32_t, T4AnalyzerRateWindow + 1> recent;
+	} m_commands[T4AnalyzerCommands] = {};
+	size_t m_commandsCount = 0;
+	uint32_t m_otherCommands = 0;
+};
+
+#endif
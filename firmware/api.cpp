@@ -0,0 +1,789 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "api.h"
+#include "web.h"
+#include "webstream.h"
+#include "decode.h"
+#include "apply.h"
+#include "backup.h"
+#include "wireless.h"
+#include "watchdog.h"
+#include "t4.h"
+
+extern T4Client t4;
+extern T4Watchdog watchdog;
+
+void apiError(HttpRequest& request, int code, const char* error)
+{
+	WebStream stream(request, "api");
+	stream.begin(code, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject().string("error", error).endObject();
+}
+
+void apiApplyResults(HttpRequest& request, const char* page, bool success, const T4ApplyWrite* writes, size_t count)
+{
+	WebStream stream(request, page);
+	stream.begin(success ? 200 : 502, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject();
+	json.boolean("success", success);
+	json.beginArray("results");
+	for (auto write = writes; write < writes + count; ++write)
+		json.beginObject().number("id", write->command).number("value", write->value).number("previous", write->previous).string("result", getApplyResultString(write->result)).endObject();
+	json.endArray();
+	json.endObject();
+}
+
+class JsonFieldSink : public T4FieldSink
+{
+public:
+	JsonFieldSink(JsonWriter& json) : m_json(json) {}
+
+	void onField(const T4Field& field) override
+	{
+		m_json.beginObject();
+		m_json.string("label", field.label);
+		m_json.number("value", field.value);
+		if (field.scale != 1)
+			m_json.number("scale", field.scale);
+		if (field.text)
+			m_json.string("text", field.text);
+		if (field.unit)
+			m_json.string("unit", field.unit);
+		m_json.endObject();
+	}
+
+private:
+	JsonWriter& m_json;
+};
+
+// gauges in Prometheus text format, labelled by the block and the field
+class MetricsFieldSink : public T4FieldSink
+{
+public:
+	MetricsFieldSink(WebStream& stream, const char* metric, const char* block) : m_stream(stream), m_metric(metric), m_block(block) {}
+
+	void onField(const T4Field& field) override
+	{
+		m_stream += m_metric;
+		m_stream += "{block=\"";
+		m_stream += m_block;
+		m_stream += "\",label=\"";
+		m_stream += field.label;
+		if (field.unit)
+		{
+			m_stream += "\",unit=\"";
+			m_stream += field.unit;
+		}
+		m_stream += "\"} ";
+		if (field.scale != 1)
+			m_stream += String(float(field.value) / field.scale, 2);
+		else
+			m_stream += String(field.value);
+		m_stream += '\n';
+	}
+
+private:
+	WebStream& m_stream;
+	const char* m_metric;
+	const char* m_block;
+};
+
+bool apiParameter(JsonWriter& json, const T4Unit& unit, uint8_t command, const uint8_t* commandInfo)
+{
+	T4Packet reply;
+	uint8_t message[5] = { CONTROLLER, command, REQ|GET|ACK|FIN, 0x00, 0x00 };
+	bool reply_ok = t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3);
+
+	json.beginObject();
+	json.number("id", command);
+	json.string("name", T4MenuStrings[command]);
+
+	if (!reply_ok)
+	{
+		json.null("value");
+	}
+	else if (commandInfo[1] == 0x03)
+	{
+		json.string("value", (const char*)&reply.message.dmp.data[1]);
+	}
+	else
+	{
+		auto parameter = getParameter(commandInfo);
+		uint64_t value = decodeParameter(commandInfo, reply);
+		json.number("value", value);
+
+		if (parameter.kind == PARAMETER_LIST)
+		{
+			if (auto text = parameter.getString(value))
+				json.string("text", text);
+		}
+		else if (parameter.max)
+		{
+			json.number("min", parameter.min).number("max", parameter.max);
+			if (parameter.step)
+				json.number("step", parameter.step);
+		}
+
+		if (parameter.unit)
+			json.string("unit", parameter.unit);
+	}
+
+	json.endObject();
+	return reply_ok;
+}
+
+void api_status(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	T4Packet position_reply;
+	T4Packet status_reply;
+
+	// CTRL_POSITION_CURRENT(0x11)
+	uint8_t message[5] = { CONTROLLER, 0x11, REQ|GET|ACK|FIN, 0x00, 0x00 };
+	bool position_ok = t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &position_reply, 3);
+
+	// CTRL_AUTOMATION_STATUS(0x01)
+	message[1] = 0x01;
+	bool status_ok = t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &status_reply, 3);
+
+	T4Source source = unit.source;
+
+	t4.unlockUnit();
+
+	if (!status_ok)
+		return apiError(request, 504, "No reply from unit");
+
+	WebStream stream(request, "api/status");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject();
+	json.beginObject("unit").number("address", source.address).number("endpoint", source.endpoint).endObject();
+	if (position_ok)
+		json.number("position", (position_reply.message.dmp.data[0] << 8) | position_reply.message.dmp.data[1]);
+	else
+		json.null("position");
+	json.beginArray("fields");
+	JsonFieldSink sink(json);
+	decodeStatus(status_reply, sink);
+	json.endArray();
+	json.endObject();
+}
+
+void api_log(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	// CTRL_LOG_8_MANEUVERS(0xDA)
+	T4Packet reply;
+	uint8_t message[5] = { CONTROLLER, 0xDA, REQ|GET|ACK|FIN, 0x00, 0x00 };
+	bool reply_ok = t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3);
+
+	t4.unlockUnit();
+
+	if (!reply_ok)
+		return apiError(request, 504, "No reply from unit");
+
+	WebStream stream(request, "api/log");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject().beginArray("log");
+	for (size_t n = 0; n < 8; ++n)
+	{
+		auto log = reply.message.dmp.data[n];
+		json.beginObject().number("value", log).string("text", getManoeuvreStatusString(log)).endObject();
+	}
+	json.endArray().endObject();
+}
+
+void api_diagnostics(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	auto root = request.pathArg(0).toInt();
+	if (root <= 0 || root > 0xFF)
+		return apiError(request, 400, "Invalid diagnostics id");
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	auto command_info = unit.commandsInfo[root].get();
+	auto block = command_info ? getDiagnosticsBlock(command_info) : nullptr;
+	if (!block)
+	{
+		t4.unlockUnit();
+		return apiError(request, 404, "Diagnostics not supported");
+	}
+
+	T4Packet reply;
+	uint8_t message[5] = { CONTROLLER, uint8_t(root), REQ|GET|ACK|FIN, 0x00, 0x00 };
+	if (!t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3))
+	{
+		t4.unlockUnit();
+		return apiError(request, 504, "No reply from unit");
+	}
+
+	WebStream stream(request, "api/diagnostics");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject();
+	json.number("id", root);
+	json.string("title", block->title);
+	json.beginArray("fields");
+	JsonFieldSink sink(json);
+	decodeDiagnostics(*block, command_info, reply, sink);
+	json.endArray();
+	json.endObject();
+
+	t4.unlockUnit();
+}
+
+void api_parameters(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	WebStream stream(request, "api/parameters");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginArray();
+	for (auto menu_item : unit.menu)
+	{
+		uint8_t command = (menu_item >> 8);
+		if (auto command_info = getParameterInfo(unit, command))
+		{
+			// parameters read so far are sent while waiting for the reply
+			stream.flush();
+			apiParameter(json, unit, command, command_info);
+		}
+	}
+	json.endArray();
+
+	t4.unlockUnit();
+}
+
+void api_parameter_get(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	auto command = request.pathArg(0).toInt();
+	if (command <= 0 || command > 0xFF)
+		return apiError(request, 400, "Invalid parameter id");
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	auto command_info = getParameterInfo(unit, command);
+	if (!command_info)
+	{
+		t4.unlockUnit();
+		return apiError(request, 404, "Unknown parameter");
+	}
+
+	WebStream stream(request, "api/parameter");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	apiParameter(json, unit, command, command_info);
+
+	t4.unlockUnit();
+}
+
+void api_parameter_put(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	auto command = request.pathArg(0).toInt();
+	if (command <= 0 || command > 0xFF)
+		return apiError(request, 400, "Invalid parameter id");
+
+	// value is passed either as an argument, or in JSON body {"value":N}
+	long long value = 0;
+	bool value_ok = false;
+	if (request.hasArg("value"))
+	{
+		auto argument = request.arg("value");
+		char* number_end;
+		value = strtoll(argument.c_str(), &number_end, 10);
+		value_ok = (number_end != argument.c_str() && !*number_end);
+	}
+	else if (request.hasArg("plain"))
+	{
+		auto body = request.arg("plain");
+		JsonReader reader(body.c_str());
+		char key[8];
+		while (reader.nextKey(key, sizeof(key)))
+		{
+			if (strcmp(key, "value"))
+				reader.skip();
+			else
+				value_ok = reader.integer(value);
+		}
+		if (!reader.valid())
+			return apiError(request, 400, "Invalid JSON");
+	}
+
+	if (!value_ok)
+		return apiError(request, 400, "Missing value");
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	auto command_info = getParameterInfo(unit, command);
+	if (!command_info)
+	{
+		t4.unlockUnit();
+		return apiError(request, 404, "Unknown parameter");
+	}
+
+	// invalid values are rejected without touching the bus
+	auto error = (value < 0) ? PARAMETER_BELOW_MIN : validateParameter(getParameter(command_info), value);
+	if (error != PARAMETER_VALID)
+	{
+		t4.unlockUnit();
+		return apiError(request, 422, getParameterErrorString(error));
+	}
+
+	// the value is written only if it differs from the current one, and verified by read-back
+	T4ApplyWrite write = { uint8_t(command), uint64_t(value) };
+	applyParameters(t4, unit, &write, 1, false);
+
+	if (write.result == APPLY_NO_REPLY || write.result == APPLY_MISMATCH)
+	{
+		t4.unlockUnit();
+		return apiError(request, (write.result == APPLY_NO_REPLY) ? 504 : 422, getApplyResultString(write.result));
+	}
+
+	// reply with the value read back from the unit
+	WebStream stream(request, "api/parameter");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	apiParameter(json, unit, command, command_info);
+
+	t4.unlockUnit();
+}
+
+void api_parameters_apply(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	T4ApplyWrite writes[T4ApplyMaxWrites];
+	size_t writes_count = 0;
+
+	// parameters are passed either as arguments pN=value, or in JSON body {"N":value, ...}
+	auto add = [&](long command, long long value)
+	{
+		auto command_info = getParameterInfo(unit, command);
+		auto error = !command_info ? PARAMETER_READ_ONLY : (value < 0) ? PARAMETER_BELOW_MIN : validateParameter(getParameter(command_info), value);
+		if (error != PARAMETER_VALID || writes_count == std::size(writes))
+		{
+			t4.unlockUnit();
+			apiError(request, 422, (error != PARAMETER_VALID) ? getParameterErrorString(error) : "Too many parameters");
+			return false;
+		}
+
+		writes[writes_count++] = { uint8_t(command), uint64_t(value) };
+		return true;
+	};
+
+	if (request.hasArg("plain"))
+	{
+		auto body = request.arg("plain");
+		JsonReader reader(body.c_str());
+		char key[8];
+		while (reader.nextKey(key, sizeof(key)))
+		{
+			char* number_end;
+			auto command = strtol(key, &number_end, 10);
+			long long value;
+			if (command <= 0 || command > 0xFF || *number_end || !reader.integer(value))
+				break;
+			if (!add(command, value))
+				return;
+		}
+		if (!reader.valid())
+		{
+			t4.unlockUnit();
+			return apiError(request, 400, "Invalid JSON");
+		}
+	}
+
+	for (size_t n = 0; n < request.args(); ++n)
+	{
+		auto arg_name = request.argName(n);
+		if (arg_name[0] != 'p')
+			continue;
+		char* number_end;
+		auto command = strtol(arg_name.c_str() + 1, &number_end, 10);
+		if (!command || command > 0xFF || *number_end)
+			continue;
+
+		if (!add(command, request.arg(n).toInt()))
+			return;
+	}
+
+	bool success = applyParameters(t4, unit, writes, writes_count, request.hasArg("rollback"));
+
+	t4.unlockUnit();
+
+	apiApplyResults(request, "api/parameters", success, writes, writes_count);
+}
+
+void api_backup(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	std::vector<uint8_t> image;
+	auto error = createBackup(t4, t4.getUnit(), image);
+
+	t4.unlockUnit();
+
+	if (error != BACKUP_OK)
+		return apiError(request, (error == BACKUP_NO_REPLY) ? 504 : (error == BACKUP_INVALID_REPLY) ? 502 : 500, getBackupErrorString(error));
+
+	request.sendHeader("Content-Disposition", "attachment; filename=\"t4-backup.bin\"");
+	request.send(200, "application/octet-stream", (const char*)image.data(), image.size());
+}
+
+void api_restore(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	auto image = request.arg("plain");
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	std::vector<T4ApplyWrite> writes;
+	auto error = parseBackup(t4, unit, (const uint8_t*)image.c_str(), image.length(), request.hasArg("force"), writes);
+	if (error != BACKUP_OK)
+	{
+		t4.unlockUnit();
+		return apiError(request, (error == BACKUP_NO_REPLY) ? 504 : (error == BACKUP_AUTOMATION_TYPE) ? 409 : 422, getBackupErrorString(error));
+	}
+
+	// only parameters differing from the unit are written
+	bool success = applyParameters(t4, unit, writes.data(), writes.size(), request.hasArg("rollback"));
+
+	t4.unlockUnit();
+
+	apiApplyResults(request, "api/restore", success, writes.data(), writes.size());
+}
+
+void api_commands(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	WebStream stream(request, "api/commands");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginArray();
+	for (auto command : unit.commands)
+		json.beginObject().number("id", command).string("name", command < std::size(T4CommandStrings) ? T4CommandStrings[command] : nullptr).endObject();
+	json.endArray();
+
+	t4.unlockUnit();
+}
+
+void api_command_execute(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	auto command = request.pathArg(0).toInt();
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	if (command <= 0 || command > 0xFF || std::find(unit.commands.begin(), unit.commands.end(), command) == unit.commands.end())
+	{
+		t4.unlockUnit();
+		return apiError(request, 404, "Unknown command");
+	}
+
+	// send DEP packet to execute the command
+	uint8_t message[4] = { OVIEW, 0x82, uint8_t(command), 100 };
+	T4Packet packet(0x55, unit.source, T4ThisAddress, 1, message, sizeof(message));
+	t4.send(packet);
+
+	t4.unlockUnit();
+
+	WebStream stream(request, "api/command");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject().number("id", command).boolean("sent", true).endObject();
+}
+
+void api_metrics(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	if (!t4.lockUnit())
+		return apiError(request, 503, "Unit is busy");
+
+	auto& unit = t4.getUnit();
+
+	WebStream stream(request, "api/metrics");
+	stream.begin(200, "text/plain; version=0.0.4");
+
+	// CTRL_AUTOMATION_STATUS(0x01)
+	T4Packet reply;
+	uint8_t message[5] = { CONTROLLER, 0x01, REQ|GET|ACK|FIN, 0x00, 0x00 };
+	if (t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3))
+	{
+		stream += "# TYPE t4_status gauge\n";
+		MetricsFieldSink sink(stream, "t4_status", "Status");
+		decodeStatus(reply, sink);
+	}
+
+	stream += "# TYPE t4_diagnostics gauge\n";
+	for (size_t command = 0; command < std::size(unit.commandsInfo); ++command)
+	{
+		auto command_info = unit.commandsInfo[command].get();
+		auto block = command_info ? getDiagnosticsBlock(command_info) : nullptr;
+		if (!block)
+			continue;
+
+		message[1] = command;
+		if (!t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3))
+			continue;
+
+		MetricsFieldSink sink(stream, "t4_diagnostics", block->title);
+		decodeDiagnostics(*block, command_info, reply, sink);
+	}
+
+	t4.unlockUnit();
+}
+
+void apiWifiProfile(HttpRequest& request)
+{
+	auto profile = getWifiPowerProfile();
+
+	WebStream stream(request, "api/wifi");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject();
+	json.string("powerSave", getWifiPowerSaveString(profile.mode));
+	json.number("listenInterval", profile.listenInterval);
+	json.number("current", estimateWifiCurrent(profile));
+	json.endObject();
+}
+
+void api_wifi_get(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	apiWifiProfile(request);
+}
+
+void api_wifi_put(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	auto profile = getWifiPowerProfile();
+	if (request.hasArg("powerSave") && !parseWifiPowerSave(request.arg("powerSave"), profile.mode))
+		return apiError(request, 400, "Invalid power save mode");
+	if (request.hasArg("listenInterval"))
+		profile.listenInterval = std::clamp<long>(request.arg("listenInterval").toInt(), 0, 0xFF);
+
+	if (!setWifiPowerProfile(profile))
+		return apiError(request, 422, "Invalid listen interval");
+
+	apiWifiProfile(request);
+}
+
+void api_latency(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	T4LatencyStats stats;
+	t4.getLatencyStats(stats);
+	if (request.arg("reset") == "1")
+		t4.resetLatencyStats();
+
+	WebStream stream(request, "api/latency");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject();
+	json.number("frames", stats.frames);
+	json.number("latency50", stats.latency50);
+	json.number("latency99", stats.latency99);
+	json.number("latencyMax", stats.latencyMax);
+	json.endObject();
+}
+
+void api_memory(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	TaskStats tasks[MaxTasks];
+	size_t count = getTaskStats(tasks, MaxTasks);
+
+	WebStream stream(request, "api/memory");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject();
+	json.boolean("static", STATIC_ALLOCATION);
+	json.number("freeHeap", ESP.getFreeHeap());
+	json.number("minFreeHeap", ESP.getMinFreeHeap());
+	json.number("maxAllocHeap", ESP.getMaxAllocHeap());
+	json.beginArray("tasks");
+	for (auto task = tasks; task < tasks + count; ++task)
+		json.beginObject().string("name", task->name).number("stack", task->stackSize).number("stackFree", task->stackFree).endObject();
+	json.endArray();
+	json.endObject();
+}
+
+void api_watchdog(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WatchdogStats stats;
+	watchdog.getStats(stats);
+
+	WatchdogBreach breaches[WatchdogBreaches];
+	size_t count = watchdog.getBreaches(breaches, WatchdogBreaches);
+
+	T4Health health;
+	t4.getHealth(health);
+
+	WebStream stream(request, "api/watchdog");
+	stream.begin(200, "application/json");
+
+	JsonWriter json(stream);
+	json.beginObject();
+	json.number("rxDropped", health.rxDropped);
+	json.beginArray("objectives");
+	for (size_t slo = 0; slo < SLO_COUNT; ++slo)
+	{
+		json.beginObject();
+		json.string("name", T4Watchdog::getSloString(WatchdogSlo(slo)));
+		json.number("limit", T4Watchdog::getSloLimit(WatchdogSlo(slo)));
+		json.number("value", stats.value[slo]);
+		json.boolean("breached", stats.breached[slo]);
+		json.number("breaches", stats.breaches[slo]);
+		json.endObject();
+	}
+	json.endArray();
+	json.beginArray("breaches");
+	for (auto breach = breaches; breach < breaches + count; ++breach)
+	{
+		json.beginObject();
+		json.number("time", breach->time);
+		json.string("objective", T4Watchdog::getSloString(breach->slo));
+		json.number("value", breach->value);
+		json.string("task", breach->task);
+		json.number("rxQueue", breach->rxQueueUsed);
+		json.number("txQueue", breach->txQueueUsed);
+		json.number("rxDropped", breach->rxDropped);
+		json.endObject();
+	}
+	json.endArray();
+	if (stats.restarted)
+		json.beginObject("restart").string("objective", T4Watchdog::getSloString(stats.lastRestart.slo)).number("value", stats.lastRestart.value).string("task", stats.lastRestart.task).endObject();
+	json.endObject();
+}
+
+void apiInit()
+{
+	String path = basePath + "api/v1/";
+
+	web_server.on(path + "status", HTTP_GET, api_status);
+	web_server.on(path + "log", HTTP_GET, api_log);
+	web_server.on(path + "diagnostics/*", HTTP_GET, api_diagnostics);
+	web_server.on(path + "parameters", HTTP_GET, api_parameters);
+	web_server.on(path + "parameters", HTTP_POST, api_parameters_apply);
+	web_server.on(path + "parameters/*", HTTP_GET, api_parameter_get);
+	web_server.on(path + "parameters/*", HTTP_PUT, api_parameter_put);
+	web_server.on(path + "commands", HTTP_GET, api_commands);
+	web_server.on(path + "commands/*", HTTP_POST, api_command_execute);
+	web_server.on(path + "metrics", HTTP_GET, api_metrics);
+	web_server.on(path + "backup", HTTP_GET, api_backup);
+	web_server.on(path + "restore", HTTP_POST, api_restore);
+	web_server.on(path + "latency", HTTP_GET, api_latency, false);
+	web_server.on(path + "memory", HTTP_GET, api_memory, false);
+	web_server.on(path + "watchdog", HTTP_GET, api_watchdog, false);
+	web_server.on(path + "wifi", HTTP_GET, api_wifi_get, false);
+	web_server.on(path + "wifi", HTTP_PUT, api_wifi_put, false);
+}
@@ -0,0 +1,123 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "apply.h"
+#include "decode.h"
+
+void setupRequests(const T4Unit& unit, T4Request* requests, T4ApplyWrite* const* writes, size_t count, uint8_t flags, bool previous)
+{
+	for (size_t n = 0; n < count; ++n)
+	{
+		auto& request = requests[n];
+		auto& write = *writes[n];
+		request = T4Request();
+
+		uint8_t header[5] = { CONTROLLER, write.command, flags, 0x00, 0x00 };
+		memcpy(request.message, header, sizeof(header));
+		request.messageSize = sizeof(header);
+
+		if (flags & SET)
+			request.messageSize += encodeParameter(unit.commandsInfo[write.command].get(), previous ? write.previous : write.value, &request.message[5]);
+	}
+}
+
+template<typename F>
+void sendWrites(T4Client& client, const T4Unit& unit, T4Request* requests, T4ApplyWrite* const* writes, size_t count, uint8_t flags, bool previous, F&& result)
+{
+	// requests are sent in chunks, so the number of requests allocated is bounded even for a whole backup image
+	for (size_t offset = 0; offset < count; offset += T4ApplyMaxWrites)
+	{
+		size_t chunk = std::min(count - offset, T4ApplyMaxWrites);
+		setupRequests(unit, requests, writes + offset, chunk, flags, previous);
+		client.sendRequests(unit.source, requests, chunk);
+
+		for (size_t n = 0; n < chunk; ++n)
+			result(*writes[offset + n], requests[n]);
+	}
+}
+
+bool applyParameters(T4Client& client, const T4Unit& unit, T4ApplyWrite* writes, size_t count, bool rollback)
+{
+	auto requests = std::make_unique<T4Request[]>(std::min(count, T4ApplyMaxWrites));
+	auto batch = std::make_unique<T4ApplyWrite*[]>(count);
+	size_t batch_count = 0;
+
+	for (size_t n = 0; n < count; ++n)
+		batch[n] = &writes[n];
+
+	// read the current values, unchanged ones are not written at all
+	bool success = true;
+	sendWrites(client, unit, requests.get(), batch.get(), count, REQ|GET|ACK|FIN, false, [&](T4ApplyWrite& write, const T4Request& request)
+	{
+		if (request.state != REQUEST_DONE)
+		{
+			write.result = APPLY_NO_REPLY;
+			success = false;
+			return;
+		}
+
+		write.previous = decodeParameter(unit.commandsInfo[write.command].get(), request.reply);
+		if (write.previous == write.value)
+			write.result = APPLY_UNCHANGED;
+	});
+
+	for (size_t n = 0; n < count; ++n)
+	{
+		if (writes[n].result == APPLY_PENDING)
+			batch[batch_count++] = &writes[n];
+	}
+
+	sendWrites(client, unit, requests.get(), batch.get(), batch_count, REQ|SET|ACK|FIN, false, [](T4ApplyWrite&, const T4Request&) {});
+
+	// read back everything that was written, even writes without reply might have been applied
+	sendWrites(client, unit, requests.get(), batch.get(), batch_count, REQ|GET|ACK|FIN, false, [&](T4ApplyWrite& write, const T4Request& request)
+	{
+		if (request.state != REQUEST_DONE)
+			write.result = APPLY_NO_REPLY;
+		else if (decodeParameter(unit.commandsInfo[write.command].get(), request.reply) != write.value)
+			write.result = APPLY_MISMATCH;
+		else
+			write.result = APPLY_WRITTEN;
+
+		success &= (write.result == APPLY_WRITTEN);
+	});
+
+	if (!success && rollback && batch_count)
+	{
+		sendWrites(client, unit, requests.get(), batch.get(), batch_count, REQ|SET|ACK|FIN, true, [](T4ApplyWrite& write, const T4Request& request)
+		{
+			if (write.result == APPLY_WRITTEN && request.state == REQUEST_DONE)
+				write.result = APPLY_ROLLED_BACK;
+		});
+	}
+
+	return success;
+}
+
+const char* getApplyResultString(T4ApplyResult result)
+{
+	switch (result)
+	{
+		case APPLY_PENDING: return "Pending";
+		case APPLY_WRITTEN: return "Written";
+		case APPLY_UNCHANGED: return "Unchanged";
+		case APPLY_NO_REPLY: return "No reply";
+		case APPLY_MISMATCH: return "Not accepted";
+		case APPLY_ROLLED_BACK: return "Rolled back";
+	}
+
+	return nullptr;
+}
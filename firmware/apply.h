@@ -0,0 +1,50 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef APPLY_H
+#define APPLY_H
+
+#include <Arduino.h>
+
+#include "t4.h"
+
+enum T4ApplyResult : uint8_t
+{
+	APPLY_PENDING,
+	APPLY_WRITTEN,			// written and verified by read-back
+	APPLY_UNCHANGED,		// the unit already had the value, nothing was written
+	APPLY_NO_REPLY,			// the unit didn't reply to the read or write
+	APPLY_MISMATCH,			// the value read back differs from the written one
+	APPLY_ROLLED_BACK,		// written, but restored to the previous value because another write failed
+};
+
+struct T4ApplyWrite
+{
+	uint8_t command;
+	uint64_t value;
+
+	uint64_t previous = 0;
+	T4ApplyResult result = APPLY_PENDING;
+};
+
+// max. number of writes of the configuration form, and of requests sent at once when applying more of them
+constexpr size_t T4ApplyMaxWrites = 64;
+
+// writes parameters in pipelined batches and verifies them by reading them back, unit has to be locked by the caller
+bool applyParameters(T4Client& client, const T4Unit& unit, T4ApplyWrite* writes, size_t count, bool rollback);
+const char* getApplyResultString(T4ApplyResult result);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// generated by tools/assets.py, do not edit
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <Arduino.h>
+
+struct WebAsset
+{
+	const char* path;
+	const char* contentType;
+	const char* etag;
+	const uint8_t* data;
+	size_t size;
+};
+
+// script.js (436 bytes, 288 bytes gzipped)
+const uint8_t asset_script_js[] PROGMEM =
+{
+	0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x3D, 0x8F, 0xC1, 0x6A, 0xC3, 0x30,
+	0x0C, 0x86, 0xCF, 0xF1, 0x53, 0xA8, 0xA7, 0x24, 0x50, 0xD2, 0xFB, 0x4A, 0x18, 0xA3, 0xF4, 0x30,
+	0x28, 0xBB, 0x74, 0xEC, 0x32, 0x76, 0x70, 0x63, 0x25, 0x35, 0x24, 0x72, 0x91, 0xE5, 0x6C, 0x63,
+	0xEC, 0xDD, 0xE7, 0xC4, 0xEE, 0x0E, 0x06, 0xEB, 0xF7, 0x67, 0xE9, 0xD3, 0x6E, 0x07, 0x8E, 0xC6,
+	0x6F, 0x90, 0x2B, 0x42, 0x77, 0xD5, 0x34, 0xA0, 0x81, 0x9B, 0x66, 0x3D, 0xA1, 0x20, 0x7B, 0xD0,
+	0x8C, 0xE0, 0xC3, 0x65, 0xB2, 0x22, 0x68, 0xB6, 0x2B, 0x65, 0xE9, 0x16, 0xC4, 0xC3, 0x80, 0xB2,
+	0x94, 0x96, 0x81, 0x22, 0xEC, 0xE1, 0xF3, 0x8A, 0x94, 0x83, 0x59, 0x8F, 0x01, 0xC1, 0xD8, 0xBE,
+	0x5F, 0x5A, 0xF4, 0xEC, 0xA6, 0xF5, 0x23, 0x23, 0x19, 0xE4, 0xD8, 0xDF, 0x11, 0x2A, 0xE3, 0xBA,
+	0x30, 0x21, 0x49, 0xA3, 0x8D, 0x39, 0xCE, 0xF1, 0x72, 0xB2, 0x5E, 0x90, 0x90, 0xAB, 0x32, 0x69,
+	0x94, 0x5B, 0xE8, 0x03, 0x75, 0x62, 0x1D, 0x55, 0x58, 0xAB, 0x1F, 0x55, 0xCC, 0x9A, 0xD3, 0x70,
+	0x68, 0x01, 0x1B, 0xD1, 0x1C, 0x15, 0xF6, 0xAA, 0xB0, 0x3D, 0x54, 0x9B, 0x35, 0x6F, 0xAC, 0xA9,
+	0x55, 0x51, 0x30, 0x4A, 0x60, 0xDA, 0xAB, 0xF4, 0xE3, 0xBE, 0x54, 0x0B, 0x55, 0x82, 0x44, 0x0F,
+	0x2F, 0xD1, 0x18, 0xDA, 0x16, 0xCA, 0xF3, 0xF1, 0x74, 0x3C, 0xBC, 0x96, 0x35, 0x3C, 0x42, 0x6E,
+	0xE1, 0x6E, 0xCB, 0x44, 0xFF, 0x9E, 0x2A, 0x8F, 0x23, 0x76, 0x71, 0xF3, 0xE7, 0x68, 0xFE, 0xF5,
+	0xD1, 0x18, 0xEC, 0x75, 0x18, 0xE5, 0x9C, 0x53, 0x78, 0x48, 0x3E, 0x4D, 0x5A, 0x78, 0xD3, 0xE6,
+	0x32, 0x63, 0x6F, 0x4B, 0x9A, 0x05, 0xB3, 0xC5, 0xA2, 0x97, 0x18, 0x5A, 0x15, 0xE0, 0xEE, 0x1D,
+	0x31, 0x1C, 0x3D, 0xFE, 0x3F, 0x33, 0x4E, 0x6E, 0xC6, 0x27, 0x11, 0xB6, 0x97, 0x20, 0x58, 0x95,
+	0x0B, 0x5F, 0xD6, 0x7B, 0xF5, 0x1B, 0xCF, 0x1F, 0x65, 0x56, 0x54, 0x98, 0xB4, 0x01, 0x00, 0x00,
+};
+
+// style.css (391 bytes, 237 bytes gzipped)
+const uint8_t asset_style_css[] PROGMEM =
+{
+	0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xA5, 0x50, 0x3D, 0x4B, 0x04, 0x31,
+	0x10, 0xED, 0xFD, 0x15, 0x03, 0x8B, 0x8D, 0x18, 0x48, 0x84, 0x13, 0x4D, 0xB0, 0x50, 0x2C, 0xB4,
+	0x39, 0x2D, 0xF6, 0x2A, 0xB1, 0xC8, 0x6E, 0xB2, 0x7B, 0xC3, 0xED, 0x66, 0x42, 0x32, 0xC7, 0xED,
+	0x2A, 0xFE, 0x77, 0x73, 0x77, 0x82, 0x62, 0x27, 0x32, 0xCD, 0x0C, 0xF3, 0x1E, 0xEF, 0xE3, 0x0C,
+	0xDE, 0xA1, 0xA3, 0xC0, 0xA2, 0xB3, 0x23, 0x0E, 0xB3, 0x86, 0x6C, 0x43, 0x16, 0xD9, 0x27, 0xEC,
+	0xE0, 0xE3, 0xE4, 0x41, 0x95, 0x77, 0x63, 0xDB, 0x4D, 0x9F, 0x68, 0x1B, 0x9C, 0x68, 0x69, 0xA0,
+	0xA4, 0xA1, 0x92, 0x6A, 0x71, 0x79, 0x7D, 0x6F, 0xE0, 0x78, 0xEF, 0xD6, 0xC8, 0xDE, 0x40, 0xB4,
+	0xCE, 0x61, 0xE8, 0xF5, 0x22, 0x4E, 0x85, 0x7A, 0x5B, 0x98, 0xBF, 0xE1, 0xEC, 0x27, 0x16, 0xCE,
+	0xB7, 0x94, 0x2C, 0x23, 0x05, 0x1D, 0x28, 0xF8, 0x02, 0xBD, 0x5B, 0xD5, 0xF5, 0xD3, 0xF2, 0x0F,
+	0x4A, 0x0D, 0x25, 0xE7, 0x93, 0x96, 0x3F, 0x34, 0x65, 0x9C, 0x0C, 0x8C, 0x36, 0xF5, 0x18, 0x44,
+	0x43, 0xCC, 0x34, 0xEE, 0x7D, 0x18, 0xD8, 0xA1, 0xE3, 0xB5, 0x56, 0x52, 0x9E, 0x1A, 0x70, 0x98,
+	0xE3, 0x60, 0x67, 0xD1, 0x0C, 0xD4, 0x6E, 0x8A, 0xEE, 0xE3, 0xF2, 0x79, 0x55, 0xBF, 0xF0, 0x1C,
+	0xFD, 0x4D, 0xDE, 0x36, 0x23, 0xF2, 0xEB, 0xBF, 0x3C, 0x28, 0x79, 0x08, 0x5E, 0x75, 0x44, 0xEC,
+	0xD3, 0x39, 0x7C, 0x2D, 0xF0, 0xDD, 0x44, 0x75, 0x25, 0xF7, 0x63, 0x8E, 0x8D, 0x67, 0x7C, 0xF3,
+	0x5A, 0x5D, 0x1C, 0x48, 0x9F, 0x53, 0x91, 0x96, 0x57, 0x87, 0x01, 0x00, 0x00,
+};
+
+const WebAsset WebAssets[] =
+{
+	{ "script.js", "application/javascript", "3fdbfe70", asset_script_js, sizeof(asset_script_js) },
+	{ "style.css", "text/css", "aa523256", asset_style_css, sizeof(asset_style_css) },
+};
+
+#endif
@@ -0,0 +1,280 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Preferences.h>
+#include <mbedtls/md.h>
+#include <mbedtls/sha256.h>
+
+#include "auth.h"
+
+// rounds of salted SHA-256 of the stored password
+const int PASSWORD_ROUNDS = 1000;
+
+const size_t SIGNATURE_SIZE = 16;
+
+// lockout after the free failures, doubled with every next failure up to 64 s
+const uint32_t LOCKOUT_TIME = 1000;
+const uint8_t LOCKOUT_DOUBLINGS = 6;
+
+// comparison of secrets which takes the same time regardless of where they differ
+bool secureEqual(const uint8_t* a, const uint8_t* b, size_t size)
+{
+	uint8_t difference = 0;
+	for (size_t n = 0; n < size; ++n)
+		difference |= a[n] ^ b[n];
+	return difference == 0;
+}
+
+void randomBytes(uint8_t* data, size_t size)
+{
+	for (size_t n = 0; n < size; n += sizeof(uint32_t))
+	{
+		uint32_t value = esp_random();
+		memcpy(&data[n], &value, std::min(size - n, sizeof(value)));
+	}
+}
+
+void WebAuth::init()
+{
+	m_mutex = createMutex(m_mutexBuffer);
+	randomBytes(m_key, sizeof(m_key));
+
+	Preferences prefs;
+	if (prefs.begin("auth", true))
+	{
+		if (prefs.getBytesLength("hash") == sizeof(m_hash) && prefs.getBytesLength("salt") == sizeof(m_salt))
+		{
+			m_login = prefs.getString("login");
+			prefs.getBytes("salt", m_salt, sizeof(m_salt));
+			prefs.getBytes("hash", m_hash, sizeof(m_hash));
+		}
+		prefs.end();
+	}
+
+	if (!m_login.length())
+	{
+		// default credentials until they are changed
+		m_login = "login";
+		memset(m_salt, 0, sizeof(m_salt));
+		hashPassword(m_salt, "changeme", m_hash);
+	}
+}
+
+void WebAuth::hashPassword(const uint8_t* salt, const String& password, uint8_t* hash)
+{
+	uint8_t data[sizeof(m_salt) + 32];
+	memcpy(data, salt, sizeof(m_salt));
+	mbedtls_sha256((const uint8_t*)password.c_str(), password.length(), &data[sizeof(m_salt)], 0);
+
+	for (int n = 0; n < PASSWORD_ROUNDS; ++n)
+		mbedtls_sha256(data, sizeof(data), &data[sizeof(m_salt)], 0);
+
+	memcpy(hash, &data[sizeof(m_salt)], 32);
+}
+
+String WebAuth::getLogin()
+{
+	String login;
+	if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+	{
+		login = m_login;
+		xSemaphoreGive(m_mutex);
+	}
+	return login;
+}
+
+bool WebAuth::checkCredentials(const String& login, const String& password)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return false;
+
+	// the password isn't even hashed while locked out, guessing costs no CPU time
+	if (m_failures >= WebAuthFreeFailures && int32_t(m_lockoutEnd - millis()) > 0)
+	{
+		xSemaphoreGive(m_mutex);
+		return false;
+	}
+
+	uint8_t salt[sizeof(m_salt)];
+	uint8_t stored_hash[sizeof(m_hash)];
+	memcpy(salt, m_salt, sizeof(salt));
+	memcpy(stored_hash, m_hash, sizeof(stored_hash));
+	bool login_ok = (login == m_login);
+
+	xSemaphoreGive(m_mutex);
+
+	uint8_t hash[sizeof(m_hash)];
+	hashPassword(salt, password, hash);
+
+	// password is checked even if the login is wrong
+	bool password_ok = secureEqual(hash, stored_hash, sizeof(hash));
+	bool ok = login_ok & password_ok;
+
+	if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+	{
+		if (ok)
+		{
+			m_failures = 0;
+		}
+		else
+		{
+			if (m_failures < UINT8_MAX)
+				m_failures++;
+			if (m_failures >= WebAuthFreeFailures)
+				m_lockoutEnd = millis() + (LOCKOUT_TIME << std::min<uint8_t>(m_failures - WebAuthFreeFailures, LOCKOUT_DOUBLINGS));
+		}
+		xSemaphoreGive(m_mutex);
+	}
+
+	return ok;
+}
+
+uint32_t WebAuth::getLockout()
+{
+	int32_t lockout = 0;
+	if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+	{
+		if (m_failures >= WebAuthFreeFailures)
+			lockout = std::max<int32_t>(int32_t(m_lockoutEnd - millis()), 0);
+		xSemaphoreGive(m_mutex);
+	}
+	return lockout;
+}
+
+bool WebAuth::setCredentials(const String& login, const String& password)
+{
+	// login is shown in the form, so it can't contain characters of HTML markup
+	if (!login.length() || !password.length() || strpbrk(login.c_str(), "\"'<>&"))
+		return false;
+
+	uint8_t salt[sizeof(m_salt)];
+	uint8_t hash[sizeof(m_hash)];
+	randomBytes(salt, sizeof(salt));
+	hashPassword(salt, password, hash);
+
+	Preferences prefs;
+	if (!prefs.begin("auth"))
+		return false;
+
+	prefs.putString("login", login.c_str());
+	prefs.putBytes("salt", salt, sizeof(salt));
+	prefs.putBytes("hash", hash, sizeof(hash));
+	prefs.end();
+
+	if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+	{
+		m_login = login;
+		memcpy(m_salt, salt, sizeof(m_salt));
+		memcpy(m_hash, hash, sizeof(m_hash));
+
+		// all sessions of the previous credentials end
+		for (auto& session : m_sessions)
+			session.active = false;
+
+		xSemaphoreGive(m_mutex);
+	}
+
+	return true;
+}
+
+String WebAuth::createSession()
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return String();
+
+	// free slot, or the one which expires first
+	uint32_t now = millis();
+	auto session = std::min_element(std::begin(m_sessions), std::end(m_sessions), [now](const auto& a, const auto& b)
+	{
+		return (a.active ? int32_t(a.expiration - now) : INT32_MIN) < (b.active ? int32_t(b.expiration - now) : INT32_MIN);
+	});
+
+	randomBytes(session->id, sizeof(session->id));
+	session->expiration = now + WebSessionTimeout;
+	session->active = true;
+
+	uint8_t signature[32];
+	mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), m_key, sizeof(m_key), session->id, sizeof(session->id), signature);
+
+	char token[(sizeof(session->id) + SIGNATURE_SIZE) * 2 + 1];
+	for (size_t n = 0; n < sizeof(session->id); ++n)
+		snprintf(&token[n * 2], 3, "%02x", session->id[n]);
+	for (size_t n = 0; n < SIGNATURE_SIZE; ++n)
+		snprintf(&token[(sizeof(session->id) + n) * 2], 3, "%02x", signature[n]);
+
+	xSemaphoreGive(m_mutex);
+	return token;
+}
+
+bool WebAuth::parseToken(const String& token, uint8_t* id)
+{
+	uint8_t data[sizeof(WebSession::id) + SIGNATURE_SIZE];
+	if (token.length() != sizeof(data) * 2)
+		return false;
+
+	for (size_t n = 0; n < sizeof(data); ++n)
+	{
+		char* end;
+		char hex[3] = { token[n * 2], token[n * 2 + 1], 0 };
+		data[n] = strtoul(hex, &end, 16);
+		if (*end)
+			return false;
+	}
+
+	uint8_t signature[32];
+	mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), m_key, sizeof(m_key), data, sizeof(WebSession::id), signature);
+	if (!secureEqual(signature, &data[sizeof(WebSession::id)], SIGNATURE_SIZE))
+		return false;
+
+	memcpy(id, data, sizeof(WebSession::id));
+	return true;
+}
+
+bool WebAuth::checkSession(const String& token)
+{
+	uint8_t id[sizeof(WebSession::id)];
+	if (!parseToken(token, id) || !xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return false;
+
+	bool valid = false;
+	uint32_t now = millis();
+	for (auto& session : m_sessions)
+	{
+		if (session.active && int32_t(session.expiration - now) > 0 && secureEqual(session.id, id, sizeof(id)))
+		{
+			session.expiration = now + WebSessionTimeout;
+			valid = true;
+		}
+	}
+
+	xSemaphoreGive(m_mutex);
+	return valid;
+}
+
+void WebAuth::removeSession(const String& token)
+{
+	uint8_t id[sizeof(WebSession::id)];
+	if (!parseToken(token, id) || !xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	for (auto& session : m_sessions)
+	{
+		if (secureEqual(session.id, id, sizeof(id)))
+			session.active = false;
+	}
+
+	xSemaphoreGive(m_mutex);
+}
@@ -0,0 +1,77 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef AUTH_H
+#define AUTH_H
+
+#include <Arduino.h>
+
+#include "tasks.h"
+
+struct WebSession
+{
+	uint8_t id[16];
+	uint32_t expiration = 0;
+	bool active = false;
+};
+
+constexpr size_t WebSessions = 8;
+
+// session expires after this time of inactivity (in milliseconds)
+constexpr uint32_t WebSessionTimeout = 15 * 60 * 1000;
+
+// failed checks of credentials allowed before the checks are locked out
+constexpr uint8_t WebAuthFreeFailures = 3;
+
+class WebAuth
+{
+public:
+	void init();
+
+	// fails without checking anything while locked out after repeated failures
+	bool checkCredentials(const String& login, const String& password);
+	// remaining time of the lockout (in milliseconds)
+	uint32_t getLockout();
+	bool setCredentials(const String& login, const String& password);
+	String getLogin();
+
+	// token of the session is its id and HMAC signature of the id, both hex-encoded
+	String createSession();
+	bool checkSession(const String& token);
+	void removeSession(const String& token);
+
+private:
+	void hashPassword(const uint8_t* salt, const String& password, uint8_t* hash);
+	bool parseToken(const String& token, uint8_t* id);
+
+	SemaphoreHandle_t m_mutex = nullptr;
+	MutexBuffer m_mutexBuffer;
+
+	// key signing the tokens, generated on every boot, so all sessions end with restart
+	uint8_t m_key[32];
+
+	String m_login;
+	uint8_t m_salt[16];
+	uint8_t m_hash[32];
+
+	WebSession m_sessions[WebSessions];
+
+	// consecutive failed checks of credentials and the end of the lockout they caused
+	uint8_t m_failures = 0;
+	uint32_t m_lockoutEnd = 0;
+};
+
+#endif
@@ -0,0 +1,193 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <esp_crc.h>
+
+#include "backup.h"
+#include "decode.h"
+
+const char BACKUP_MAGIC[4] = { 'T', '4', 'C', 'F' };
+const uint8_t BACKUP_VERSION = 1;
+
+// parameters read in one batch, limits the memory needed for the requests
+const size_t BACKUP_BATCH = 16;
+
+bool readAutomationType(T4Client& client, const T4Unit& unit, uint32_t& automationType)
+{
+	auto command_info = unit.commandsInfo[0x00].get();
+	if (!command_info || getParameterSize(command_info) > sizeof(automationType))
+	{
+		automationType = 0;
+		return true;
+	}
+
+	// CTRL_AUTOMATION_TYPE(0x00)
+	T4Packet reply;
+	uint8_t message[5] = { CONTROLLER, 0x00, REQ|GET|ACK|FIN, 0x00, 0x00 };
+	if (!client.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3))
+		return false;
+
+	automationType = decodeParameter(command_info, reply);
+	return true;
+}
+
+T4BackupError createBackup(T4Client& client, const T4Unit& unit, std::vector<uint8_t>& image)
+{
+	T4BackupHeader header = {};
+	memcpy(header.magic, BACKUP_MAGIC, sizeof(header.magic));
+	header.version = BACKUP_VERSION;
+
+	uint32_t automation_type;
+	if (!readAutomationType(client, unit, automation_type))
+		return BACKUP_NO_REPLY;
+	header.automationType = automation_type;
+
+	image.assign((const uint8_t*)&header, (const uint8_t*)&header + sizeof(header));
+
+	// a command may be in more menus, but it's stored once
+	uint8_t commands[256];
+	size_t commands_count = 0;
+	bool stored[256] = {};
+	for (auto menu : unit.menu)
+	{
+		uint8_t command = menu >> 8;
+		auto command_info = getParameterInfo(unit, command);
+		if (!stored[command] && command_info && getParameterSize(command_info) <= sizeof(uint64_t) && getParameter(command_info).kind != PARAMETER_TEXT)
+		{
+			stored[command] = true;
+			commands[commands_count++] = command;
+		}
+	}
+
+	// count of the header is 8-bit
+	if (commands_count > UINT8_MAX)
+		return BACKUP_TOO_MANY;
+
+	auto requests = std::make_unique<T4Request[]>(BACKUP_BATCH);
+	for (size_t offset = 0; offset < commands_count; offset += BACKUP_BATCH)
+	{
+		size_t count = std::min(commands_count - offset, BACKUP_BATCH);
+		for (size_t n = 0; n < count; ++n)
+		{
+			uint8_t message[5] = { CONTROLLER, commands[offset + n], REQ|GET|ACK|FIN, 0x00, 0x00 };
+			requests[n] = T4Request();
+			memcpy(requests[n].message, message, sizeof(message));
+			requests[n].messageSize = sizeof(message);
+		}
+
+		if (client.sendRequests(unit.source, requests.get(), count) != count)
+			return BACKUP_NO_REPLY;
+
+		for (size_t n = 0; n < count; ++n)
+		{
+			uint8_t command = commands[offset + n];
+			uint8_t size = getParameterSize(unit.commandsInfo[command].get());
+
+			// message is device, command, flags, sequence, status, data and hash
+			auto& reply = requests[n].reply;
+			if (reply.header.messageSize < 6 + size)
+				return BACKUP_INVALID_REPLY;
+
+			image.push_back(command);
+			image.push_back(size);
+			image.insert(image.end(), reply.message.dmp.data, reply.message.dmp.data + size);
+		}
+	}
+
+	auto image_header = (T4BackupHeader*)image.data();
+	image_header->count = commands_count;
+	image_header->size = image.size() - sizeof(T4BackupHeader);
+
+	uint32_t crc = esp_crc32_le(0, image.data(), image.size());
+	image.insert(image.end(), (const uint8_t*)&crc, (const uint8_t*)&crc + sizeof(crc));
+
+	return BACKUP_OK;
+}
+
+T4BackupError parseBackup(T4Client& client, const T4Unit& unit, const uint8_t* image, size_t size, bool force, std::vector<T4ApplyWrite>& writes)
+{
+	if (size < sizeof(T4BackupHeader) + sizeof(uint32_t))
+		return BACKUP_INVALID;
+
+	T4BackupHeader header;
+	memcpy(&header, image, sizeof(header));
+	if (memcmp(header.magic, BACKUP_MAGIC, sizeof(header.magic)) || header.version != BACKUP_VERSION || sizeof(header) + header.size + sizeof(uint32_t) != size)
+		return BACKUP_INVALID;
+
+	uint32_t crc;
+	memcpy(&crc, &image[size - sizeof(crc)], sizeof(crc));
+	if (esp_crc32_le(0, image, size - sizeof(crc)) != crc)
+		return BACKUP_CHECKSUM;
+
+	if (!force)
+	{
+		uint32_t automation_type;
+		if (!readAutomationType(client, unit, automation_type))
+			return BACKUP_NO_REPLY;
+		if (automation_type != header.automationType)
+			return BACKUP_AUTOMATION_TYPE;
+	}
+
+	writes.clear();
+
+	auto entry = &image[sizeof(header)];
+	auto end = &image[size - sizeof(crc)];
+	for (size_t n = 0; n < header.count; ++n)
+	{
+		if (end - entry < 2 || end - entry < 2 + entry[1])
+			return BACKUP_INVALID;
+
+		uint8_t command = entry[0];
+		uint8_t value_size = entry[1];
+		auto value_data = &entry[2];
+		entry += 2 + value_size;
+
+		// parameters unknown to this unit are skipped, known ones have to match
+		auto command_info = getParameterInfo(unit, command);
+		if (!command_info)
+			continue;
+		if (getParameterSize(command_info) != value_size || value_size > sizeof(uint64_t))
+			return BACKUP_PARAMETER;
+
+		uint64_t value = 0;
+		for (size_t m = 0; m < value_size; ++m)
+			value = (value << 8) | value_data[m];
+
+		if (validateParameter(getParameter(command_info), value) != PARAMETER_VALID)
+			return BACKUP_PARAMETER;
+
+		writes.push_back({ command, value });
+	}
+
+	return (entry == end) ? BACKUP_OK : BACKUP_INVALID;
+}
+
+const char* getBackupErrorString(T4BackupError error)
+{
+	switch (error)
+	{
+		case BACKUP_OK: return "OK";
+		case BACKUP_NO_REPLY: return "No reply from unit";
+		case BACKUP_INVALID: return "Invalid image";
+		case BACKUP_CHECKSUM: return "Checksum mismatch";
+		case BACKUP_AUTOMATION_TYPE: return "Image is for different automation type";
+		case BACKUP_PARAMETER: return "Image contains value the unit doesn't accept";
+		case BACKUP_INVALID_REPLY: return "Invalid reply from unit";
+		case BACKUP_TOO_MANY: return "Too many parameters for the image";
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,57 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BACKUP_H
+#define BACKUP_H
+
+#include <Arduino.h>
+#include <vector>
+
+#include "t4.h"
+#include "apply.h"
+
+// image starts with the header, followed by entries of command(u8), size(u8), value[size] (big-endian as on the bus),
+// and ends with CRC-32 of everything before it, numbers of the header are little-endian
+struct __attribute__((packed)) T4BackupHeader
+{
+	char magic[4];
+	uint8_t version;
+	uint8_t count;
+	uint16_t size;				// size of the entries
+	uint32_t automationType;	// value of CTRL_AUTOMATION_TYPE(0x00)
+};
+
+enum T4BackupError : uint8_t
+{
+	BACKUP_OK,
+	BACKUP_NO_REPLY,
+	BACKUP_INVALID,
+	BACKUP_CHECKSUM,
+	BACKUP_AUTOMATION_TYPE,
+	BACKUP_PARAMETER,
+	BACKUP_INVALID_REPLY,
+	BACKUP_TOO_MANY,
+};
+
+// reads all settable parameters with pipelined requests, unit has to be locked by the caller
+T4BackupError createBackup(T4Client& client, const T4Unit& unit, std::vector<uint8_t>& image);
+
+// checks the image against the unit and converts it to writes for applyParameters(), unit has to be locked by the caller
+T4BackupError parseBackup(T4Client& client, const T4Unit& unit, const uint8_t* image, size_t size, bool force, std::vector<T4ApplyWrite>& writes);
+
+const char* getBackupErrorString(T4BackupError error);
+
+#endif
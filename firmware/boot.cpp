@@ -0,0 +1,44 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "boot.h"
+
+uint32_t bootTimes[BOOT_STAGES] = {};
+
+void bootMark(BootStage stage)
+{
+	if (!bootTimes[stage])
+		bootTimes[stage] = esp_timer_get_time();
+}
+
+uint32_t getBootTime(BootStage stage)
+{
+	return bootTimes[stage];
+}
+
+const char* getBootStageString(BootStage stage)
+{
+	switch (stage)
+	{
+		case BOOT_UART: return "UART up";
+		case BOOT_WIFI_ASSOCIATED: return "Wi-Fi associated";
+		case BOOT_WIFI_IP: return "Wi-Fi IP address";
+		case BOOT_HTTP_READY: return "HTTP ready";
+		case BOOT_STAGES: break;
+	}
+
+	return nullptr;
+}
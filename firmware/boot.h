@@ -0,0 +1,38 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <Arduino.h>
+
+enum BootStage : uint8_t
+{
+	BOOT_UART,
+	BOOT_WIFI_ASSOCIATED,
+	BOOT_WIFI_IP,
+	BOOT_HTTP_READY,
+	BOOT_STAGES
+};
+
+// records the time since start of the firmware when the stage was reached for the first time
+void bootMark(BootStage stage);
+
+// time of the stage (in microseconds), 0 if it wasn't reached yet
+uint32_t getBootTime(BootStage stage);
+const char* getBootStageString(BootStage stage);
+
+#endif
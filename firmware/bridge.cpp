@@ -0,0 +1,308 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <lwip/sockets.h>
+
+#include "bridge.h"
+
+// number of packets the client may send before it has to wait for returned credits
+const uint16_t CREDIT_WINDOW = 4;
+
+// space of the bus queue kept for the web interface and other local users
+const size_t TX_QUEUE_RESERVE = 8;
+
+void T4Bridge::init(uint16_t port)
+{
+	m_port = port;
+	m_mutex = createMutex(m_mutexBuffer);
+
+	createTask(bridgeTaskThunk, m_bridgeTaskBuffer, this, &m_bridgeTaskHandle);
+	m_client.subscribe("bridge", *this);
+}
+
+void T4Bridge::onPacket(const T4Packet& packet)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	uint8_t frame[5];
+	memcpy(frame, &packet.time, sizeof(packet.time));
+	frame[4] = (packet.header.from == T4ThisAddress) ? 1 : 0;
+
+	// the client which doesn't read fast enough loses frames, but it never blocks the others
+	for (auto& client : m_clients)
+	{
+		if (client.socket < 0)
+			continue;
+
+		if (push(client, BRIDGE_FRAME, frame, sizeof(frame), packet.data, packet.size))
+			client.sent++;
+		else
+			client.dropped++;
+	}
+
+	xSemaphoreGive(m_mutex);
+}
+
+size_t T4Bridge::getStats(T4BridgeClientStats* stats)
+{
+	size_t count = 0;
+
+	if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+	{
+		for (auto& client : m_clients)
+		{
+			if (client.socket >= 0)
+				stats[count++] = { client.address, client.txSize, client.txPeak, client.sent, client.received, client.dropped, client.rejected };
+		}
+
+		xSemaphoreGive(m_mutex);
+	}
+
+	return count;
+}
+
+bool T4Bridge::push(T4BridgeClient& client, uint8_t type, const uint8_t* data, size_t size, const uint8_t* data2, size_t size2)
+{
+	size_t message_size = 1 + size + size2;
+	if (message_size > 0xFF || client.txSize + 1 + message_size > sizeof(client.txData))
+		return false;
+
+	auto put = [&](uint8_t byte) { client.txData[(client.txHead + client.txSize++) % sizeof(client.txData)] = byte; };
+
+	put(message_size);
+	put(type);
+	for (size_t n = 0; n < size; ++n)
+		put(data[n]);
+	for (size_t n = 0; n < size2; ++n)
+		put(data2[n]);
+
+	client.txPeak = std::max(client.txPeak, client.txSize);
+	return true;
+}
+
+void T4Bridge::receive(T4BridgeClient& client)
+{
+	if (client.rxSize < sizeof(client.rxData))
+	{
+		int size = recv(client.socket, &client.rxData[client.rxSize], sizeof(client.rxData) - client.rxSize, 0);
+		if (size == 0 || (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+			return disconnect(client);
+		if (size > 0)
+			client.rxSize += size;
+	}
+
+	// counters and credits are read by the web interface
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	// process complete messages, but stop at packet which can't be passed to the bus yet
+	while (!client.hasPending && client.rxSize > 0 && client.rxSize >= 1 + size_t(client.rxData[0]))
+	{
+		size_t message_size = client.rxData[0];
+		if (message_size && client.rxData[1] == BRIDGE_SEND)
+		{
+			size_t packet_size = message_size - 1;
+			if (!client.credits || packet_size < 3 || packet_size > sizeof(client.pending.data))
+			{
+				// client sent more than it was allowed to, or the packet is malformed
+				client.rejected++;
+			}
+			else
+			{
+				client.credits--;
+				client.received++;
+
+				client.pending = T4Packet();
+				client.pending.size = packet_size;
+				memcpy(client.pending.data, &client.rxData[2], packet_size);
+				client.hasPending = true;
+			}
+		}
+
+		client.rxSize -= 1 + message_size;
+		memmove(client.rxData, &client.rxData[1 + message_size], client.rxSize);
+	}
+
+	xSemaphoreGive(m_mutex);
+}
+
+void T4Bridge::transmit(T4BridgeClient& client)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	size_t chunk = std::min(client.txSize, sizeof(client.txData) - client.txHead);
+	if (chunk)
+	{
+		int size = send(client.socket, &client.txData[client.txHead], chunk, 0);
+		if (size > 0)
+		{
+			client.txHead = (client.txHead + size) % sizeof(client.txData);
+			client.txSize -= size;
+		}
+		else if (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+		{
+			xSemaphoreGive(m_mutex);
+			return disconnect(client);
+		}
+	}
+
+	xSemaphoreGive(m_mutex);
+}
+
+void T4Bridge::disconnect(T4BridgeClient& client)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	closesocket(client.socket);
+	client.socket = -1;
+
+	xSemaphoreGive(m_mutex);
+}
+
+void T4Bridge::bridgeTask()
+{
+	for (;;)
+	{
+		if (m_listenSocket < 0)
+		{
+			m_listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+
+			struct sockaddr_in address = {};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(m_port);
+			address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+			if (m_listenSocket < 0 || bind(m_listenSocket, (struct sockaddr*)&address, sizeof(address)) || listen(m_listenSocket, 2))
+			{
+				if (m_listenSocket >= 0)
+					closesocket(m_listenSocket);
+				m_listenSocket = -1;
+
+				vTaskDelay(1000);
+				continue;
+			}
+
+			fcntl(m_listenSocket, F_SETFL, O_NONBLOCK);
+		}
+
+		fd_set read_set;
+		fd_set write_set;
+		FD_ZERO(&read_set);
+		FD_ZERO(&write_set);
+		FD_SET(m_listenSocket, &read_set);
+		int max_socket = m_listenSocket;
+
+		if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+		{
+			for (auto& client : m_clients)
+			{
+				if (client.socket < 0)
+					continue;
+
+				// stop reading while the packet can't be passed to the bus, TCP window then pushes back to the client
+				if (!client.hasPending)
+					FD_SET(client.socket, &read_set);
+				if (client.txSize)
+					FD_SET(client.socket, &write_set);
+				max_socket = std::max(max_socket, client.socket);
+			}
+
+			xSemaphoreGive(m_mutex);
+		}
+
+		struct timeval timeout = { 0, 10000 };
+		if (select(max_socket + 1, &read_set, &write_set, nullptr, &timeout) > 0)
+		{
+			if (FD_ISSET(m_listenSocket, &read_set))
+			{
+				struct sockaddr_in address;
+				socklen_t address_size = sizeof(address);
+				int client_socket = accept(m_listenSocket, (struct sockaddr*)&address, &address_size);
+				if (client_socket >= 0)
+				{
+					auto client = std::find_if(std::begin(m_clients), std::end(m_clients), [](const auto& c) { return c.socket < 0; });
+					if (client != std::end(m_clients) && xSemaphoreTake(m_mutex, portMAX_DELAY))
+					{
+						int one = 1;
+						setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+						fcntl(client_socket, F_SETFL, O_NONBLOCK);
+
+						client->reset();
+						client->socket = client_socket;
+						client->address = IPAddress(address.sin_addr.s_addr);
+
+						// grant initial credits
+						client->credits = CREDIT_WINDOW;
+						push(*client, BRIDGE_CREDIT, (const uint8_t*)&client->credits, sizeof(client->credits));
+
+						xSemaphoreGive(m_mutex);
+					}
+					else
+					{
+						closesocket(client_socket);
+					}
+				}
+			}
+
+			for (auto& client : m_clients)
+			{
+				if (client.socket >= 0 && FD_ISSET(client.socket, &read_set))
+					receive(client);
+				if (client.socket >= 0 && FD_ISSET(client.socket, &write_set))
+					transmit(client);
+			}
+		}
+
+		// pass pending packets to the bus as long as there's enough space in the queue, return the credit for each of them;
+		// the first client is rotated, so the one which fills the queue doesn't starve the others
+		m_firstSender = (m_firstSender + 1) % std::size(m_clients);
+		for (size_t n = 0; n < std::size(m_clients); ++n)
+		{
+			auto& client = m_clients[(m_firstSender + n) % std::size(m_clients)];
+			if (client.socket < 0 || !client.hasPending)
+				continue;
+
+			if (m_client.getTxQueueSpace() <= TX_QUEUE_RESERVE || !m_client.send(client.pending, 0))
+				break;
+
+			client.hasPending = false;
+			client.creditsReturn++;
+
+			// the rest of received data may contain more packets
+			receive(client);
+		}
+
+		if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+		{
+			for (auto& client : m_clients)
+			{
+				if (client.socket >= 0 && client.creditsReturn && push(client, BRIDGE_CREDIT, (const uint8_t*)&client.creditsReturn, sizeof(client.creditsReturn)))
+				{
+					client.credits += client.creditsReturn;
+					client.creditsReturn = 0;
+				}
+			}
+
+			xSemaphoreGive(m_mutex);
+		}
+	}
+
+	m_bridgeTaskHandle = nullptr;
+	vTaskDelete(nullptr);
+}
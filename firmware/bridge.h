@@ -0,0 +1,117 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <Arduino.h>
+
+#include "t4.h"
+
+// every message of the bridge is prefixed by its length (not including the length byte itself)
+enum T4BridgeMessage : uint8_t
+{
+	BRIDGE_FRAME = 0x01,		// server -> client: time(u32), direction(u8), data[]
+	BRIDGE_SEND = 0x02,			// client -> server: data[]
+	BRIDGE_CREDIT = 0x03,		// server -> client: credits(u16)
+};
+
+struct T4BridgeClient
+{
+	int socket = -1;
+	IPAddress address;
+
+	// encoded messages waiting to be sent to the client
+	uint8_t txData[2048];
+	size_t txHead = 0;
+	size_t txSize = 0;
+	size_t txPeak = 0;
+
+	// partially received message
+	uint8_t rxData[256];
+	size_t rxSize = 0;
+
+	// packet received from the client, waiting for space in the bus queue
+	T4Packet pending;
+	bool hasPending = false;
+
+	// credits the client still has, and credits to be returned to it
+	uint16_t credits = 0;
+	uint16_t creditsReturn = 0;
+
+	uint32_t sent = 0;
+	uint32_t received = 0;
+	uint32_t dropped = 0;
+	uint32_t rejected = 0;
+
+	// state of a new connection, buffers aren't cleared, the client is too big for a temporary on the stack of the task
+	void reset()
+	{
+		txHead = txSize = txPeak = 0;
+		rxSize = 0;
+		hasPending = false;
+		credits = creditsReturn = 0;
+		sent = received = dropped = rejected = 0;
+	}
+};
+
+struct T4BridgeClientStats
+{
+	IPAddress address;
+	size_t lag;
+	size_t lagPeak;
+	uint32_t sent;
+	uint32_t received;
+	uint32_t dropped;
+	uint32_t rejected;
+};
+
+constexpr size_t T4BridgeClients = 4;
+
+class T4Bridge : public T4Subscriber
+{
+public:
+	T4Bridge(T4Client& client) : m_client(client) {}
+
+	void init(uint16_t port);
+	void onPacket(const T4Packet& packet) override;
+
+	void bridgeTask();
+	static void bridgeTaskThunk(void* self) { ((T4Bridge*)self)->bridgeTask(); }
+
+	size_t getStats(T4BridgeClientStats* stats);
+
+private:
+	bool push(T4BridgeClient& client, uint8_t type, const uint8_t* data, size_t size, const uint8_t* data2 = nullptr, size_t size2 = 0);
+	void receive(T4BridgeClient& client);
+	void transmit(T4BridgeClient& client);
+	void disconnect(T4BridgeClient& client);
+
+	T4Client& m_client;
+
+	uint16_t m_port = 0;
+	int m_listenSocket = -1;
+
+	TaskHandle_t m_bridgeTaskHandle = nullptr;
+	TaskBuffer<TASK_T4_BRIDGE> m_bridgeTaskBuffer;
+	SemaphoreHandle_t m_mutex = nullptr;
+	MutexBuffer m_mutexBuffer;
+
+	T4BridgeClient m_clients[T4BridgeClients];
+	size_t m_firstSender = 0;
+};
+
+#endif
@@ -0,0 +1,336 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "decode.h"
+
+const char* getAutomationStatusString(uint8_t status)
+{
+	return T4AutomationStatusStrings[status];
+}
+
+const char* getManoeuvreStatusString(uint8_t status)
+{
+	return T4ManoeuvreStatusStrings[status];
+}
+
+void decodeStatus(const T4Packet& reply, T4FieldSink& sink)
+{
+	auto status = reply.message.dmp.data[0];
+	auto flags = reply.message.dmp.data[1];
+	auto log = reply.message.dmp.data[2];
+
+	sink.onField({ "Automation status", status, getAutomationStatusString(status), nullptr });
+	sink.onField({ "Last manoeuvre status", log, getManoeuvreStatusString(log), nullptr });
+
+	auto flag = [&](uint8_t mask, const char* label, const char* on, const char* off)
+	{
+		sink.onField({ label, (flags & mask) ? 1 : 0, (flags & mask) ? on : off, nullptr });
+	};
+	flag(0x01, "Devices search", "Not in progress", "In progress");
+	flag(0x02, "Posititons search", "Not in progress", "In progress");
+	flag(0x04, "First learning manoeuvers", "Completed", "Not completed");
+	flag(0x08, "Configuration", "Not in progress", "In progress");
+	flag(0x10, "EEPROM errors", "No errors found", "Errors found");
+}
+
+namespace
+{
+	// value strings of the flags, { off, on }
+	constexpr const char* OnOff[] = { "Off", "On" };
+	constexpr const char* OkKo[] = { "OK", "KO" };
+	constexpr const char* KoOk[] = { "KO", "OK" };
+	constexpr const char* RightLeft[] = { "Right", "Left" };
+	constexpr const char* Frequency[] = { "50 Hz", "60 Hz" };
+
+	constexpr const char* HaltStates[] = { "Not set", "B1", "B2", "NC", "NO", "Out of range", "Border OSE" };
+	constexpr const char* LimiterStates[] = { "OK", "Threshold 1", "Threshold 2", "Alarm engine" };
+
+	// DIAG_IO(0xE1)
+	constexpr T4DiagnosticsField DiagnosticsIO[] =
+	{
+		{ 0, 0x01, DIAGNOSTICS_FLAG, "Input halt", OnOff, 2 },
+		{ 0, 0x02, DIAGNOSTICS_FLAG, "Input 1 PP", OnOff, 2 },
+		{ 0, 0x04, DIAGNOSTICS_FLAG, "Input 2 AP", OnOff, 2 },
+		{ 0, 0x08, DIAGNOSTICS_FLAG, "Input 3 CH", OnOff, 2 },
+		{ 0, 0x10, DIAGNOSTICS_FLAG, "Loop 1", OnOff, 2 },
+		{ 0, 0x20, DIAGNOSTICS_FLAG, "Loop 2", OnOff, 2 },
+		{ 1, 0x01, DIAGNOSTICS_FLAG, "Button 1", OnOff, 2 },
+		{ 1, 0x02, DIAGNOSTICS_FLAG, "Button 2", OnOff, 2 },
+		{ 1, 0x04, DIAGNOSTICS_FLAG, "Button 3", OnOff, 2 },
+		{ 2, 0x01, DIAGNOSTICS_FLAG, "Fca M1", OnOff, 2 },
+		{ 2, 0x02, DIAGNOSTICS_FLAG, "Fcc M1", OnOff, 2 },
+		{ 2, 0x04, DIAGNOSTICS_FLAG, "Fca M2", OnOff, 2 },
+		{ 2, 0x08, DIAGNOSTICS_FLAG, "Fcc M2", OnOff, 2 },
+		{ 2, 0x10, DIAGNOSTICS_FLAG, "Unlock M1", OnOff, 2 },
+		{ 2, 0x20, DIAGNOSTICS_FLAG, "Unlock M2", OnOff, 2 },
+		{ 2, 0x40, DIAGNOSTICS_FLAG, "Selection direction", RightLeft, 2 },
+		{ 2, 0x80, DIAGNOSTICS_FLAG, "Selection engine", RightLeft, 2 },
+		{ 3, 0x01, DIAGNOSTICS_FLAG, "State enc M1", OnOff, 2 },
+		{ 3, 0x02, DIAGNOSTICS_FLAG, "State enc M2", OnOff, 2 },
+		{ 3, 0x04, DIAGNOSTICS_FLAG, "Input enc M1", OnOff, 2 },
+		{ 3, 0x08, DIAGNOSTICS_FLAG, "Input enc M2", OnOff, 2 },
+		{ 4, 0x01, DIAGNOSTICS_FLAG, "Output M1", OnOff, 2 },
+		{ 4, 0x02, DIAGNOSTICS_FLAG, "Output M2", OnOff, 2 },
+		{ 4, 0x04, DIAGNOSTICS_FLAG, "Output 1", OnOff, 2 },
+		{ 4, 0x08, DIAGNOSTICS_FLAG, "Output 2", OnOff, 2 },
+		{ 4, 0x10, DIAGNOSTICS_FLAG, "Output 3", OnOff, 2 },
+		{ 4, 0x20, DIAGNOSTICS_FLAG, "Output fan", OnOff, 2 },
+		{ 4, 0x40, DIAGNOSTICS_FLAG, "Green light signal", OnOff, 2 },
+		{ 4, 0x80, DIAGNOSTICS_FLAG, "Red light signal", OnOff, 2 },
+		{ 5, 0xFF, DIAGNOSTICS_ENUM, "State halt", HaltStates, std::size(HaltStates) },
+		{ 6, 0x01, DIAGNOSTICS_FLAG, "Input radio 1", OnOff, 2 },
+		{ 6, 0x02, DIAGNOSTICS_FLAG, "Input radio 2", OnOff, 2 },
+		{ 6, 0x04, DIAGNOSTICS_FLAG, "Input radio 3", OnOff, 2 },
+		{ 6, 0x08, DIAGNOSTICS_FLAG, "Input radio 4", OnOff, 2 },
+		{ 7, 0x01, DIAGNOSTICS_FLAG, "Input T4 mode 1/1", OnOff, 2 },
+		{ 7, 0x02, DIAGNOSTICS_FLAG, "Input T4 mode 1/2", OnOff, 2 },
+		{ 7, 0x04, DIAGNOSTICS_FLAG, "Input T4 mode 1/3", OnOff, 2 },
+		{ 7, 0x08, DIAGNOSTICS_FLAG, "Input T4 mode 1/4", OnOff, 2 },
+		{ 8, 0xFF, DIAGNOSTICS_NUMBER, "Input T4 mode 2" },
+		{ 9, 0x01, DIAGNOSTICS_FLAG, "Thermal", OnOff, 2 },
+		{ 9, 0x02, DIAGNOSTICS_FLAG, "Heating", OnOff, 2 },
+		{ 9, 0x04, DIAGNOSTICS_FLAG, "Stand-by", OnOff, 2 },
+		{ 9, 0x08, DIAGNOSTICS_FLAG, "Battery", OnOff, 2 },
+		{ 9, 0x10, DIAGNOSTICS_FLAG, "Power supply requency", Frequency, 2 },
+		{ 9, 0x20, DIAGNOSTICS_FLAG, "Automatic opening", OnOff, 2 },
+		{ 10, 0x01, DIAGNOSTICS_FLAG, "Error positions", OkKo, 2 },
+		{ 10, 0x02, DIAGNOSTICS_FLAG, "Error BlueBus", OkKo, 2 },
+		{ 10, 0x04, DIAGNOSTICS_FLAG, "Error halt", OkKo, 2 },
+		{ 10, 0x08, DIAGNOSTICS_FLAG, "Error function", OkKo, 2 },
+		{ 10, 0x10, DIAGNOSTICS_FLAG, "Error regulations", OkKo, 2 },
+		{ 10, 0x20, DIAGNOSTICS_FLAG, "Error map 1", OkKo, 2 },
+		{ 10, 0x40, DIAGNOSTICS_FLAG, "Error map 2", OkKo, 2 },
+		{ 11, 0xFF, DIAGNOSTICS_ENUM, "State manoeuvre limiter", LimiterStates, std::size(LimiterStates) },
+		{ 12, 0x01, DIAGNOSTICS_FLAG, "Overload output 1", KoOk, 2 },
+		{ 12, 0x02, DIAGNOSTICS_FLAG, "Overload output 2", KoOk, 2 },
+		{ 12, 0x04, DIAGNOSTICS_FLAG, "Overload output 3", KoOk, 2 },
+		{ 12, 0x10, DIAGNOSTICS_FLAG, "Overtravel low enc M1", OnOff, 2 },
+		{ 12, 0x20, DIAGNOSTICS_FLAG, "Overtravel high enc M1", OnOff, 2 },
+		{ 12, 0x40, DIAGNOSTICS_FLAG, "Overtravel low enc M2", OnOff, 2 },
+		{ 12, 0x80, DIAGNOSTICS_FLAG, "Overtravel high enc M2", OnOff, 2 },
+		{ 14, 0x01, DIAGNOSTICS_FLAG, "Input 4", OnOff, 2, nullptr, 1, 14 },
+		{ 14, 0x02, DIAGNOSTICS_FLAG, "Input 5", OnOff, 2, nullptr, 1, 14 },
+		{ 14, 0x04, DIAGNOSTICS_FLAG, "Input 6", OnOff, 2, nullptr, 1, 14 },
+		{ 15, 0x01, DIAGNOSTICS_FLAG, "Output 4", OnOff, 2, nullptr, 1, 14 },
+		{ 15, 0x02, DIAGNOSTICS_FLAG, "Output 5", OnOff, 2, nullptr, 1, 14 },
+		{ 15, 0x04, DIAGNOSTICS_FLAG, "Output 6", OnOff, 2, nullptr, 1, 14 },
+	};
+
+	// DIAG_PAR(0xE2)
+	constexpr T4DiagnosticsField DiagnosticsHardware[] =
+	{
+		{ 0, 0x80, DIAGNOSTICS_WORD, "Work time", nullptr, 0, "s" },
+		{ 2, 0x80, DIAGNOSTICS_WORD, "Pause time", nullptr, 0, "s" },
+		{ 4, 0x80, DIAGNOSTICS_WORD, "Courtesy light", nullptr, 0, "s" },
+		{ 6, 0x80, DIAGNOSTICS_WORD, "Bus average current", nullptr, 0, "%" },
+		{ 8, 0x80, DIAGNOSTICS_WORD, "Service voltage", nullptr, 0, "V" },
+		{ 10, 0x80, DIAGNOSTICS_WORD, "Torque M1", nullptr, 0, "%" },
+		{ 12, 0x80, DIAGNOSTICS_WORD, "Torque M2", nullptr, 0, "%" },
+		{ 14, 0x80, DIAGNOSTICS_WORD, "Temperature", nullptr, 0, "°C" },
+		{ 16, 0x80, DIAGNOSTICS_WORD, "Voltage M1", nullptr, 0, "V" },
+		{ 18, 0x80, DIAGNOSTICS_WORD, "Voltage M2", nullptr, 0, "V" },
+		{ 20, 0x80, DIAGNOSTICS_WORD, "Speed M1", nullptr, 0, "%" },
+		{ 22, 0x80, DIAGNOSTICS_WORD, "Speed M2", nullptr, 0, "%" },
+	};
+}
+
+constexpr T4DiagnosticsBlock T4DiagnosticsBlocks[] =
+{
+	{ 0xE1, "Inputs/Outputs", DiagnosticsIO, std::size(DiagnosticsIO) },
+	{ 0xE2, "Hardware", DiagnosticsHardware, std::size(DiagnosticsHardware) },
+};
+
+const T4DiagnosticsBlock* getDiagnosticsBlock(const uint8_t* commandInfo)
+{
+	for (const auto& block : T4DiagnosticsBlocks)
+	{
+		if (block.type == commandInfo[2])
+			return &block;
+	}
+
+	return nullptr;
+}
+
+void decodeDiagnostics(const T4DiagnosticsBlock& block, const uint8_t* commandInfo, const T4Packet& reply, T4FieldSink& sink)
+{
+	const auto data = reply.message.dmp.data;
+	const auto info = &commandInfo[5];
+	const size_t data_size = reply.header.messageSize - 6;
+
+	for (auto field = block.fields; field < block.fields + block.fieldsCount; ++field)
+	{
+		if (data_size < field->minSize)
+			continue;
+
+		uint8_t offset = field->offset;
+		int32_t value;
+		switch (field->kind)
+		{
+			case DIAGNOSTICS_FLAG:
+				if (!(info[offset] & field->mask))
+					continue;
+				value = (data[offset] & field->mask) ? 1 : 0;
+				break;
+
+			case DIAGNOSTICS_ENUM:
+			case DIAGNOSTICS_NUMBER:
+				if (info[offset] != 0xFF)
+					continue;
+				value = data[offset];
+				break;
+
+			case DIAGNOSTICS_WORD:
+				if (!(info[offset] & field->mask))
+					continue;
+				value = (data[offset] << 8) | data[offset + 1];
+				break;
+
+			default:
+				continue;
+		}
+
+		const char* text = nullptr;
+		if (field->kind == DIAGNOSTICS_ENUM)
+			text = (value < field->stringsCount) ? field->strings[value] : "-";
+		else if (field->strings)
+			text = field->strings[value];
+
+		sink.onField({ field->label, value, text, field->unit, field->scale });
+	}
+}
+
+size_t getParameterSize(const uint8_t* commandInfo)
+{
+	return commandInfo[0] & 0x7F;
+}
+
+const uint8_t* getParameterInfo(const T4Unit& unit, uint8_t command)
+{
+	auto menu_it = std::find_if(unit.menu.begin(), unit.menu.end(), [command](const auto& m) { return (m >> 8) == command; });
+	if (menu_it == unit.menu.end() || (*menu_it & 8))
+		return nullptr;
+
+	auto command_info = unit.commandsInfo[command].get();
+	if (!command_info || (command_info[2] & 0xF0) == 0xE0)
+		return nullptr;
+
+	return command_info;
+}
+
+T4Parameter getParameter(const uint8_t* commandInfo)
+{
+	T4Parameter parameter = {};
+	parameter.size = getParameterSize(commandInfo);
+
+	// function type VIRTUAL_POSITION(0x25) seems to be always in millimeters, don't know why the unit doesn't report correct type info
+	parameter.unit = (commandInfo[1] == 0x25) ? "mm" : T4ValueUnitStrings[commandInfo[2]];
+
+	if (commandInfo[1] == 0x03)
+	{
+		parameter.kind = PARAMETER_TEXT;
+	}
+	else if (commandInfo[3] & 0x40)
+	{
+		auto& list = T4ValueLists[commandInfo[2]];
+		parameter.kind = PARAMETER_LIST;
+		parameter.membersCount = commandInfo[4];
+		parameter.members = &commandInfo[5];
+		parameter.strings = list.strings;
+		parameter.stringsCount = list.count;
+	}
+	else
+	{
+		// min, max and step have the size of the value, scale is a word, all big-endian
+		auto info = &commandInfo[4];
+		auto pop = [&](size_t n)
+		{
+			uint64_t value = 0;
+			while (n-- > 0)
+				value = (value << 8) | *info++;
+			return value;
+		};
+
+		parameter.kind = PARAMETER_RANGE;
+		parameter.min = pop(parameter.size);
+		parameter.max = pop(parameter.size);
+		parameter.step = pop(parameter.size);
+		parameter.scale = pop(sizeof(uint16_t));
+		parameter.divide = commandInfo[3] & 0x10;
+		parameter.multiply = commandInfo[3] & 0x20;
+	}
+
+	return parameter;
+}
+
+T4ParameterError validateParameter(const T4Parameter& parameter, uint64_t value)
+{
+	if (parameter.kind == PARAMETER_TEXT || parameter.size > 32)
+		return PARAMETER_READ_ONLY;
+
+	if (parameter.kind == PARAMETER_LIST)
+	{
+		if (std::find(parameter.members, parameter.members + parameter.membersCount, value) == parameter.members + parameter.membersCount)
+			return PARAMETER_NOT_MEMBER;
+	}
+	else if (parameter.max)
+	{
+		if (value < parameter.min)
+			return PARAMETER_BELOW_MIN;
+		if (value > parameter.max)
+			return PARAMETER_ABOVE_MAX;
+		if (parameter.step && (value - parameter.min) % parameter.step)
+			return PARAMETER_OFF_STEP;
+	}
+	else if (parameter.size < 8 && value > (uint64_t(1) << (8 * parameter.size)) - 1)
+	{
+		// no range reported, the value still has to fit into its field
+		return PARAMETER_ABOVE_MAX;
+	}
+
+	return PARAMETER_VALID;
+}
+
+const char* getParameterErrorString(T4ParameterError error)
+{
+	switch (error)
+	{
+		case PARAMETER_VALID: return "Valid";
+		case PARAMETER_READ_ONLY: return "Parameter is read-only";
+		case PARAMETER_BELOW_MIN: return "Value is below minimum";
+		case PARAMETER_ABOVE_MAX: return "Value is above maximum";
+		case PARAMETER_OFF_STEP: return "Value is not a multiple of the step";
+		case PARAMETER_NOT_MEMBER: return "Value is not in the list";
+	}
+
+	return nullptr;
+}
+
+uint64_t decodeParameter(const uint8_t* commandInfo, const T4Packet& reply)
+{
+	// values are big-endian
+	uint64_t value = 0;
+	for (size_t n = 0; n < getParameterSize(commandInfo); ++n)
+		value = (value << 8) | reply.message.dmp.data[n];
+	return value;
+}
+
+size_t encodeParameter(const uint8_t* commandInfo, uint64_t value, uint8_t* data)
+{
+	size_t size = getParameterSize(commandInfo);
+	for (size_t n = 0; n < size; ++n)
+		data[n] = (size - n - 1 < sizeof(value)) ? uint8_t(value >> ((size - n - 1) * 8)) : 0;
+	return size;
+}
@@ -0,0 +1,132 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <Arduino.h>
+
+#include "t4.h"
+
+// decoded value, shared by the web pages and JSON API
+struct T4Field
+{
+	const char* label;
+	int32_t value;
+	const char* text;		// textual representation of the value, nullptr if it's plain number
+	const char* unit;		// nullptr if the value has no unit
+	uint16_t scale = 1;		// the value is to be divided by the scale
+};
+
+// receiver of decoded values, implemented by each output format (HTML, JSON, metrics)
+class T4FieldSink
+{
+public:
+	virtual void onField(const T4Field& field) = 0;
+};
+
+enum T4DiagnosticsKind : uint8_t
+{
+	DIAGNOSTICS_FLAG,		// bit of data byte, present if the same bit of info byte is set, strings are { off, on }
+	DIAGNOSTICS_ENUM,		// whole data byte, present if info byte is 0xFF, strings are indexed by the value
+	DIAGNOSTICS_NUMBER,		// whole data byte, present if info byte is 0xFF
+	DIAGNOSTICS_WORD,		// big-endian word, present if the mask is set in the first info byte
+};
+
+struct T4DiagnosticsField
+{
+	uint8_t offset;
+	uint8_t mask;
+	T4DiagnosticsKind kind;
+	const char* label;
+	const char* const* strings = nullptr;
+	uint8_t stringsCount = 0;
+	const char* unit = nullptr;
+	uint16_t scale = 1;
+
+	// minimal size of the data, for fields added in later versions of the units
+	uint8_t minSize = 0;
+};
+
+struct T4DiagnosticsBlock
+{
+	uint8_t type;
+	const char* title;
+	const T4DiagnosticsField* fields;
+	size_t fieldsCount;
+};
+
+const char* getAutomationStatusString(uint8_t status);
+const char* getManoeuvreStatusString(uint8_t status);
+
+// CTRL_AUTOMATION_STATUS(0x01)
+void decodeStatus(const T4Packet& reply, T4FieldSink& sink);
+
+// returns nullptr if the diagnostics block is not supported
+const T4DiagnosticsBlock* getDiagnosticsBlock(const uint8_t* commandInfo);
+void decodeDiagnostics(const T4DiagnosticsBlock& block, const uint8_t* commandInfo, const T4Packet& reply, T4FieldSink& sink);
+
+enum T4ParameterKind : uint8_t
+{
+	PARAMETER_RANGE,
+	PARAMETER_LIST,
+	PARAMETER_TEXT,
+};
+
+// typed descriptor of the parameter, decoded from its command info
+struct T4Parameter
+{
+	T4ParameterKind kind;
+	uint8_t size;
+	const char* unit;
+
+	// PARAMETER_RANGE, max 0 means the unit doesn't report the range
+	uint64_t min;
+	uint64_t max;
+	uint64_t step;
+	uint16_t scale;
+	bool divide;
+	bool multiply;
+
+	// PARAMETER_LIST, values supported by the unit and strings indexed by the value
+	const uint8_t* members;
+	uint8_t membersCount;
+	const char* const* strings;
+	size_t stringsCount;
+
+	const char* getString(uint64_t value) const { return (value < stringsCount) ? strings[value] : nullptr; }
+};
+
+enum T4ParameterError : uint8_t
+{
+	PARAMETER_VALID,
+	PARAMETER_READ_ONLY,
+	PARAMETER_BELOW_MIN,
+	PARAMETER_ABOVE_MAX,
+	PARAMETER_OFF_STEP,
+	PARAMETER_NOT_MEMBER,
+};
+
+// command info of the parameter, or nullptr if the menu item is a group or diagnostics
+const uint8_t* getParameterInfo(const T4Unit& unit, uint8_t command);
+size_t getParameterSize(const uint8_t* commandInfo);
+T4Parameter getParameter(const uint8_t* commandInfo);
+T4ParameterError validateParameter(const T4Parameter& parameter, uint64_t value);
+const char* getParameterErrorString(T4ParameterError error);
+uint64_t decodeParameter(const uint8_t* commandInfo, const T4Packet& reply);
+size_t encodeParameter(const uint8_t* commandInfo, uint64_t value, uint8_t* data);
+
+#endif
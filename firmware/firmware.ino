@@ -16,34 +16,29 @@
 
 #include <Arduino.h>
 #include <ArduinoOTA.h>
-#include <AsyncUDP.h>
-#include <WebServer.h>
+#include <WiFi.h>
 
 #include "t4.h"
+#include "analyzer.h"
+#include "recorder.h"
+#include "proxy.h"
+#include "bridge.h"
+#include "watchdog.h"
 #include "wireless.h"
 #include "web.h"
+#include "boot.h"
 
 const int RESET_BUTTON = 5;
 
 T4Client t4(Serial2);
-AsyncUDP udp;
+T4Analyzer analyzer;
+T4Recorder recorder(t4);
+T4Proxy proxy(t4);
+T4Bridge bridge(t4);
+T4Watchdog watchdog(t4);
 
-void onT4Packet(T4Packet& t4Packet)
-{
-	if (udp)
-		udp.broadcast(t4Packet.data, t4Packet.packetSize);
-}
-
-void onUDPPacket(AsyncUDPPacket& udpPacket)
-{
-	if (udpPacket.length() == 5 && !memcmp(udpPacket.data(), "RESET", 5))
-		ESP.restart();
-
-	T4Packet t4_packet;
-	t4_packet.packetSize = udpPacket.length();
-	memcpy(t4_packet.data, udpPacket.data(), udpPacket.length());
-	t4.send(t4_packet);
-}
+volatile bool otaStarted = false;
+volatile bool httpListening = false;
 
 void IRAM_ATTR resetButtonHandler()
 {
@@ -58,25 +53,47 @@ void setup()
 
 	Serial.begin(115200);
 	Serial2.begin(19200, SERIAL_8N1, 18, 21);
+	bootMark(BOOT_UART);
 
-	t4.setCallback(onT4Packet);
+	analyzer.init();
+
+	t4.setAnalyzer(&analyzer);
 	t4.init();
 
-	wifiInit();
+	recorder.init();
+
+	// OTA needs mDNS, which can't be started without network
+	wifiOnConnected([]()
+	{
+		if (!otaStarted)
+			ArduinoOTA.begin();
+		otaStarted = true;
+	});
 
-	if (udp.listen(5090))
-		udp.onPacket(onUDPPacket);
+	// HTTP is ready for clients once the server listens and the module has an address, whichever comes last
+	wifiOnConnected([]()
+	{
+		if (httpListening)
+			bootMark(BOOT_HTTP_READY);
+	});
 
-	ArduinoOTA.begin();
+	// Wi-Fi connects in background, the services listen on any address, so they work once it's connected
+	wifiInit();
+
+	proxy.init(5090);
+	bridge.init(5091);
+	watchdog.init();
 
 	webServerInit();
+	httpListening = true;
+	if (WiFi.isConnected())
+		bootMark(BOOT_HTTP_READY);
 }
 
 void loop()
 {
-	ArduinoOTA.handle();
-
-	webServerHandle();
+	if (otaStarted)
+		ArduinoOTA.handle();
 
 	vTaskDelay(2);
 }
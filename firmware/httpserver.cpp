@@ -0,0 +1,487 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <lwip/sockets.h>
+#include <mbedtls/base64.h>
+
+#include "httpserver.h"
+
+// limits of the concurrency and of memory taken by each connection
+const size_t MAX_CONNECTIONS = 8;
+const size_t MAX_BODY_SIZE = 2048;
+
+// the body is read by the server task, so a client trickling or stalling it must not hold the task longer than this (in milliseconds)
+const uint32_t BODY_TIMEOUT = 5000;
+
+const char* statusText(int code)
+{
+	switch (code)
+	{
+		case 200: return "200 OK";
+		case 204: return "204 No Content";
+		case 303: return "303 See Other";
+		case 304: return "304 Not Modified";
+		case 400: return "400 Bad Request";
+		case 401: return "401 Unauthorized";
+		case 403: return "403 Forbidden";
+		case 404: return "404 Not Found";
+		case 408: return "408 Request Timeout";
+		case 409: return "409 Conflict";
+		case 413: return "413 Payload Too Large";
+		case 422: return "422 Unprocessable Entity";
+		case 429: return "429 Too Many Requests";
+		case 502: return "502 Bad Gateway";
+		case 503: return "503 Service Unavailable";
+		case 504: return "504 Gateway Timeout";
+	}
+
+	return "500 Internal Server Error";
+}
+
+String urlDecode(const char* text, size_t size)
+{
+	String decoded;
+	decoded.reserve(size);
+
+	for (size_t n = 0; n < size; ++n)
+	{
+		char c = text[n];
+		if (c == '+')
+		{
+			c = ' ';
+		}
+		else if (c == '%' && n + 2 < size && isxdigit(text[n + 1]) && isxdigit(text[n + 2]))
+		{
+			char hex[3] = { text[n + 1], text[n + 2], 0 };
+			c = strtol(hex, nullptr, 16);
+			n += 2;
+		}
+		decoded += c;
+	}
+
+	return decoded;
+}
+
+void parseArgs(const char* text, std::vector<std::pair<String, String>>& args)
+{
+	while (*text)
+	{
+		const char* end = strchrnul(text, '&');
+		const char* equal = (const char*)memchr(text, '=', end - text);
+		if (equal)
+			args.emplace_back(urlDecode(text, equal - text), urlDecode(equal + 1, end - equal - 1));
+		else if (end != text)
+			args.emplace_back(urlDecode(text, end - text), String());
+
+		text = *end ? end + 1 : end;
+	}
+}
+
+bool HttpRequest::parse(const std::vector<const char*>& headers)
+{
+	m_uri = m_req->uri;
+	int query = m_uri.indexOf('?');
+	if (query >= 0)
+		m_uri.remove(query);
+
+	struct sockaddr_storage address;
+	socklen_t address_size = sizeof(address);
+	if (!getpeername(httpd_req_to_sockfd(m_req), (struct sockaddr*)&address, &address_size))
+	{
+		if (address.ss_family == AF_INET)
+		{
+			m_remoteIP = IPAddress(((struct sockaddr_in*)&address)->sin_addr.s_addr);
+		}
+		else if (address.ss_family == AF_INET6)
+		{
+			// IPv4 clients of IPv6 socket are mapped to ::FFFF:a.b.c.d, other IPv6 clients are left at 0.0.0.0 so they're never local
+			static const uint8_t v4_mapped[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF };
+			auto ipv6 = ((struct sockaddr_in6*)&address)->sin6_addr.s6_addr;
+			if (!memcmp(ipv6, v4_mapped, sizeof(v4_mapped)))
+			{
+				uint32_t ipv4;
+				memcpy(&ipv4, &ipv6[12], sizeof(ipv4));
+				m_remoteIP = IPAddress(ipv4);
+			}
+		}
+	}
+
+	size_t query_size = httpd_req_get_url_query_len(m_req);
+	if (query_size)
+	{
+		auto query_text = std::make_unique<char[]>(query_size + 1);
+		if (httpd_req_get_url_query_str(m_req, query_text.get(), query_size + 1) == ESP_OK)
+			parseArgs(query_text.get(), m_args);
+	}
+
+	for (auto name : headers)
+	{
+		size_t value_size = httpd_req_get_hdr_value_len(m_req, name);
+		if (!value_size)
+			continue;
+
+		auto value = std::make_unique<char[]>(value_size + 1);
+		if (httpd_req_get_hdr_value_str(m_req, name, value.get(), value_size + 1) == ESP_OK)
+			m_headers.emplace_back(name, value.get());
+	}
+
+	if (m_req->content_len)
+	{
+		if (m_req->content_len > MAX_BODY_SIZE)
+		{
+			send(413, "text/plain", "Payload too large");
+			return false;
+		}
+
+		auto body = std::make_unique<char[]>(m_req->content_len + 1);
+		size_t received = 0;
+		uint32_t start = millis();
+		while (received < m_req->content_len)
+		{
+			if (millis() - start > BODY_TIMEOUT)
+			{
+				send(408, "text/plain", "Request timeout");
+				return false;
+			}
+
+			int size = httpd_req_recv(m_req, &body[received], m_req->content_len - received);
+			if (size == HTTPD_SOCK_ERR_TIMEOUT)
+				continue;
+			if (size <= 0)
+				return false;
+			received += size;
+		}
+		body[received] = 0;
+
+		// form data are merged with query arguments, anything else is passed as "plain" argument (which may be binary)
+		if (header("Content-Type").startsWith("application/x-www-form-urlencoded"))
+			parseArgs(body.get(), m_args);
+		else
+			m_args.emplace_back("plain", String(body.get(), received));
+	}
+
+	return true;
+}
+
+bool HttpRequest::hasArg(const String& name) const
+{
+	return std::any_of(m_args.begin(), m_args.end(), [&name](const auto& a) { return a.first == name; });
+}
+
+String HttpRequest::arg(const String& name) const
+{
+	auto it = std::find_if(m_args.begin(), m_args.end(), [&name](const auto& a) { return a.first == name; });
+	return (it != m_args.end()) ? it->second : String();
+}
+
+String HttpRequest::pathArg(unsigned n) const
+{
+	// only a single wildcard at the end of the route is supported
+	if (n || !m_route.uri.endsWith("*"))
+		return String();
+	return m_uri.substring(m_route.uri.length() - 1);
+}
+
+String HttpRequest::header(const String& name) const
+{
+	auto it = std::find_if(m_headers.begin(), m_headers.end(), [&name](const auto& h) { return h.first.equalsIgnoreCase(name); });
+	return (it != m_headers.end()) ? it->second : String();
+}
+
+String HttpRequest::cookie(const char* name) const
+{
+	String cookies = header("Cookie");
+	size_t name_size = strlen(name);
+
+	// cookies are separated by "; "
+	for (int start = 0; start < int(cookies.length()); )
+	{
+		while (cookies[start] == ' ')
+			start++;
+
+		int end = cookies.indexOf(';', start);
+		if (end < 0)
+			end = cookies.length();
+
+		if (cookies.substring(start, start + name_size) == name && cookies[start + name_size] == '=')
+			return cookies.substring(start + name_size + 1, end);
+
+		start = end + 1;
+	}
+
+	return String();
+}
+
+bool HttpRequest::getBasicCredentials(String& login, String& password) const
+{
+	String authorization = header("Authorization");
+	if (!authorization.startsWith("Basic "))
+		return false;
+
+	uint8_t credentials[128];
+	size_t credentials_size = 0;
+	if (mbedtls_base64_decode(credentials, sizeof(credentials) - 1, &credentials_size, (const uint8_t*)authorization.c_str() + 6, authorization.length() - 6))
+		return false;
+	credentials[credentials_size] = 0;
+
+	auto colon = strchr((const char*)credentials, ':');
+	if (!colon)
+		return false;
+
+	login = String((const char*)credentials, colon - (const char*)credentials);
+	password = colon + 1;
+	return true;
+}
+
+void HttpRequest::requestAuthentication()
+{
+	sendHeader("WWW-Authenticate", "Basic realm=\"Login Required\"");
+	send(401, "text/plain", "Unauthorized");
+}
+
+void HttpRequest::sendHeader(const String& name, const String& value)
+{
+	if (m_responseHeadersCount >= HttpMaxResponseHeaders)
+		return;
+
+	m_responseHeaders[m_responseHeadersCount][0] = name;
+	m_responseHeaders[m_responseHeadersCount][1] = value;
+	m_responseHeadersCount++;
+}
+
+void HttpRequest::setStatus(int code, const char* contentType)
+{
+	httpd_resp_set_status(m_req, statusText(code));
+	httpd_resp_set_type(m_req, contentType);
+	for (size_t n = 0; n < m_responseHeadersCount; ++n)
+		httpd_resp_set_hdr(m_req, m_responseHeaders[n][0].c_str(), m_responseHeaders[n][1].c_str());
+}
+
+void HttpRequest::send(int code, const char* contentType, const char* content, size_t size)
+{
+	if (m_responded)
+		return;
+
+	setStatus(code, contentType);
+	httpd_resp_send(m_req, content, size);
+	m_responded = true;
+}
+
+bool HttpRequest::sendChunk(int code, const char* contentType, const char* data, size_t size)
+{
+	if (m_responded && !m_chunked)
+		return false;
+
+	if (!m_chunked)
+	{
+		setStatus(code, contentType);
+		m_responded = true;
+		m_chunked = true;
+	}
+
+	return httpd_resp_send_chunk(m_req, data, size) == ESP_OK;
+}
+
+void HttpRequest::endChunks(int code, const char* contentType)
+{
+	if (m_responded && !m_chunked)
+		return;
+
+	if (!m_chunked)
+		setStatus(code, contentType);
+
+	httpd_resp_send_chunk(m_req, nullptr, 0);
+	m_responded = true;
+	m_chunked = false;
+}
+
+void HttpRequest::finish()
+{
+	if (!m_responded)
+		send(500, "text/plain", "Error");
+}
+
+void HttpServer::on(const String& uri, httpd_method_t method, HttpHandler handler, bool async)
+{
+	m_routes.emplace_back(new HttpRoute{ this, uri, method, handler, async });
+}
+
+void HttpServer::collectHeaders(const char* const* headers, size_t count)
+{
+	m_headers.insert(m_headers.end(), headers, headers + count);
+}
+
+void HttpServer::begin(uint16_t port)
+{
+	m_mutex = createMutex(m_mutexBuffer);
+	m_queue = createQueue(m_queueBuffer);
+
+	for (auto& buffer : m_workerTaskBuffers)
+		createTask(workerTaskThunk, buffer, this, nullptr);
+
+	httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+	config.server_port = port;
+	config.stack_size = TASK_HTTP_SERVER.stackSize;
+	config.task_priority = TASK_HTTP_SERVER.priority;
+	config.core_id = TASK_HTTP_SERVER.core;
+	config.max_open_sockets = MAX_CONNECTIONS;
+	config.max_uri_handlers = m_routes.size();
+	config.lru_purge_enable = true;
+	config.recv_wait_timeout = 1;
+	config.uri_match_fn = httpd_uri_match_wildcard;
+
+	if (httpd_start(&m_server, &config) != ESP_OK)
+		return;
+
+	for (auto& route : m_routes)
+	{
+		httpd_uri_t uri = {};
+		uri.uri = route->uri.c_str();
+		uri.method = route->method;
+		uri.handler = dispatch;
+		uri.user_ctx = route.get();
+		httpd_register_uri_handler(m_server, &uri);
+	}
+}
+
+esp_err_t HttpServer::dispatch(httpd_req_t* req)
+{
+	auto route = (const HttpRoute*)req->user_ctx;
+	auto server = route->server;
+	uint32_t start = micros();
+
+	auto request = std::make_unique<HttpRequest>(req, *route);
+	if (!request->parse(server->m_headers))
+	{
+		request->finish();
+		server->complete(start);
+		return ESP_OK;
+	}
+
+	if (!route->async)
+	{
+		route->handler(*request);
+		request->finish();
+		server->complete(start);
+		return ESP_OK;
+	}
+
+	// the request is detached from the server task and queued until a worker is free, the worker then runs the handler
+	// to the end, including its wait for the bus
+	httpd_req_t* async_req = nullptr;
+	if (httpd_req_async_handler_begin(req, &async_req) == ESP_OK)
+	{
+		request->attach(async_req);
+
+		HttpJob job = { request.get(), start };
+		if (xQueueSend(server->m_queue, &job, 0))
+		{
+			if (xSemaphoreTake(server->m_mutex, portMAX_DELAY))
+			{
+				server->m_pending++;
+				xSemaphoreGive(server->m_mutex);
+			}
+
+			request.release();
+			return ESP_OK;
+		}
+
+		request->attach(req);
+		httpd_req_async_handler_complete(async_req);
+	}
+
+	if (xSemaphoreTake(server->m_mutex, portMAX_DELAY))
+	{
+		server->m_rejected++;
+		xSemaphoreGive(server->m_mutex);
+	}
+
+	request->send(503, "text/plain", "Server busy");
+	return ESP_OK;
+}
+
+void HttpServer::workerTask()
+{
+	for (;;)
+	{
+		HttpJob job;
+		if (!xQueueReceive(m_queue, &job, portMAX_DELAY))
+			continue;
+
+		if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+		{
+			m_pending--;
+			xSemaphoreGive(m_mutex);
+		}
+
+		std::unique_ptr<HttpRequest> request(job.request);
+
+		request->getRoute().handler(*request);
+		request->finish();
+
+		httpd_req_async_handler_complete(request->getHandle());
+		complete(job.start);
+	}
+}
+
+void HttpServer::complete(uint32_t start)
+{
+	uint32_t latency = micros() - start;
+
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	m_requests++;
+	m_latency[m_latencyNext] = { uint32_t(millis()), latency };
+	m_latencyNext = (m_latencyNext + 1) % HttpLatencySamples;
+
+	xSemaphoreGive(m_mutex);
+}
+
+void HttpServer::getStats(HttpStats& stats)
+{
+	auto latency = std::make_unique<uint32_t[]>(HttpLatencySamples);
+	size_t count = 0;
+	size_t recent = 0;
+
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	uint32_t now = millis();
+	for (const auto& sample : m_latency)
+	{
+		if (!sample.time)
+			continue;
+
+		latency[count++] = sample.latency;
+		if (now - sample.time < 10000)
+			recent++;
+	}
+
+	stats.requests = m_requests;
+	stats.rejected = m_rejected;
+	stats.pending = m_pending;
+
+	xSemaphoreGive(m_mutex);
+
+	// requests completed in the last 10 seconds, limited by the number of samples kept
+	stats.rate = recent / 10.0f;
+
+	std::sort(latency.get(), latency.get() + count);
+	stats.latency50 = count ? latency[count * 50 / 100] : 0;
+	stats.latency99 = count ? latency[count * 99 / 100] : 0;
+	stats.latencyMax = count ? latency[count - 1] : 0;
+}
@@ -0,0 +1,164 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <Arduino.h>
+#include <esp_http_server.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "tasks.h"
+
+class HttpServer;
+class HttpRequest;
+
+typedef std::function<void(HttpRequest& request)> HttpHandler;
+
+struct HttpRoute
+{
+	HttpServer* server;
+	String uri;
+	httpd_method_t method;
+	HttpHandler handler;
+
+	// asynchronous handlers are run by the workers, so their wait for the bus blocks the worker, not the server task and other connections
+	bool async;
+};
+
+constexpr size_t HttpMaxResponseHeaders = 6;
+
+class HttpRequest
+{
+public:
+	HttpRequest(httpd_req_t* req, const HttpRoute& route) : m_req(req), m_route(route) {}
+
+	// reads the query, headers and body, the request is answered and false returned if it exceeds the limits
+	bool parse(const std::vector<const char*>& headers);
+	void attach(httpd_req_t* req) { m_req = req; }
+	httpd_req_t* getHandle() const { return m_req; }
+	const HttpRoute& getRoute() const { return m_route; }
+
+	const String& uri() const { return m_uri; }
+	httpd_method_t method() const { return m_route.method; }
+	IPAddress remoteIP() const { return m_remoteIP; }
+
+	size_t args() const { return m_args.size(); }
+	const String& argName(size_t n) const { return m_args[n].first; }
+	const String& arg(size_t n) const { return m_args[n].second; }
+	bool hasArg(const String& name) const;
+	String arg(const String& name) const;
+	String pathArg(unsigned n) const;
+	String header(const String& name) const;
+	String cookie(const char* name) const;
+
+	bool getBasicCredentials(String& login, String& password) const;
+	void requestAuthentication();
+
+	void sendHeader(const String& name, const String& value);
+	void send(int code, const char* contentType, const char* content, size_t size);
+	void send(int code, const char* contentType, const String& content) { send(code, contentType, content.c_str(), content.length()); }
+
+	// chunked response, status and headers are sent with the first chunk
+	bool sendChunk(int code, const char* contentType, const char* data, size_t size);
+	void endChunks(int code, const char* contentType);
+
+	// answers the request if the handler didn't
+	void finish();
+
+private:
+	void setStatus(int code, const char* contentType);
+
+	httpd_req_t* m_req;
+	const HttpRoute& m_route;
+
+	String m_uri;
+	IPAddress m_remoteIP;
+	std::vector<std::pair<String, String>> m_args;
+	std::vector<std::pair<String, String>> m_headers;
+
+	// httpd keeps only pointers to the response headers, so they have to live until the response is sent
+	String m_responseHeaders[HttpMaxResponseHeaders][2];
+	size_t m_responseHeadersCount = 0;
+
+	bool m_responded = false;
+	bool m_chunked = false;
+};
+
+// request waiting for a worker
+struct HttpJob
+{
+	HttpRequest* request;
+	uint32_t start;
+};
+
+struct HttpStats
+{
+	uint32_t requests;
+	uint32_t rejected;
+	uint32_t pending;
+	float rate;
+
+	// latency of the recent requests (in microseconds)
+	uint32_t latency50;
+	uint32_t latency99;
+	uint32_t latencyMax;
+};
+
+constexpr size_t HttpLatencySamples = 256;
+
+class HttpServer
+{
+public:
+	void on(const String& uri, httpd_method_t method, HttpHandler handler, bool async = true);
+	void collectHeaders(const char* const* headers, size_t count);
+	void begin(uint16_t port);
+
+	void workerTask();
+	static void workerTaskThunk(void* self) { ((HttpServer*)self)->workerTask(); }
+
+	void getStats(HttpStats& stats);
+
+private:
+	static esp_err_t dispatch(httpd_req_t* req);
+	void complete(uint32_t start);
+
+	httpd_handle_t m_server = nullptr;
+
+	std::vector<std::unique_ptr<HttpRoute>> m_routes;
+	std::vector<const char*> m_headers = { "Authorization", "Content-Type", "Cookie" };
+
+	QueueHandle_t m_queue = nullptr;
+	QueueBuffer<HttpJob, QUEUE_HTTP_JOBS> m_queueBuffer;
+	SemaphoreHandle_t m_mutex = nullptr;
+	MutexBuffer m_mutexBuffer;
+	TaskBuffer<TASK_HTTP_WORKER> m_workerTaskBuffers[HTTP_WORKERS];
+
+	uint32_t m_requests = 0;
+	uint32_t m_rejected = 0;
+	uint32_t m_pending = 0;
+
+	struct
+	{
+		uint32_t time;
+		uint32_t latency;
+	} m_latency[HttpLatencySamples] = {};
+	size_t m_latencyNext = 0;
+};
+
+#endif
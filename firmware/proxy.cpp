@@ -0,0 +1,475 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Preferences.h>
+
+#include "proxy.h"
+
+// frames are batched until the first one is this old or the datagram is full
+const uint32_t BATCH_TIME = 20;
+
+// requests and echoes are limited to RPC_RATE per second, with bursts up to RPC_BURST of them
+const uint32_t RPC_RATE = 5;
+const uint32_t RPC_BURST = 10;
+
+void T4Proxy::init(uint16_t port)
+{
+	Preferences prefs;
+	if (prefs.begin("proxy", true))
+	{
+		m_batch = prefs.getBool("batch");
+		m_broadcast = prefs.getBool("broadcast", true);
+		prefs.end();
+	}
+
+	m_queue = createQueue(m_queueBuffer);
+	m_rpcQueue = createQueue(m_rpcQueueBuffer);
+	m_mutex = createMutex(m_mutexBuffer);
+
+	m_rpcTokens = RPC_BURST;
+	m_rpcTokensTime = millis();
+
+	createTask(proxyTaskThunk, m_proxyTaskBuffer, this, &m_proxyTaskHandle);
+	createTask(rpcTaskThunk, m_rpcTaskBuffer, this, &m_rpcTaskHandle);
+
+	// sending to the network may block, so the frames are passed through the queue to the proxy task
+	m_client.subscribe("proxy", m_queue);
+
+	if (m_udp.listen(port))
+		m_udp.onPacket([this](AsyncUDPPacket& udpPacket) { onUDPPacket(udpPacket); });
+}
+
+// wire format of the filter to the filter of the bus subscriptions
+T4Filter toFilter(const T4ProxyFilter& proxyFilter)
+{
+	T4Filter filter;
+	filter.source = proxyFilter.source;
+	filter.destination = proxyFilter.destination;
+	filter.device = proxyFilter.device;
+	filter.command = proxyFilter.command;
+
+	if (proxyFilter.mask & FILTER_SOURCE)
+		filter.mask |= T4Filter::SOURCE;
+	if (proxyFilter.mask & FILTER_DESTINATION)
+		filter.mask |= T4Filter::DESTINATION;
+	if (proxyFilter.mask & FILTER_DEVICE)
+		filter.mask |= T4Filter::DEVICE;
+	if (proxyFilter.mask & FILTER_COMMAND)
+		filter.mask |= T4Filter::COMMAND;
+	return filter;
+}
+
+void T4Proxy::setConfig(bool batch, bool broadcast)
+{
+	// the datagram isn't authenticated, so anyone may repeat it, NVS is written only when the settings change
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	bool changed = (batch != m_batch || broadcast != m_broadcast);
+	m_batch = batch;
+	m_broadcast = broadcast;
+
+	// the proxy task forwards packets under the mutex, so it never sees just one of the settings changed
+	xSemaphoreGive(m_mutex);
+
+	if (!changed)
+		return;
+
+	Preferences prefs;
+	if (prefs.begin("proxy"))
+	{
+		prefs.putBool("batch", batch);
+		prefs.putBool("broadcast", broadcast);
+		prefs.end();
+	}
+}
+
+size_t T4Proxy::getSubscribersCount()
+{
+	size_t count = 0;
+
+	if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+	{
+		uint32_t now = millis();
+		for (auto& subscription : m_subscriptions)
+			count += isActive(subscription, now);
+
+		xSemaphoreGive(m_mutex);
+	}
+
+	return count;
+}
+
+bool T4Proxy::isActive(T4ProxyStream& stream, uint32_t now)
+{
+	if (!stream.port)
+		return false;
+
+	if (int32_t(stream.expiration - now) <= 0)
+	{
+		// lease expired
+		stream.port = 0;
+		return false;
+	}
+
+	return true;
+}
+
+// frames are sent to matching subscribers only, broadcast is used when nobody has subscribed (if it's enabled)
+void T4Proxy::forward(const T4Packet& packet, uint32_t now)
+{
+	bool subscribed = false;
+	for (auto& subscription : m_subscriptions)
+	{
+		if (!isActive(subscription, now))
+			continue;
+
+		subscribed = true;
+		if (!subscription.matcher.match(packet))
+			continue;
+
+		if (m_batch)
+			append(subscription, packet);
+		else
+			m_udp.writeTo(packet.data, packet.packetSize, subscription.address, subscription.port);
+	}
+
+	if (subscribed || !m_broadcast)
+		return;
+
+	if (m_batch)
+		append(m_broadcastStream, packet);
+	else
+		m_udp.broadcast((uint8_t*)packet.data, packet.packetSize);
+}
+
+void T4Proxy::onUDPPacket(AsyncUDPPacket& udpPacket)
+{
+	if (udpPacket.length() == 5 && !memcmp(udpPacket.data(), "RESET", 5))
+		ESP.restart();
+
+	if (udpPacket.length() >= sizeof(T4ProxyHeader) && !memcmp(udpPacket.data(), "T4", 2))
+	{
+		auto header = (const T4ProxyHeader*)udpPacket.data();
+		auto payload = udpPacket.data() + sizeof(T4ProxyHeader);
+		size_t payload_size = udpPacket.length() - sizeof(T4ProxyHeader);
+
+		switch (header->type)
+		{
+			case PROXY_CONFIG:
+				if (payload_size >= 1)
+					setConfig(payload[0], (payload_size >= 2) ? payload[1] : m_broadcast.load());
+				break;
+
+			case PROXY_SUBSCRIBE:
+				if (payload_size >= sizeof(T4ProxySubscribe))
+				{
+					T4ProxySubscribe subscription;
+					memcpy(&subscription, payload, sizeof(subscription));
+					subscribe(udpPacket, subscription);
+				}
+				break;
+
+			case PROXY_UNSUBSCRIBE:
+				if (payload_size >= sizeof(uint16_t))
+				{
+					uint16_t port;
+					memcpy(&port, payload, sizeof(port));
+					unsubscribe(udpPacket.remoteIP(), port ? port : udpPacket.remotePort());
+				}
+				break;
+
+			case PROXY_REQUEST:
+				request(udpPacket, header->sequence, payload, payload_size);
+				break;
+
+			case PROXY_ECHO:
+				// for measurement of round-trip time, limited like requests, the source address may be forged to reflect the datagram elsewhere
+				if (takeToken())
+					m_udp.writeTo(udpPacket.data(), udpPacket.length(), udpPacket.remoteIP(), udpPacket.remotePort());
+				break;
+		}
+
+		return;
+	}
+
+	// raw packet, fire and forget
+	T4Packet t4_packet;
+	if (udpPacket.length() < 3 || udpPacket.length() > sizeof(t4_packet.data))
+		return;
+
+	t4_packet.size = udpPacket.length();
+	memcpy(t4_packet.data, udpPacket.data(), udpPacket.length());
+	m_client.send(t4_packet);
+}
+
+bool T4Proxy::takeToken()
+{
+	// refill the token bucket
+	uint32_t now = millis();
+	uint32_t tokens = (now - m_rpcTokensTime) * RPC_RATE / 1000;
+	if (tokens)
+	{
+		m_rpcTokens = std::min(m_rpcTokens + tokens, RPC_BURST);
+		m_rpcTokensTime += tokens * 1000 / RPC_RATE;
+	}
+
+	if (!m_rpcTokens)
+		return false;
+	m_rpcTokens--;
+	return true;
+}
+
+void T4Proxy::request(AsyncUDPPacket& udpPacket, uint32_t correlation, const uint8_t* payload, size_t payloadSize)
+{
+	IPAddress address = udpPacket.remoteIP();
+	uint16_t port = udpPacket.remotePort();
+
+	T4ProxyRPC rpc;
+	if (payloadSize < sizeof(rpc.request) || payloadSize - sizeof(rpc.request) > sizeof(rpc.message))
+		return reply(address, port, correlation, RPC_INVALID);
+
+	rpc.address = address;
+	rpc.port = port;
+	rpc.correlation = correlation;
+	memcpy(&rpc.request, payload, sizeof(rpc.request));
+	rpc.messageSize = payloadSize - sizeof(rpc.request);
+	memcpy(rpc.message, payload + sizeof(rpc.request), rpc.messageSize);
+
+	// message must contain device and command at least, DMP message also flags, sequence and status
+	bool valid = (rpc.request.packetType == 0x55 || rpc.request.packetType == 0xF0);
+	if (rpc.request.protocol == DMP)
+		valid &= (rpc.messageSize >= 5);
+	else if (rpc.request.protocol == DEP)
+		valid &= (rpc.messageSize >= 2);
+	else
+		valid = false;
+
+	if (!valid)
+		return reply(address, port, correlation, RPC_INVALID);
+
+	rpc.request.retry = std::min<uint8_t>(rpc.request.retry, 5);
+	rpc.request.timeout = std::clamp<uint16_t>(rpc.request.timeout, 50, 2000);
+
+	if (!takeToken())
+		return reply(address, port, correlation, RPC_RATE_LIMITED);
+
+	if (!xQueueSend(m_rpcQueue, &rpc, 0))
+		return reply(address, port, correlation, RPC_BUSY);
+}
+
+void T4Proxy::reply(const IPAddress& address, uint16_t port, uint32_t correlation, uint8_t status, const T4Packet* packet)
+{
+	uint8_t reply[sizeof(T4ProxyHeader) + 1 + sizeof(packet->data)];
+	T4ProxyHeader header = { { 'T', '4' }, PROXY_REPLY, 0, correlation };
+	memcpy(reply, &header, sizeof(header));
+	reply[sizeof(header)] = status;
+
+	size_t reply_size = sizeof(header) + 1;
+	if (packet)
+	{
+		memcpy(reply + reply_size, packet->data, packet->size);
+		reply_size += packet->size;
+	}
+
+	m_udp.writeTo(reply, reply_size, address, port);
+}
+
+void T4Proxy::rpcTask()
+{
+	T4ProxyRPC rpc;
+	T4Packet packet;
+
+	while (xQueueReceive(m_rpcQueue, &rpc, portMAX_DELAY))
+	{
+		// broadcast address stands for the control unit found by the scan
+		T4Source to = rpc.request.to;
+		if (to == T4BroadcastAddress && m_client.lockUnit())
+		{
+			to = m_client.getUnit().source;
+			m_client.unlockUnit();
+		}
+
+		bool ok = m_client.sendRequest(rpc.request.packetType, to, T4ThisAddress, rpc.request.protocol, rpc.message, rpc.messageSize, &packet, rpc.request.retry, rpc.request.timeout);
+		reply(rpc.address, rpc.port, rpc.correlation, ok ? RPC_OK : RPC_TIMEOUT, ok ? &packet : nullptr);
+	}
+
+	m_rpcTaskHandle = nullptr;
+	vTaskDelete(nullptr);
+}
+
+void T4Proxy::subscribe(AsyncUDPPacket& udpPacket, const T4ProxySubscribe& subscribe)
+{
+	IPAddress address = udpPacket.remoteIP();
+	uint16_t port = subscribe.port ? subscribe.port : udpPacket.remotePort();
+	uint16_t lease = std::min(subscribe.lease, T4ProxyMaxLease);
+
+	if (!lease)
+		return unsubscribe(address, port);
+
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	// renew the existing subscription or take a free slot
+	uint32_t now = millis();
+	T4ProxyStream* stream = nullptr;
+	for (auto& subscription : m_subscriptions)
+	{
+		if (isActive(subscription, now))
+		{
+			if (subscription.address == address && subscription.port == port)
+			{
+				stream = &subscription;
+				break;
+			}
+		}
+		else if (!stream)
+		{
+			stream = &subscription;
+		}
+	}
+
+	if (stream)
+	{
+		if (!stream->port)
+		{
+			stream->address = address;
+			stream->port = port;
+			stream->sequence = 0;
+			stream->batchSize = 0;
+			stream->batchCount = 0;
+		}
+		stream->expiration = now + lease * 1000;
+		stream->matcher = T4Matcher(toFilter(subscribe.filter));
+	}
+	else
+	{
+		// no free slot
+		lease = 0;
+	}
+
+	xSemaphoreGive(m_mutex);
+
+	// acknowledge the granted lease, 0 means the subscription was refused
+	uint8_t reply[sizeof(T4ProxyHeader) + sizeof(lease)];
+	T4ProxyHeader header = { { 'T', '4' }, PROXY_SUBSCRIBED, 0, 0 };
+	memcpy(reply, &header, sizeof(header));
+	memcpy(reply + sizeof(header), &lease, sizeof(lease));
+	udpPacket.write(reply, sizeof(reply));
+}
+
+void T4Proxy::unsubscribe(const IPAddress& address, uint16_t port)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	for (auto& subscription : m_subscriptions)
+	{
+		if (subscription.port == port && subscription.address == address)
+			subscription.port = 0;
+	}
+
+	xSemaphoreGive(m_mutex);
+}
+
+void T4Proxy::proxyTask()
+{
+	T4Packet packet;
+
+	for (;;)
+	{
+		// wait for next packet, but not longer than until the oldest pending batch is due
+		TickType_t wait = portMAX_DELAY;
+		if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+		{
+			uint32_t now = millis();
+			auto due = [&](const T4ProxyStream& stream)
+			{
+				if (stream.batchCount)
+				{
+					uint32_t elapsed = now - stream.batchStart;
+					wait = std::min<TickType_t>(wait, (elapsed < BATCH_TIME) ? (BATCH_TIME - elapsed) : 0);
+				}
+			};
+			due(m_broadcastStream);
+			for (auto& subscription : m_subscriptions)
+				due(subscription);
+
+			xSemaphoreGive(m_mutex);
+		}
+
+		bool received = xQueueReceive(m_queue, &packet, wait);
+
+		if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+			continue;
+
+		uint32_t now = millis();
+
+		if (received && m_udp)
+			forward(packet, now);
+
+		if (m_broadcastStream.batchCount && now - m_broadcastStream.batchStart >= BATCH_TIME)
+			flush(m_broadcastStream);
+		for (auto& subscription : m_subscriptions)
+		{
+			if (subscription.batchCount && now - subscription.batchStart >= BATCH_TIME)
+				flush(subscription);
+		}
+
+		xSemaphoreGive(m_mutex);
+	}
+
+	m_proxyTaskHandle = nullptr;
+	vTaskDelete(nullptr);
+}
+
+void T4Proxy::append(T4ProxyStream& stream, const T4Packet& packet)
+{
+	size_t frame_size = sizeof(T4ProxyFrameHeader) + packet.size;
+	if (stream.batchSize + frame_size > sizeof(stream.batchData) || stream.batchCount == 0xFF)
+		flush(stream);
+
+	if (!stream.batchCount)
+	{
+		stream.batchStart = millis();
+		stream.batchSize = sizeof(T4ProxyHeader);
+	}
+
+	// packets sent by this module are seen on the bus too, tell them apart by their source
+	T4ProxyFrameHeader frame = { packet.time, uint8_t((packet.header.from == T4ThisAddress) ? PROXY_TX : PROXY_RX), packet.size };
+	memcpy(&stream.batchData[stream.batchSize], &frame, sizeof(frame));
+	memcpy(&stream.batchData[stream.batchSize + sizeof(frame)], packet.data, packet.size);
+	stream.batchSize += frame_size;
+	stream.batchCount++;
+}
+
+void T4Proxy::flush(T4ProxyStream& stream)
+{
+	if (!stream.batchCount)
+		return;
+
+	// sequence number lets listeners detect lost datagrams
+	T4ProxyHeader header = { { 'T', '4' }, PROXY_BATCH, stream.batchCount, stream.sequence++ };
+	memcpy(stream.batchData, &header, sizeof(header));
+
+	if (&stream == &m_broadcastStream)
+		m_udp.broadcast(stream.batchData, stream.batchSize);
+	else if (stream.port)
+		m_udp.writeTo(stream.batchData, stream.batchSize, stream.address, stream.port);
+
+	stream.batchSize = 0;
+	stream.batchCount = 0;
+}
@@ -0,0 +1,190 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PROXY_H
+#define PROXY_H
+
+#include <Arduino.h>
+#include <AsyncUDP.h>
+
+#include "t4.h"
+
+// messages of the proxy start with "T4" magic, which can't collide with raw T4 packets (they start with packet type 0x55 or 0xF0)
+enum T4ProxyMessage : uint8_t
+{
+	PROXY_BATCH = 0x01,
+	PROXY_CONFIG = 0x02,
+	PROXY_SUBSCRIBE = 0x03,
+	PROXY_SUBSCRIBED = 0x04,
+	PROXY_UNSUBSCRIBE = 0x05,
+	PROXY_REQUEST = 0x06,
+	PROXY_REPLY = 0x07,
+	PROXY_ECHO = 0x08,
+};
+
+enum T4ProxyStatus : uint8_t
+{
+	RPC_OK = 0,
+	RPC_TIMEOUT = 1,
+	RPC_INVALID = 2,
+	RPC_RATE_LIMITED = 3,
+	RPC_BUSY = 4,
+};
+
+enum T4ProxyDirection : uint8_t
+{
+	PROXY_RX = 0,
+	PROXY_TX = 1,
+};
+
+enum T4ProxyFilterMask : uint8_t
+{
+	FILTER_SOURCE = 0x01,
+	FILTER_DESTINATION = 0x02,
+	FILTER_DEVICE = 0x04,
+	FILTER_COMMAND = 0x08,
+};
+
+struct __attribute__((packed)) T4ProxyHeader
+{
+	char magic[2];
+	uint8_t type;
+	uint8_t count;
+	uint32_t sequence;
+};
+
+// header of every frame in PROXY_BATCH datagram, followed by data[size]
+struct __attribute__((packed)) T4ProxyFrameHeader
+{
+	uint32_t time;
+	uint8_t direction;
+	uint8_t size;
+};
+
+struct __attribute__((packed)) T4ProxyFilter
+{
+	uint8_t mask;
+	T4Source source;
+	T4Source destination;
+	uint8_t device;
+	uint8_t command;
+};
+
+// payload of PROXY_SUBSCRIBE message, port 0 means the port the message came from
+struct __attribute__((packed)) T4ProxySubscribe
+{
+	uint16_t port;
+	uint16_t lease;
+	T4ProxyFilter filter;
+};
+
+// payload of PROXY_REQUEST message, followed by the message itself, correlation id is passed in the sequence field of the header
+struct __attribute__((packed)) T4ProxyRequest
+{
+	uint8_t packetType;
+	T4Source to;
+	uint8_t protocol;
+	uint8_t retry;
+	uint16_t timeout;
+};
+
+struct T4ProxyRPC
+{
+	IPAddress address;
+	uint16_t port;
+	uint32_t correlation;
+	T4ProxyRequest request;
+	uint8_t messageSize;
+	uint8_t message[52];
+};
+
+// destination of the proxied frames, either the broadcast or a subscriber
+struct T4ProxyStream
+{
+	IPAddress address;
+	uint16_t port = 0;
+	uint32_t expiration = 0;
+	T4Matcher matcher;
+
+	uint32_t sequence = 0;
+	uint32_t batchStart = 0;
+	uint8_t batchData[1024];
+	size_t batchSize = 0;
+	uint8_t batchCount = 0;
+};
+
+constexpr size_t T4ProxySubscriptions = 8;
+constexpr uint16_t T4ProxyMaxLease = 3600;
+
+class T4Proxy
+{
+public:
+	T4Proxy(T4Client& client) : m_client(client) {}
+
+	void init(uint16_t port);
+	void onUDPPacket(AsyncUDPPacket& udpPacket);
+
+	void proxyTask();
+	static void proxyTaskThunk(void* self) { ((T4Proxy*)self)->proxyTask(); }
+	void rpcTask();
+	static void rpcTaskThunk(void* self) { ((T4Proxy*)self)->rpcTask(); }
+
+	bool getBatch() const { return m_batch; }
+	bool getBroadcast() const { return m_broadcast; }
+	void setConfig(bool batch, bool broadcast);
+
+	size_t getSubscribersCount();
+
+private:
+	void subscribe(AsyncUDPPacket& udpPacket, const T4ProxySubscribe& subscribe);
+	void unsubscribe(const IPAddress& address, uint16_t port);
+	bool takeToken();
+	void request(AsyncUDPPacket& udpPacket, uint32_t correlation, const uint8_t* payload, size_t payloadSize);
+	void reply(const IPAddress& address, uint16_t port, uint32_t correlation, uint8_t status, const T4Packet* packet = nullptr);
+	bool isActive(T4ProxyStream& stream, uint32_t now);
+
+	void forward(const T4Packet& packet, uint32_t now);
+	void append(T4ProxyStream& stream, const T4Packet& packet);
+	void flush(T4ProxyStream& stream);
+
+	T4Client& m_client;
+
+	AsyncUDP m_udp;
+
+	TaskHandle_t m_proxyTaskHandle = nullptr;
+	TaskBuffer<TASK_T4_PROXY> m_proxyTaskBuffer;
+	QueueHandle_t m_queue = nullptr;
+	QueueBuffer<T4Packet, QUEUE_PROXY> m_queueBuffer;
+	TaskHandle_t m_rpcTaskHandle = nullptr;
+	TaskBuffer<TASK_T4_RPC> m_rpcTaskBuffer;
+	QueueHandle_t m_rpcQueue = nullptr;
+	QueueBuffer<T4ProxyRPC, QUEUE_PROXY_RPC> m_rpcQueueBuffer;
+
+	// token bucket limiting the rate of requests and echoes
+	uint32_t m_rpcTokens = 0;
+	uint32_t m_rpcTokensTime = 0;
+	SemaphoreHandle_t m_mutex = nullptr;
+	MutexBuffer m_mutexBuffer;
+
+	// set from the UDP callback, read by the proxy task and the web interface
+	std::atomic<bool> m_batch = false;
+	std::atomic<bool> m_broadcast = true;
+
+	T4ProxyStream m_broadcastStream;
+	T4ProxyStream m_subscriptions[T4ProxySubscriptions];
+};
+
+#endif
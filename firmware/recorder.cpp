@@ -0,0 +1,256 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <Preferences.h>
+
+#include "recorder.h"
+
+const uint32_t SNAPSHOT_MAGIC = 0x52463454;		// "T4FR"
+
+const uint32_t PRE_TRIGGER_TIME = 10000;
+const uint32_t POST_TRIGGER_TIME = 5000;
+const size_t POST_TRIGGER_RESERVE = 768;
+
+const uint32_t CHECK_PERIOD = 500;
+
+void T4Recorder::init()
+{
+	m_mutex = createMutex(m_mutexBuffer);
+
+	// count boots to be able to tell which snapshots were captured before the last reboot
+	Preferences prefs;
+	if (prefs.begin("recorder"))
+	{
+		m_boot = prefs.getUInt("boot") + 1;
+		prefs.putUInt("boot", m_boot);
+		prefs.end();
+	}
+
+	createTask(recorderTaskThunk, m_recorderTaskBuffer, this, &m_recorderTaskHandle);
+	m_client.subscribe("recorder", *this);
+}
+
+void T4Recorder::onPacket(const T4Packet& packet)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	record(RECORD_FRAME, packet.data, packet.size);
+
+	// events of the unit and replies to anyone's requests, the position and status are sampled whenever they pass the bus
+	if (packet.header.protocol == DMP && packet.message.device == CONTROLLER && !(packet.message.dmp.flags & REQ))
+	{
+		const auto data = packet.message.dmp.data;
+
+		if (packet.message.command == 0x11 && packet.header.messageSize >= 6 + 2)
+		{
+			// CTRL_POSITION_CURRENT(0x11)
+			m_lastPosition = (data[0] << 8) | data[1];
+		}
+		else if (packet.message.command == 0x01 && packet.header.messageSize >= 6 + 3)
+		{
+			// CTRL_AUTOMATION_STATUS(0x01)
+			T4RecordSample sample = { data[0], data[1], data[2], { uint8_t(m_lastPosition >> 8), uint8_t(m_lastPosition) } };
+			record(RECORD_SAMPLE, (const uint8_t*)&sample, sizeof(sample));
+
+			// trigger on change of the last manoeuvre status to anything but OK, the first status seen after boot is only a reference
+			if (m_lastManoeuvre != 0xFF && sample.manoeuvre != m_lastManoeuvre && sample.manoeuvre != 0)
+				trigger(sample.status, sample.manoeuvre);
+
+			m_lastManoeuvre = sample.manoeuvre;
+			m_referenceKnown = true;
+		}
+	}
+
+	xSemaphoreGive(m_mutex);
+}
+
+void T4Recorder::record(uint8_t kind, const uint8_t* data, uint8_t size)
+{
+	auto& record = m_ring[m_ringHead];
+	record.time = millis();
+	record.kind = kind;
+	record.size = std::min<size_t>(size, sizeof(record.data));
+	memcpy(record.data, data, record.size);
+
+	m_ringHead = (m_ringHead + 1) % std::size(m_ring);
+	if (m_ringCount < std::size(m_ring))
+		++m_ringCount;
+
+	if (m_stagingState == CAPTURING)
+		stage(record);
+}
+
+void T4Recorder::stage(const T4Record& record)
+{
+	int32_t offset = int32_t(record.time - m_stagingTime);
+	if (offset > int32_t(POST_TRIGGER_TIME))
+	{
+		m_stagingState = COMPLETE;
+		return;
+	}
+
+	size_t record_size = 6 + record.size;
+	if (m_stagingSize + record_size > sizeof(m_staging))
+		// slot is full, the rest of post-trigger window is lost
+		return;
+
+	uint8_t* p = &m_staging[m_stagingSize];
+	memcpy(p, &offset, sizeof(offset));
+	p[4] = record.kind;
+	p[5] = record.size;
+	memcpy(p + 6, record.data, record.size);
+	m_stagingSize += record_size;
+
+	auto header = (T4SnapshotHeader*)m_staging;
+	header->recordsCount++;
+	header->recordsSize = m_stagingSize - sizeof(T4SnapshotHeader);
+}
+
+void T4Recorder::trigger(uint8_t status, uint8_t manoeuvre)
+{
+	if (m_stagingState != IDLE)
+		// previous snapshot is still being captured or stored
+		return;
+
+	uint32_t now = millis();
+
+	auto header = (T4SnapshotHeader*)m_staging;
+	*header = { SNAPSHOT_MAGIC, m_boot, now, status, manoeuvre, 0, 0 };
+	m_stagingSize = sizeof(T4SnapshotHeader);
+	m_stagingState = CAPTURING;
+	m_stagingTime = now;
+
+	// find the oldest record of pre-trigger window that still fits into the slot along with reserve for post-trigger records
+	size_t count = 0;
+	size_t size = sizeof(T4SnapshotHeader);
+	for (; count < m_ringCount; ++count)
+	{
+		auto& record = m_ring[(m_ringHead + std::size(m_ring) - 1 - count) % std::size(m_ring)];
+		if (now - record.time > PRE_TRIGGER_TIME)
+			break;
+		if (size + 6 + record.size > sizeof(m_staging) - POST_TRIGGER_RESERVE)
+			break;
+		size += 6 + record.size;
+	}
+
+	// freeze the window
+	while (count-- > 0)
+		stage(m_ring[(m_ringHead + std::size(m_ring) - 1 - count) % std::size(m_ring)]);
+
+	Serial.printf("Recorder triggered (manoeuvre:%u)\r\n", manoeuvre);
+}
+
+void T4Recorder::recorderTask()
+{
+	T4Packet reply;
+
+	for (;;)
+	{
+		// the unit reports changes of its status by EVT frames, only the reference status is requested after boot
+		if (!m_referenceKnown && m_client.lockUnit())
+		{
+			auto& unit = m_client.getUnit();
+			if (!(unit.source == T4BroadcastAddress))
+			{
+				// CTRL_AUTOMATION_STATUS(0x01), the reply is recorded as any other frame seen on the bus
+				uint8_t message[5] = { CONTROLLER, 0x01, REQ|GET|ACK|FIN, 0x00, 0x00 };
+				m_client.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply);
+			}
+
+			m_client.unlockUnit();
+		}
+
+		// all changes of the staging state are done under the mutex, once it's complete, nothing else touches the buffer
+		bool complete = false;
+		if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+		{
+			if (m_stagingState == CAPTURING && millis() - m_stagingTime > POST_TRIGGER_TIME)
+				m_stagingState = COMPLETE;
+
+			complete = (m_stagingState == COMPLETE);
+			xSemaphoreGive(m_mutex);
+		}
+
+		if (complete)
+		{
+			// staging buffer is not touched until it's idle again, so it can be stored without holding the mutex
+			Preferences prefs;
+			if (prefs.begin("recorder"))
+			{
+				uint8_t slot = prefs.getUChar("next") % T4RecorderSlots;
+
+				char key[8];
+				snprintf(key, sizeof(key), "slot%u", unsigned(slot));
+				prefs.putBytes(key, m_staging, m_stagingSize);
+				prefs.putUChar("next", (slot + 1) % T4RecorderSlots);
+				prefs.end();
+
+				Serial.printf("Recorder snapshot stored (slot:%u, size:%u)\r\n", slot, unsigned(m_stagingSize));
+			}
+
+			if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+			{
+				m_stagingState = IDLE;
+				xSemaphoreGive(m_mutex);
+			}
+		}
+
+		vTaskDelay(CHECK_PERIOD);
+	}
+
+	m_recorderTaskHandle = nullptr;
+	vTaskDelete(nullptr);
+}
+
+size_t T4Recorder::loadSnapshot(size_t slot, uint8_t* buffer)
+{
+	if (slot >= T4RecorderSlots)
+		return 0;
+
+	size_t size = 0;
+
+	Preferences prefs;
+	if (prefs.begin("recorder", true))
+	{
+		char key[8];
+		snprintf(key, sizeof(key), "slot%u", unsigned(slot));
+		if (prefs.isKey(key))
+			size = prefs.getBytes(key, buffer, T4RecorderSlotSize);
+		prefs.end();
+	}
+
+	auto header = (const T4SnapshotHeader*)buffer;
+	if (size < sizeof(T4SnapshotHeader) || header->magic != SNAPSHOT_MAGIC || sizeof(T4SnapshotHeader) + header->recordsSize > size)
+		return 0;
+
+	return size;
+}
+
+void T4Recorder::clearSnapshots()
+{
+	Preferences prefs;
+	if (prefs.begin("recorder"))
+	{
+		for (size_t slot = 0; slot < T4RecorderSlots; ++slot)
+		{
+			char key[8];
+			snprintf(key, sizeof(key), "slot%u", unsigned(slot));
+			prefs.remove(key);
+		}
+		prefs.end();
+	}
+}
@@ -0,0 +1,111 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <Arduino.h>
+
+#include "t4.h"
+
+enum T4RecordKind : uint8_t
+{
+	RECORD_FRAME = 0,
+	RECORD_SAMPLE = 1,
+};
+
+struct T4Record
+{
+	uint32_t time;
+	uint8_t kind;
+	uint8_t size;
+	uint8_t data[63];
+};
+
+// diagnostics sample, stored as data of RECORD_SAMPLE record
+struct T4RecordSample
+{
+	uint8_t status;
+	uint8_t flags;
+	uint8_t manoeuvre;
+	uint8_t position[2];
+};
+
+// header of the snapshot slot, followed by records encoded as { int32 offset to trigger, kind, size, data[size] }
+struct T4SnapshotHeader
+{
+	uint32_t magic;
+	uint32_t boot;
+	uint32_t time;
+	uint8_t status;
+	uint8_t manoeuvre;
+	uint16_t recordsCount;
+	uint16_t recordsSize;
+};
+
+constexpr size_t T4RecorderSlots = 4;
+constexpr size_t T4RecorderSlotSize = 2048;
+
+class T4Recorder : public T4Subscriber
+{
+public:
+	T4Recorder(T4Client& client) : m_client(client) {}
+
+	void init();
+	void onPacket(const T4Packet& packet) override;
+
+	void recorderTask();
+	static void recorderTaskThunk(void* self) { ((T4Recorder*)self)->recorderTask(); }
+
+	// loads the snapshot slot into the buffer (at least T4RecorderSlotSize bytes), returns its size or 0 if slot is empty
+	size_t loadSnapshot(size_t slot, uint8_t* buffer);
+	void clearSnapshots();
+
+	uint32_t getBoot() const { return m_boot; }
+
+private:
+	// all called with m_mutex held
+	void record(uint8_t kind, const uint8_t* data, uint8_t size);
+	void stage(const T4Record& record);
+	void trigger(uint8_t status, uint8_t manoeuvre);
+
+	T4Client& m_client;
+
+	TaskHandle_t m_recorderTaskHandle = nullptr;
+	TaskBuffer<TASK_T4_RECORDER> m_recorderTaskBuffer;
+	SemaphoreHandle_t m_mutex = nullptr;
+	MutexBuffer m_mutexBuffer;
+
+	uint32_t m_boot = 0;
+
+	// ring buffer continuously holding the most recent records
+	T4Record m_ring[160];
+	size_t m_ringHead = 0;
+	size_t m_ringCount = 0;
+
+	uint8_t m_lastManoeuvre = 0xFF;
+	std::atomic<bool> m_referenceKnown = false;
+	uint16_t m_lastPosition = 0;
+
+	// snapshot being captured, pre-trigger records are frozen into it on trigger, post-trigger records are appended;
+	// the state is guarded by m_mutex, the buffer is owned by the recorder task while the state is COMPLETE
+	enum { IDLE = 0, CAPTURING, COMPLETE } m_stagingState = IDLE;
+	uint32_t m_stagingTime = 0;
+	alignas(4) uint8_t m_staging[T4RecorderSlotSize];
+	size_t m_stagingSize = 0;
+};
+
+#endif
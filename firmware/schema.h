@@ -0,0 +1,570 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SCHEMA_H
+#define SCHEMA_H
+
+#include <Arduino.h>
+#include <algorithm>
+#include <array>
+
+// Protocol vocabulary, every list is X(name, id, string) and generates scoped enum and dense table of strings indexed by the id.
+// Tables are constexpr, so they are stored in flash and the lookup is a single bounds-checked index.
+
+template <size_t N>
+struct T4Strings
+{
+	const char* strings[N] = {};
+
+	constexpr const char* operator[](size_t id) const { return (id < N) ? strings[id] : nullptr; }
+	constexpr size_t size() const { return N; }
+	constexpr const char* const* data() const { return strings; }
+};
+
+struct T4StringList
+{
+	const char* const* strings = nullptr;
+	size_t count = 0;
+};
+
+#define T4_SCHEMA_ENUM(name, id, string) name = id,
+#define T4_SCHEMA_ID(name, id, string) size_t(id),
+#define T4_SCHEMA_STRING(name, id, string) table.strings[id] = string;
+#define T4_SCHEMA_LIST(name, id, strings) table[id] = { strings.data(), strings.size() };
+
+#define T4_SCHEMA_STRINGS(list) []() \
+{ \
+	T4Strings<std::max({ list(T4_SCHEMA_ID) }) + 1> table; \
+	list(T4_SCHEMA_STRING) \
+	return table; \
+}()
+
+#define T4_SCHEMA(list, type) \
+	enum class type : uint8_t { list(T4_SCHEMA_ENUM) }; \
+	inline constexpr auto type##Strings = T4_SCHEMA_STRINGS(list);
+
+// CTRL_AUTOMATION_STATUS(0x01) values
+#define T4_AUTOMATION_STATUS(X) \
+	X(STOPPED, 1, "Stopped") \
+	X(OPENING_IN_PROGRESS, 2, "Opening in progress") \
+	X(CLOSING_IN_PROGRESS, 3, "Closing in progress") \
+	X(STOPPED_IN_OPENED, 4, "Stopped in opened") \
+	X(STOPPED_IN_CLOSED, 5, "Stopped in closed") \
+	X(ACTIVE_PREFLASHING, 6, "Active preflashing") \
+	X(STOPPED_IN_PAUSE_TIME, 7, "Stopped in pause time") \
+	X(SEARCHING_DEVICES, 8, "Searching devices...") \
+	X(SEARCHING_POSITIONS, 9, "Searching positions...") \
+	X(RESEARCH_DEVICES_FINISHED, 10, "Research devices finished") \
+	X(RESEARCH_POSITIONS_FINISHED, 11, "Research positions finished") \
+	X(RESEARCH_DEVICES_ERROR, 12, "Research devices error") \
+	X(RESEARCH_POSITIONS_ERROR, 13, "Research positions error") \
+	X(STOPPED_IN_PARTIAL_1, 16, "Stopped in partial 1") \
+	X(STOPPED_IN_PARTIAL_2, 17, "Stopped in partial 2") \
+	X(STOPPED_IN_PARTIAL_3, 18, "Stopped in partial 3")
+T4_SCHEMA(T4_AUTOMATION_STATUS, T4AutomationStatus)
+
+// CTRL_LOG_8_MANEUVERS(0xDA) values
+#define T4_MANOEUVRE_STATUS(X) \
+	X(OK, 0, "OK") \
+	X(ERROR_ON_BLUEBUS, 1, "ERROR_ON_BLUEBUS") \
+	X(PHOTO_INTERVENTION, 2, "PHOTO_INTERVENTION") \
+	X(OBSTACLE_DETECTED, 3, "OBSTACLE_DETECTED") \
+	X(HALT_DETECTED, 4, "HALT_DETECTED") \
+	X(INTERNAL_PARAMETERS_ERROR, 5, "INTERNAL_PARAMETERS_ERROR") \
+	X(MAXIMUM_NUMBER_OF_MANEUVERS_PER_HOUR_EXCEEDED, 6, "MAXIMUM_NUMBER_OF_MANEUVERS_PER_HOUR_EXCEEDED") \
+	X(ELECTRIC_ANOMALY, 7, "ELECTRIC_ANOMALY") \
+	X(BLOCKING_COMMAND, 8, "BLOCKING_COMMAND") \
+	X(BLOCKED_AUTOMATION, 9, "BLOCKED_AUTOMATION") \
+	X(DETECTED_OBSTACLE_BY_ENCODER, 10, "DETECTED_OBSTACLE_BY_ENCODER")
+T4_SCHEMA(T4_MANOEUVRE_STATUS, T4ManoeuvreStatus)
+
+// commands executed by CTRL_COMMAND(0x82)
+#define T4_COMMANDS(X) \
+	X(CMD_STST, 1, "Step by Step") \
+	X(CMD_STP, 2, "Stop") \
+	X(CMD_OPN, 3, "Open") \
+	X(CMD_CLS, 4, "Close") \
+	X(CMD_OPN_I1, 5, "Open partial 1") \
+	X(CMD_OPN_I2, 6, "Open partial 2") \
+	X(CMD_OPN_I3, 7, "Open partial 3") \
+	X(CMD_CLS_I1, 8, "Close partial 1") \
+	X(CMD_CLS_I2, 9, "Close partial 2") \
+	X(CMD_CLS_I3, 10, "Close partial 3") \
+	X(CMD_STST_CND, 11, "Apartament block Step by Step") \
+	X(CMD_STST_HP, 12, "Hi priority Step by Step") \
+	X(CMD_OPN_BLK, 13, "Open and lock") \
+	X(CMD_CLS_BLK, 14, "Close and lock") \
+	X(CMD_BLK_ON, 15, "Lock") \
+	X(CMD_BLK_OFF, 16, "Unlock") \
+	X(CMD_LDC_ON, 17, "Courtesy light on") \
+	X(CMD_LDC_PP, 18, "Courtesy light toggle") \
+	X(CMD_MS_PP, 19, "Master Step by Step") \
+	X(CMD_MS_OPN, 20, "Master open") \
+	X(CMD_MS_CLS, 21, "Master close") \
+	X(CMD_SL_PP, 22, "Slave Step by Step") \
+	X(CMD_SL_OPN, 23, "Slave open") \
+	X(CMD_SL_CLS, 24, "Slave close") \
+	X(CMD_OPN_UNB, 25, "Unlock and open") \
+	X(CMD_CLS_UNB, 26, "Unlock and close") \
+	X(CMD_ACND_ON, 27, "Enable photo command apartament block open") \
+	X(CMD_ACND_OFF, 28, "Disable photo command apartament block open") \
+	X(CMD_LOOP_ON, 29, "Enable loop input") \
+	X(CMD_LOOP_OFF, 30, "Disable loop input") \
+	X(CMD_ALT, 33, "Halt") \
+	X(CMD_FT_CMD, 34, "Photo open command") \
+	X(CMD_PHOTO, 35, "Photo command") \
+	X(CMD_PHOTO1, 36, "Photo 1 command") \
+	X(CMD_PHOTO2, 37, "Photo 2 command") \
+	X(CMD_PHOTO3, 38, "Photo 3 command") \
+	X(CMD_ALT_EM, 39, "Emergency Stop") \
+	X(CMD_EM, 40, "Emergency command") \
+	X(CMD_ALT_LOCK, 41, "Stop for interlocking function") \
+	X(CMD_SBA, 42, "SBA sensor command") \
+	X(CMD_EM_OPN, 43, "Emergency Open") \
+	X(CMD_EM_CLS, 44, "Emergency Close")
+T4_SCHEMA(T4_COMMANDS, T4Command)
+
+// menu items of the control unit
+#define T4_MENU(X) \
+	X(CTRL_AUTOMATION_TYPE, 0x00, "Type automation") \
+	X(CTRL_AUTOMATION_STATUS, 0x01, "State automation") \
+	X(CTRL_AUTOMATION_SLAVE_STATUS, 0x02, "Slave state automation") \
+	X(CTRL_STR_VERSION_CONFIGURATION, 0x03, "PCB version / configuration (only barriers)") \
+	X(CTRL_STR_MODULAR_CU_VERSION, 0x04, "Modular control unit board version") \
+	X(CTRL_SEARCH_DEVICES, 0x05, "Search devices") \
+	X(CTRL_FUNCTION_MODE, 0x06, "Function mode") \
+	X(CTRL_RADIO_CONTROLS_MODE_2, 0x07, "Radio controls mode 2") \
+	X(CTRL_STR_COMMANDS, 0x08, "Commands") \
+	X(CTRL_ACTIVATE_RECEIVER, 0x09, "Activate receiver") \
+	X(CTRL_SEARCH_BLUEBUS_DEVICES, 0x0A, "Search BlueBus devices") \
+	X(CTRL_SEARCH_POSITIONS, 0x0B, "Search positions") \
+	X(CTRL_DELETE_PARAMETERS, 0x0C, "Delete parameters") \
+	X(CTRL_INSTALLATIONS_TYPE, 0x0D, "Type of installation") \
+	X(CTRL_CMD_QUOTA, 0x0F, "Command go to position") \
+	X(CTRL_TRANSFORMATION_RATIO, 0x10, "Transformation ratio") \
+	X(CTRL_POSITION_CURRENT, 0x11, "Current position") \
+	X(CTRL_POSITION_MAXIMUM_OPENING, 0x12, "Maximum opening position") \
+	X(CTRL_POSITION_MINIMUM_CLOSING, 0x13, "Maximum closing position") \
+	X(CTRL_POSITION_OPENING, 0x18, "Opening position") \
+	X(CTRL_POSITION_CLOSING, 0x19, "Closing position") \
+	X(CTRL_STR_POSITION_OPEN_PERSON, 0x1A, "Position open person") \
+	X(CTRL_PEDESTRIAN_POSITION_OPENING_1, 0x1B, "Pedestrian opening position 1") \
+	X(CTRL_PEDESTRIAN_POSITION_OPENING_2, 0x1C, "Pedestrian opening position 2") \
+	X(CTRL_PEDESTRIAN_POSITION_OPENING_3, 0x1D, "Pedestrian opening position 3") \
+	X(CTRL_INTERMEDIATE_POSITION, 0x20, "Intermediate position") \
+	X(CTRL_INTERMEDIATE_POSITION_1, 0x21, "Intermediate position 1") \
+	X(CTRL_INTERMEDIATE_POSITION_2, 0x22, "Intermediate position 2") \
+	X(CTRL_INTERMEDIATE_POSITION_3, 0x23, "Intermediate position 3") \
+	X(CTRL_DECELERATION_POSITION_OPENING, 0x24, "Deceleration opening position") \
+	X(CTRL_DECELERATION_POSITION_CLOSING, 0x25, "Deceleration closing position") \
+	X(CTRL_DECELERATION_POSITION_INTERMEDIATE, 0x26, "Deceleration intermediate position") \
+	X(CTRL_INTERMEDIATE_DECELERATION_DELETE, 0x27, "Delete intermediate deceleration") \
+	X(CTRL_PHASE_SHIFT_OPENING, 0x28, "Opening phase shift (M2 on M1)") \
+	X(CTRL_PHASE_SHIFT_CLOSING, 0x29, "Closing phase shift (M1 on M2)") \
+	X(CTRL_DISCHARGING_OPENING, 0x2A, "Discharging opening") \
+	X(CTRL_DISCHARGING_CLOSING, 0x2B, "Discharging closing") \
+	X(CTRL_MANAGEMENT_DISCHARGING_OPENING, 0x2C, "Management discharging opening") \
+	X(CTRL_MANAGEMENT_DISCHARGING_CLOSING, 0x2D, "Management discharging closing") \
+	X(CTRL_POSITION_RECOVERY_FOR_SENSIBLE_BORDER, 0x2E, "Position recovery for sensible border") \
+	X(CTRL_RESET_ENCODER, 0x2F, "Reset encoder") \
+	X(CTRL_WORKING_WITH_2_ENGINES, 0x30, "Working with 2 engines") \
+	X(CTRL_QUANTITY_BRIEF_INVERSION, 0x31, "Quantity brief inversion") \
+	X(CTRL_INITIAL_DECELERATION_DURING_OPENING, 0x32, "Initial deceleration during opening") \
+	X(CTRL_INITIAL_DECELERATION_DURING_CLOSING, 0x33, "Initial deceleration during closing") \
+	X(CTRL_BALANCING, 0x34, "Balancing") \
+	X(CTRL_BRAKING_LEVEL, 0x35, "Braking level") \
+	X(CTRL_BRAKE_MODE, 0x36, "Brake mode") \
+	X(CTRL_TIME_FORCE_OPERATION, 0x37, "Time force operation") \
+	X(CTRL_STR_SENSIBILITY_MANAGEMENT, 0x38, "Sensibility management") \
+	X(CTRL_SENSITIVITY_OBSTACLE, 0x39, "Obstacle sensitivity") \
+	X(CTRL_SENSITIVITY_OPENING, 0x3A, "Opening sensitivity") \
+	X(CTRL_SENSITIVITY_CLOSING, 0x3B, "Closing sensitivity") \
+	X(CTRL_SENSITIVITY_DECELERATION, 0x3C, "Deceleration sensitivity") \
+	X(CTRL_SENSITIVITY_DECELERATION_OPENING, 0x3D, "Deceleration opening sensitivity") \
+	X(CTRL_SENSITIVITY_DECELERATION_CLOSING, 0x3E, "Deceleration closing sensitivity") \
+	X(CTRL_DELETE_MAPS_IN_MEMORY, 0x3F, "Delete maps in memory") \
+	X(CTRL_STR_SPEED_MANAGEMENT, 0x40, "Speed management") \
+	X(CTRL_SPEED_CRUISE, 0x41, "Cruise speed") \
+	X(CTRL_SPEED_OPENING, 0x42, "Opening speed") \
+	X(CTRL_SPEED_CLOSING, 0x43, "Closing speed") \
+	X(CTRL_SPEED_DECELERATION, 0x44, "Deceleration speed") \
+	X(CTRL_SPEED_DECELERATION_OPENING, 0x45, "Deceleration opening speed") \
+	X(CTRL_SPEED_DECELERATION_CLOSING, 0x46, "Deceleration closing speed") \
+	X(CTRL_STR_STRENGTH_MANAGEMENT, 0x47, "Strength management") \
+	X(CTRL_FORCE_MANAGEMENT, 0x48, "Management force (mode)") \
+	X(CTRL_FORCE_CRUISE, 0x49, "Cruise force") \
+	X(CTRL_FORCE_OPENING, 0x4A, "Opening force") \
+	X(CTRL_FORCE_CLOSING, 0x4B, "Closing force") \
+	X(CTRL_DECELERATION_FORCE, 0x4C, "Deceleration force") \
+	X(CTRL_DECELERATION_FORCE_OPENING, 0x4D, "Deceleration opening force") \
+	X(CTRL_DECELERATION_FORCE_CLOSING, 0x4E, "Deceleration closing force") \
+	X(CTRL_MANUAL_FORCE, 0x4F, "Manual force") \
+	X(CTRL_OUTPUT, 0x50, "Output") \
+	X(CTRL_OUTPUT_1, 0x51, "Output 1") \
+	X(CTRL_OUTPUT_2, 0x52, "Output 2") \
+	X(CTRL_OUTPUT_3, 0x53, "Output 3") \
+	X(CTRL_OUTPUT_4, 0x54, "Output 4") \
+	X(CTRL_OUTPUT_5, 0x55, "Output 5") \
+	X(CTRL_OUTPUT_6, 0x56, "Output 6") \
+	X(CTRL_TIME_SCA, 0x58, "Time SCA") \
+	X(CTRL_TIME_FLASH, 0x59, "Time FLASH") \
+	X(CTRL_TIME_ELECTRIC_LOCK, 0x5A, "Time eletric lock") \
+	X(CTRL_TIME_COURTESY_LIGHT, 0x5B, "Time courtesy light") \
+	X(CTRL_TIME_SUCTION_CUP, 0x5C, "Time suction cup") \
+	X(CTRL_MODE_TRAFFIC_LIGHT_BLUEBUS, 0x5D, "Mode traffic light BlueBus") \
+	X(CTRL_ACCELERATION, 0x5E, "Acceleration") \
+	X(CTRL_DECELERATION, 0x5F, "Deceleration") \
+	X(CTRL_MODE_COMMAND, 0x60, "Mode command") \
+	X(CTRL_MODE_COMMAND_STEPSTEP, 0x61, "Mode command STEP-STEP") \
+	X(CTRL_MODE_COMMAND_OPEN_PARTIAL, 0x62, "Mode command PARTIAL OPEN") \
+	X(CTRL_MODE_COMMAND_OPEN, 0x63, "Mode command OPEN") \
+	X(CTRL_MODE_COMMAND_CLOSE, 0x64, "Mode command CLOSE") \
+	X(CTRL_MODE_COMMAND_STOP, 0x65, "Mode command STOP") \
+	X(CTRL_MODE_DELAY_INVERSION_FOTO, 0x66, "Mode delay inversion foto") \
+	X(CTRL_MODE_COMMAND_PHOTO_CLOSE, 0x68, "Mode command PHOTO CLOSE") \
+	X(CTRL_MODE_COMMAND_PHOTO_OPEN, 0x69, "Mode command PHOTO OPEN") \
+	X(CTRL_MODE_COMMAND_PHOTO_3, 0x6A, "Mode command PHOTO 3") \
+	X(CTRL_MODE_COMMAND_ALT_OPEN, 0x6B, "Mode command ALT open") \
+	X(CTRL_MODE_COMMAND_ALT_CLOSE, 0x6C, "Mode command ALT close") \
+	X(CTRL_MODE_COMMAND_PHOTO_1, 0x6D, "Mode command PHOTO 1") \
+	X(CTRL_MODE_COMMAND_ALT_PRECLOSING, 0x6E, "Mode command ALT pre closing") \
+	X(CTRL_MODE_COMMAND_EMERGENCY, 0x6F, "Mode command emergency") \
+	X(CTRL_INPUT, 0x70, "Input") \
+	X(CTRL_INPUT_1, 0x71, "Input 1") \
+	X(CTRL_INPUT_2, 0x72, "Input 2") \
+	X(CTRL_INPUT_3, 0x73, "Input 3") \
+	X(CTRL_INPUT_4, 0x74, "Input 4") \
+	X(CTRL_INPUT_AUX_TYPE, 0x75, "Input AUX type") \
+	X(CTRL_MODE_COMMAND_REVERSE_OBSTACLE_DURING_OPENING, 0x76, "Mode command n. rev. obstacle during opening") \
+	X(CTRL_MODE_COMMAND_REVERSE_OBSTACLE_DURING_CLOSING, 0x77, "Mode command n. rev. obstacle during closing") \
+	X(CTRL_MODE_COMMAND_REVERSE_OBSTACLE_OPEN, 0x78, "Mode command REV. OBSTACLES open") \
+	X(CTRL_MODE_COMMAND_REVERSE_OBSTACLE_CLOSE, 0x79, "Mode command REV. OBSTACLES close") \
+	X(CTRL_MODE_INPUT_RECLOSE_AFTER_PHOTO, 0x7A, "Mode input for Reclose after photo") \
+	X(CTRL_MODE_INPUT_PAUSE_TIME, 0x7B, "Mode input for Pause time") \
+	X(CTRL_INPUT_5, 0x7C, "Input 5") \
+	X(CTRL_INPUT_6, 0x7D, "Input 6") \
+	X(CTRL_BUZZER_ENABLE, 0x7F, "Buzzer enable") \
+	X(CTRL_AUTOMATIC_CLOSE, 0x80, "Automatic close") \
+	X(CTRL_PAUSE_TIME, 0x81, "Pause time") \
+	X(CTRL_AUTOMATIC_WORKING_1, 0x82, "Automatic working 1") \
+	X(CTRL_STR_CLOSE_AFTER_PHOTO, 0x83, "Close after photo") \
+	X(CTRL_RECLOSE_AFTER_PHOTO, 0x84, "Reclose after photo (activation)") \
+	X(CTRL_RECLOSE_AFTER_PHOTO_TIME, 0x85, "Time Reclose after photo") \
+	X(CTRL_RECLOSE_AFTER_PHOTO_MODE, 0x86, "Mode Reclose after photo") \
+	X(CTRL_STR_CLOSE_ALWAYS, 0x87, "Close Always") \
+	X(CTRL_ALWAYS_CLOSE, 0x88, "Always close (activation)") \
+	X(CTRL_ALWAYS_CLOSE_TIME, 0x89, "Time Always close") \
+	X(CTRL_ALWAYS_CLOSE_MODE, 0x8A, "Mode Always close") \
+	X(CTRL_STR_STAND_BY, 0x8B, "Stand-by") \
+	X(CTRL_STANDBY_ACTIVATION, 0x8C, "Stand-by (activation)") \
+	X(CTRL_STANDBY_ACTIVATION_TIME, 0x8D, "Time Stand-by") \
+	X(CTRL_STANDBY_ACTIVATION_MODE, 0x8E, "Mode Stand-by") \
+	X(CTRL_STR_TORQUE, 0x8F, "Torque") \
+	X(CTRL_STARTING_TORQUE, 0x90, "Starting torque (activation)") \
+	X(CTRL_STARTING_TORQUE_TIME, 0x91, "Time Starting torque") \
+	X(CTRL_WATER_HAMMER, 0x92, "Water hammer") \
+	X(CTRL_STR_PRE_FLASHING, 0x93, "Pre-flashing") \
+	X(CTRL_PREFLASHING, 0x94, "Preflashing (activation)") \
+	X(CTRL_PREFLASHING_TIME_OPEN, 0x95, "Time Preflashing open") \
+	X(CTRL_TYPE_INVERSION, 0x96, "Type inversion (brief or complete)") \
+	X(CTRL_COMPENSATION_SENSIBLE_BORDER, 0x97, "Compensation sensible border") \
+	X(CTRL_MODE_SLAVE, 0x98, "Mode slave") \
+	X(CTRL_PREFLASHING_TIME_CLOSE, 0x99, "Time Preflashing close") \
+	X(CTRL_BLOCK_AUTOMATISM, 0x9A, "Block automatism") \
+	X(CTRL_INTERNAL_RADIO_INH, 0x9B, "Internal radio switch") \
+	X(CTRL_KEY_LOCK, 0x9C, "Keylock") \
+	X(CTRL_WEIGHT, 0x9D, "Weight") \
+	X(CTRL_HEATING, 0x9E, "Heating") \
+	X(CTRL_BURGLARY_MODE, 0x9F, "Anti-burglary Mode") \
+	X(CTRL_ALWAYS_INVERT, 0xA0, "Always Invert") \
+	X(CTRL_WIFI_MODULE_IS_PRESENT, 0xA1, "Wifi Module is present") \
+	X(CTRL_DECELERATIONS, 0xA2, "Decelerations") \
+	X(CTRL_INVERT_MOVEMENT_DIRECTION, 0xA3, "Invert movement direction") \
+	X(CTRL_POSITION_AMPEROMETRIC_EXCLUSION, 0xA4, "Position of amperometric exclusion") \
+	X(CTRL_PULSES_SEGMENT_MAPPING, 0xA5, "Pulses per segment mapping") \
+	X(CTRL_DISABLE_CONTROL, 0xA6, "Disable control") \
+	X(CTRL_TIME_MAXIMUM_WORK, 0xA7, "Time maximum work") \
+	X(CTRL_EMERGENCY_MODE, 0xA8, "Emergency mode") \
+	X(CTRL_TEST_MODE, 0xA9, "Test mode") \
+	X(CTRL_RESERVED_1, 0xAA, "Reserved 1") \
+	X(CTRL_RESERVED_2, 0xAB, "Reserved 2") \
+	X(CTRL_MINIMUM_FREQUENCY, 0xAC, "Minimum frequency") \
+	X(CTRL_INVERTER_MODE, 0xAD, "Inverter Mode") \
+	X(CTRL_EMERGENCY_DECELERATION, 0xAE, "Emergency deceleration") \
+	X(CTRL_POSITION_PHOTO_EXCLUSION, 0xAF, "Position of PHOTO exclusion") \
+	X(CTRL_MAINTENANCE_MANAGEMENT, 0xB0, "Maintenance management") \
+	X(CTRL_THRESHOLD_ALARM_MAINTENANCE, 0xB1, "Treshold alarm mainteance") \
+	X(CTRL_MAINTENANCE_MANEUVERS_COUNTER, 0xB2, "Maintenance maneuvers counter") \
+	X(CTRL_MANEUVERS_COUNTER, 0xB3, "Total maneuvers counter") \
+	X(CTRL_MAINTENANCE_MANEUVERS_DELETE, 0xB4, "Delete mainteance maneuvers") \
+	X(CTRL_SENSITIVITY_INTERVENTION_TIME, 0xB5, "Sensitivity Intervention Time") \
+	X(CTRL_IO_EXP_BOARD, 0xB6, "I/O expansion board for modular control unit") \
+	X(CTRL_MODULAR_BOARD_OPERATIONS, 0xB7, "Modular control unit: EU or UL325 version") \
+	X(CTRL_RADIO_CODES_MANAGEMENT, 0xB8, "Radio codes management") \
+	X(CTRL_COURTESY_LIGHT_MNG, 0xB9, "Courtesy light") \
+	X(CTRL_INSTALLATION_SPEED, 0xCF, "Installation speed") \
+	X(CTRL_DIAGNOSTICS_BLUEBUS_DEVICES, 0xD0, "Diagnostics BlueBus devices") \
+	X(CTRL_DIAGNOSTICS_INPUT_OUTPUT, 0xD1, "Diagnostics inputs / outputs") \
+	X(CTRL_DIAGNOSTICS_HARDWARE, 0xD2, "Diagnostics hardware") \
+	X(CTRL_DIAGNOSTICS_OTHER, 0xD3, "Diagnostics other") \
+	X(CTRL_DIAGNOSTICS_INVERTER, 0xD4, "Diagnostics inverter") \
+	X(CTRL_DIAGNOSTICS_VISUAL, 0xD5, "Diagnostics visual") \
+	X(CTRL_LOG_8_MANEUVERS, 0xDA, "Log last 8 maneuvers") \
+	X(CTRL_ADVANCED_LOG, 0xDB, "Last 8 Advanced diagnostics status") \
+	X(CTRL_LOG_TEST_1, 0xDC, "Log test 1") \
+	X(CTRL_LOG_TEST_2, 0xDD, "Log test 2") \
+	X(CTRL_LOG_TEST_3, 0xDE, "Log test 3") \
+	X(CTRL_LOG_TEST_4, 0xDF, "Log test 4") \
+	X(CTRL_FORCE_AUTOMATIC_MINIMUM, 0xE0, "Minimum automatic force") \
+	X(CTRL_FORCE_AUTOMATIC_MAXIMUM, 0xE1, "Maximum automatic force") \
+	X(CTRL_FORCE_AUTOMATIC_SLOWING_DOWN_MAXIMUM, 0xE2, "Automatic strength for minimum slow down") \
+	X(CTRL_FORCE_AUTOMATIC_SLOWING_DOWN_MINIMUM, 0xE3, "Automatic strength for maximum slow down") \
+	X(CTRL_LOOP_SENSIBILITY, 0xE4, "Sensibility loop") \
+	X(CTRL_LOOP_CALIBRATION, 0xE5, "Calibration loop") \
+	X(CTRL_LOOP_SUPPLY, 0xE6, "Supply loop") \
+	X(CTRL_LOOP_WORKING_ACTIVATE, 0xE7, "Activate loop working") \
+	X(CTRL_LOOP_WORKING_MODE, 0xE8, "Mode loop working") \
+	X(CTRL_LOOP_RECALIBRATION_TIME, 0xE9, "Time loop recalibration") \
+	X(CTRL_LOOP_ACTIVATION_MODE, 0xEA, "Mode activation loop") \
+	X(CTRL_LOOP_ACTIVATION_TIME, 0xEB, "Time activation loop") \
+	X(CTRL_BURGLARY_LOOP_DETECT, 0xEC, "Loop Burglary function") \
+	X(CTRL_LOOP_FREQUENCY_VIEW, 0xED, "View frequency loop") \
+	X(CTRL_PRESS_TEST, 0xEE, "View pressure test") \
+	X(CTRL_TEST4, 0xEF, "Test 4") \
+	X(CTRL_STR_INSTALLATION, 0xF0, "Installation") \
+	X(CTRL_STR_PARAMETERS_MAIN, 0xF1, "Main parameters") \
+	X(CTRL_STR_PARAMETERS_ADVANCED, 0xF2, "Advanced parameters") \
+	X(CTRL_STR_POSITIONS, 0xF3, "Positions") \
+	X(CTRL_STR_SECURITY, 0xF4, "Security") \
+	X(CTRL_STR_MAINTENANCE, 0xF5, "Maintenance") \
+	X(CTRL_STR_DIAGNOSTICS, 0xF6, "Diagnostics") \
+	X(CTRL_STR_OPTIONS, 0xF7, "Options") \
+	X(CTRL_STR_SETUP_INPUTS, 0xF8, "Inputs setup") \
+	X(CTRL_STR_SETUP_OUTPUTS, 0xF9, "Outputs setup") \
+	X(CTRL_STR_SETUP_COMMANDS, 0xFA, "Commands setup") \
+	X(CTRL_STR_PASSWORD, 0xFB, "Password") \
+	X(CTRL_STR_LOOP_DETECTOR, 0xFD, "Loop detector") \
+	X(CTRL_STR_INVERTER, 0xFE, "Inverter")
+T4_SCHEMA(T4_MENU, T4Menu)
+
+// list of the command modes
+#define T4_LIST_COMMAND(X) \
+	X(NONE, 0, "Not configured") \
+	X(ASCS, 1, "Open-Stop-Close-Stop") \
+	X(ASCA, 2, "Open-Stop-Close-Open") \
+	X(ACAC, 3, "Open-Close-Open-Close") \
+	X(PP_CND1, 4, "Apartment block 1 Step-step") \
+	X(PP_CND2, 5, "Apartment block 2 Step-step") \
+	X(PP2, 6, "Step-step 2") \
+	X(UP, 7, "Person present") \
+	X(AS_CUP, 8, "Industrial mode") \
+	X(ASA, 9, "Open-Stop-Open") \
+	X(ACND1, 10, "Apartment block 1 open") \
+	X(ACND2, 11, "Apartment block 2 open)") \
+	X(A2, 12, "Open 2") \
+	X(AUP, 13, "Hold-to-run Open") \
+	X(CSC, 14, "Close-Stop-Close") \
+	X(CCND1, 15, "Apartment block 1 close") \
+	X(CCND2, 16, "Apartment block 2 close") \
+	X(C2, 17, "Close 2") \
+	X(CUP, 18, "Hold-to-run Close") \
+	X(INV, 19, "Stop and inversion") \
+	X(ALT_MOV, 20, "Temporary Stop") \
+	X(STP, 21, "Stop") \
+	X(STP_INV, 22, "Stop and brief inversion") \
+	X(ALT, 23, "Halt") \
+	X(ALT_INV, 24, "Halt and brief inversion") \
+	X(INV1, 25, "Halt and inversion") \
+	X(INT_CO, 26, "Operation during closure and opening") \
+	X(INT_C, 27, "Operation during closure") \
+	X(ALT_MOV2, 28, "Stop and inversion towards the closure") \
+	X(BLOCK_CND, 29, "Apartament block locking")
+T4_SCHEMA(T4_LIST_COMMAND, T4ListCommand)
+
+// list of the input functions
+#define T4_LIST_IN(X) \
+	X(CMD_NONE, 0, "No function") \
+	X(CMD_STST, 1, "Step by Step") \
+	X(CMD_STP, 2, "Stop") \
+	X(CMD_OPN, 3, "Open") \
+	X(CMD_CLS, 4, "Close") \
+	X(CMD_OPN_I1, 5, "Open partial 1") \
+	X(CMD_OPN_I2, 6, "Open partial 2") \
+	X(CMD_OPN_I3, 7, "Open partial 3") \
+	X(CMD_CLS_I1, 8, "Close partial 1") \
+	X(CMD_CLS_I2, 9, "Close partial 2") \
+	X(CMD_CLS_I3, 10, "Close partial 3") \
+	X(CMD_STST_CND, 11, "Apartament block Step by Step") \
+	X(CMD_STST_HP, 12, "Hi priority Step by Step") \
+	X(CMD_OPN_BLK, 13, "Open and lock") \
+	X(CMD_CLS_BLK, 14, "Close and lock") \
+	X(CMD_BLK_ON, 15, "Lock") \
+	X(CMD_BLK_OFF, 16, "Unlock") \
+	X(CMD_LDC_ON, 17, "Courtesy light on") \
+	X(CMD_LDC_PP, 18, "Courtesy light toggle") \
+	X(CMD_MS_PP, 19, "Master Step by Step") \
+	X(CMD_MS_OPN, 20, "Master open") \
+	X(CMD_MS_CLS, 21, "Master close") \
+	X(CMD_SL_PP, 22, "Slave Step by Step") \
+	X(CMD_SL_OPN, 23, "Slave open") \
+	X(CMD_SL_CLS, 24, "Slave close") \
+	X(CMD_OPN_UNB, 25, "Unlock and open") \
+	X(CMD_CLS_UNB, 26, "Unlock and close") \
+	X(CMD_ACND_ON, 27, "Enable photo command apartament block open") \
+	X(CMD_ACND_OFF, 28, "Disable photo command apartament block open") \
+	X(CMD_LOOP_ON, 29, "Enable loop input") \
+	X(CMD_LOOP_OFF, 30, "Disable loop input") \
+	X(CMD_ALT, 33, "Halt") \
+	X(CMD_FT_CMD, 34, "Photo open command") \
+	X(CMD_PHOTO, 35, "Photo command") \
+	X(CMD_PHOTO1, 36, "Photo 1 command") \
+	X(CMD_PHOTO2, 37, "Photo 2 command") \
+	X(CMD_PHOTO3, 38, "Photo 3 command") \
+	X(CMD_ALT_EM, 39, "Emergency Stop") \
+	X(CMD_EM, 40, "Emergency command") \
+	X(CMD_ALT_LOCK, 41, "Stop for interlocking function") \
+	X(CMD_SBA, 42, "SBA sensor command") \
+	X(CMD_EM_OPN, 43, "Emergency Open") \
+	X(CMD_EM_CLS, 44, "Emergency Close") \
+	X(CMD_TESTING, 48, "Command for production testing") \
+	X(CMD_BUZZER_TEST, 49, "Command for Buzzer testing") \
+	X(CMD_LDC_SWITCH_OFF, 65, "Courtesy light OFF") \
+	X(CMD_LDC_SWITCH_ON, 66, "Courtesy light ON (ON time is regulated by the Hardware)")
+T4_SCHEMA(T4_LIST_IN, T4ListIn)
+
+// list of the output functions
+#define T4_LIST_OUT(X) \
+	X(NONE, 0, "No function") \
+	X(SCA, 1, "SCA") \
+	X(MTO, 2, "Open gate") \
+	X(MTC, 3, "Close gate") \
+	X(SMN, 4, "Maintenance light") \
+	X(LGT, 5, "Lamp") \
+	X(LDC, 6, "Courtesy light") \
+	X(ELS_1, 7, "Electric lock 1") \
+	X(ELS_2, 8, "Electric lock 2") \
+	X(ELB_1, 9, "Electric lock 1") \
+	X(ELB_2, 10, "Electric lock 2") \
+	X(VNT_1, 11, "Ventosa 1") \
+	X(VNT_2, 12, "Ventosa 2") \
+	X(SPH_R, 13, "Red light") \
+	X(SPH_G, 14, "Green light") \
+	X(CHN_1, 15, "Radio Channel No 1") \
+	X(CHN_2, 16, "Radio Channel No 2") \
+	X(CHN_3, 17, "Radio Channel No 3") \
+	X(CHN_4, 18, "Radio Channel No 4") \
+	X(LGT1, 19, "Lamp 1") \
+	X(SCA1, 20, "SCA 1") \
+	X(SCA2, 21, "SCA 2") \
+	X(SON, 22, "Always on") \
+	X(LGT24V, 23, "Lamp 24V") \
+	X(OUT_LOOP_1, 24, "Output loop 1") \
+	X(OUT_LOOP_2, 25, "Output loop 2") \
+	X(LGT_1_WAY_IN, 26, "Light One Way Input") \
+	X(LGT_1_WAY_FLASH, 27, "Ligth One Way Flashing") \
+	X(LGT_ALT_WAY, 28, "Light Alternative Way") \
+	X(OUT_BUZZ, 29, "Output buzzer") \
+	X(OUT_PORT_STATE, 30, "Output port state") \
+	X(OUT_CENTR_STATE, 31, "Output central state") \
+	X(OUT_FAN, 32, "Output fan") \
+	X(LGT_1_WAY_CANADA, 33, "Light One Way for pedestrial Canada") \
+	X(INTLOCK_2_PORTS, 34, "Interlocking 2 ports") \
+	X(MANEUVER, 35, "Active exit during maneuver") \
+	X(FOTOTEST, 37, "Fototest")
+T4_SCHEMA(T4_LIST_OUT, T4ListOut)
+
+// list of the function modes
+#define T4_FUNCTIONS_MODE(X) \
+	X(OFF, 0, "Off") \
+	X(ON, 1, "On") \
+	X(MANU, 4, "Manual") \
+	X(AUTO, 5, "Automatic") \
+	X(SEMI_1, 6, "Semi automatic 1") \
+	X(SEMI_2, 7, "Semi automatic 2") \
+	X(MNVR, 8, "Maneuver") \
+	X(OPN_ALL, 16, "Open all") \
+	X(OPN_DIS, 17, "Open disengage") \
+	X(STP, 18, "Stop") \
+	X(OPN_ALL_2, 19, "Open all 2") \
+	X(CLS_ALL, 32, "Close all") \
+	X(CLS_SAVE, 33, "Save closure") \
+	X(SBY_BB, 48, "Stand-by BlueBus") \
+	X(SBY_SEC, 49, "Stand-by security") \
+	X(SBY_HRD, 50, "Stand-by all") \
+	X(SBY_AUTO, 51, "Stand-by automatic") \
+	X(STAND_BY, 52, "Stand-by automatic 2") \
+	X(PHOTO_TEST, 53, "Photo test") \
+	X(LIGHT, 54, "Light") \
+	X(HEAVY, 55, "Heavy") \
+	X(SBY_NOT_INT_WIFI, 56, "Stand-by, internal wifi on") \
+	X(ALL, 64, "All") \
+	X(LOOP, 65, "Loop") \
+	X(PHOTO, 66, "Photo") \
+	X(CMD, 67, "Command")
+T4_SCHEMA(T4_FUNCTIONS_MODE, T4FunctionsMode)
+
+// CTRL_DELETE_PARAMETERS(0x0C) values
+#define T4_DELETE(X) \
+	X(NOTHING, 0x00, "Nothing") \
+	X(POSITIONS, 0x01, "Positions") \
+	X(DEVICES, 0x02, "Devices") \
+	X(FUNCTIONS, 0x03, "Functions") \
+	X(ALL, 0x7D, "All")
+T4_SCHEMA(T4_DELETE, T4Delete)
+
+#define T4_SWITCH(X) \
+	X(OFF, 0, "Off") \
+	X(ON, 1, "On")
+T4_SCHEMA(T4_SWITCH, T4Switch)
+
+// value types of the parameters (third byte of command info), the strings are units
+#define T4_UNIT_TYPES(X) \
+	X(PCT, 0x0A, "%") \
+	X(MINUTES, 0x10, "m") \
+	X(SECONDS, 0x11, "s") \
+	X(MILLISECONDS, 0x12, "ms") \
+	X(METERS, 0x14, "m") \
+	X(CENTIMETERS, 0x15, "cm") \
+	X(DEGREES, 0x17, "°") \
+	X(NEWTON, 0x18, "N") \
+	X(AMPERE, 0x19, "A") \
+	X(MILLIAMP, 0x1A, "mA") \
+	X(VOLT, 0x1B, "V") \
+	X(MILLIVOLT, 0x1C, "mV") \
+	X(WATT, 0x1D, "W") \
+	X(MILLIWATT, 0x1E, "mW")
+
+// value types of the list parameters, the values are indices to the strings
+#define T4_LIST_TYPES(X) \
+	X(SWITCH, 0x01, T4SwitchStrings) \
+	X(LIST_IN, 0xF2, T4ListInStrings) \
+	X(LIST_COMMAND, 0xF3, T4ListCommandStrings) \
+	X(LIST_OUT, 0xF4, T4ListOutStrings) \
+	X(FUNCTIONS_MODE, 0xF5, T4FunctionsModeStrings) \
+	X(DELETE, 0xF7, T4DeleteStrings)
+
+enum class T4ValueType : uint8_t { T4_UNIT_TYPES(T4_SCHEMA_ENUM) T4_LIST_TYPES(T4_SCHEMA_ENUM) };
+
+inline constexpr auto T4ValueUnitStrings = T4_SCHEMA_STRINGS(T4_UNIT_TYPES);
+
+inline constexpr auto T4ValueLists = []()
+{
+	std::array<T4StringList, 256> table = {};
+	T4_LIST_TYPES(T4_SCHEMA_LIST)
+	return table;
+}();
+
+#endif
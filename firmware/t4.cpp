@@ -15,6 +15,7 @@
 */
 
 #include "t4.h"
+#include "analyzer.h"
 
 const int RX_LED = 26;
 const int TX_LED = 27;
@@ -26,32 +27,43 @@ void T4Client::init()
 	pinMode(RX_LED, OUTPUT);
 	pinMode(TX_LED, OUTPUT);
 
-	m_rxQueue = xQueueCreate(32, sizeof(T4Packet));
-	m_txQueue = xQueueCreate(32, sizeof(T4Packet));
+	m_rxQueue = createQueue(m_rxQueueBuffer);
+	m_txQueue = createQueue(m_txQueueBuffer);
 
-	m_unit.mutex = xSemaphoreCreateMutex();
+	m_unit.mutex = createMutex(m_unitMutexBuffer);
 
-	m_requestEvent = xEventGroupCreate();
+	m_requestEvent = createEventGroup(m_requestEventBuffer);
 	xEventGroupSetBits(m_requestEvent, EB_REQUEST_FREE);
-
-	xTaskCreate(uartTaskThunk, "t4_uartTask", 8192, this, 10, &m_uartTaskHandle);
-	xTaskCreate(scanTaskThunk, "t4_scanTask", 8192, this, 5, &m_scanTaskHandle);
-	xTaskCreate(consumerTaskThunk, "t4_consumerTask", 8192, this, 5, &m_consumerTaskHandle);
+	m_requestMutex = createMutex(m_requestMutexBuffer);
+	m_batchMutex = createMutex(m_batchMutexBuffer);
+	m_statsMutex = createMutex(m_statsMutexBuffer);
+	m_latencyScratchMutex = createMutex(m_latencyScratchMutexBuffer);
+
+	createTask(uartTaskThunk, m_uartTaskBuffer, this, &m_uartTaskHandle);
+	createTask(scanTaskThunk, m_scanTaskBuffer, this, &m_scanTaskHandle);
+	createTask(consumerTaskThunk, m_consumerTaskBuffer, this, &m_consumerTaskHandle);
 }
 
 void T4Client::uartTask()
 {
 	T4Packet rx_packet;
 	uint8_t rx_packet_checksum = 0;
+	uint32_t rx_packet_start = 0;
 	enum { WAIT = 0, TYPE, SIZE, DATA, CHECKSUM, COMPLETE, RESET } rx_state = WAIT;
 
 	for (;;)
 	{
+		m_uartTime.store(millis(), std::memory_order_relaxed);
 		digitalWrite(RX_LED, rx_state == WAIT);
 
 		uint8_t byte;
 		if (m_serial.readBytes(&byte, sizeof(byte)) == sizeof(byte))
 		{
+			uint32_t now = micros();
+
+			if (m_analyzer)
+				m_analyzer->onByte();
+
 			if (rx_state != WAIT)
 				rx_packet.data[rx_packet.size++] = byte;
 
@@ -59,14 +71,19 @@ void T4Client::uartTask()
 			{
 				case WAIT:
 					rx_state = (byte == 0x00) ? TYPE : RESET;
+					rx_packet_start = now;
 					break;
 
 				case TYPE:
 					rx_state = (byte == 0x55 || byte == 0xF0) ? SIZE : RESET;
+					if (rx_state == RESET && m_analyzer)
+						m_analyzer->onError(FRAMING_ERROR);
 					break;
 
 				case SIZE:
 					rx_state = (byte <= 60) ? DATA : RESET;
+					if (rx_state == RESET && m_analyzer)
+						m_analyzer->onError(FRAMING_ERROR);
 					break;
 
 				case DATA:
@@ -77,14 +94,37 @@ void T4Client::uartTask()
 
 				case CHECKSUM:
 					if (byte == rx_packet_checksum)
-						xQueueSend(m_rxQueue, &rx_packet, portMAX_DELAY);
+					{
+						rx_packet.time = rx_packet_start;
+						rx_packet.received = now;
+
+						if (m_analyzer)
+							m_analyzer->onFrame(rx_packet, rx_packet_start, now);
+
+						// the UART task must never block, the bus would go deaf
+						if (!queueSendDropOldest(m_rxQueue, rx_packet))
+							m_rxDropped.fetch_add(1, std::memory_order_relaxed);
+					}
+					else if (m_analyzer)
+					{
+						m_analyzer->onError(CHECKSUM_ERROR);
+					}
 
 					rx_state = RESET;
 					break;
+
+				case COMPLETE:
+				case RESET:
+					// neither state lasts until the next byte
+					break;
 			}
 		}
 		else
 		{
+			// timeout in the middle of a packet
+			if (rx_state != WAIT && m_analyzer)
+				m_analyzer->onError(TIMEOUT_ERROR);
+
 			rx_state = RESET;
 		}
 
@@ -149,9 +189,11 @@ void T4Client::scanTask()
 				{
 					// Serial.println("CTRL_STR_COMMANDS[info] received");
 
-					size_t commands_count = reply.message.dmp.data[4];
-					const uint8_t* commands = &reply.message.dmp.data[5];
-					m_unit.commands = std::vector<uint8_t>(commands, commands + commands_count);
+					// the list can't be longer than the data of the reply
+					const uint8_t* data = reply.message.dmp.data;
+					size_t data_size = std::max(reply.header.messageSize, uint8_t(6)) - 6;
+					size_t commands_count = (data_size > 5) ? std::min<size_t>(data[4], data_size - 5) : 0;
+					m_unit.commands = std::vector<uint8_t>(data + 5, data + 5 + commands_count);
 				}
 			}
 			else if (!m_unit.menuComplete)
@@ -162,14 +204,15 @@ void T4Client::scanTask()
 				{
 					// Serial.println("STD_MENU[get] received");
 
-					size_t records_count = (reply.header.messageSize - 6) / 2;
+					size_t records_count = (std::max(reply.header.messageSize, uint8_t(6)) - 6) / 2;
 					size_t records_last = reply.message.dmp.sequence / 2;
+					if (records_count > records_last)
+						records_count = records_last;
 					size_t records_first = records_last - records_count;
-					auto records = (const uint16_t*)&reply.message.dmp.data;
 
+					// records are at odd offset of the packet, they're copied to be read aligned
 					m_unit.menu.resize(records_last);
-					for (size_t n = 0; n < records_count; ++n)
-						m_unit.menu[records_first + n] = records[n];
+					memcpy(m_unit.menu.data() + records_first, reply.message.dmp.data, records_count * sizeof(uint16_t));
 
 					m_unit.menuComplete = (reply.message.dmp.flags & FIN);
 				}
@@ -227,23 +270,47 @@ void T4Client::consumerTask()
 	T4Packet packet;
 	while (xQueueReceive(m_rxQueue, &packet, portMAX_DELAY))
 	{
+		m_dispatchStart.store(std::max<uint32_t>(millis(), 1), std::memory_order_relaxed);
 		// Serial.printf("Packet received: %u\r\n", packet.size);
 
-		if (xEventGroupGetBits(m_requestEvent) & EB_REQUEST_PENDING)
+		// the reply is stored under the mutex, so it never lands in the buffer of a request which has already timed out
+		if (xSemaphoreTake(m_requestMutex, portMAX_DELAY))
 		{
-			if (m_requestPacket.header.from == packet.header.to &&
+			if (m_requestPending &&
+				m_requestPacket.header.from == packet.header.to &&
 				m_requestPacket.header.protocol == packet.header.protocol &&
 				m_requestPacket.message.device == packet.message.device &&
 				m_requestPacket.message.command == packet.message.command)
 			{
-				xEventGroupClearBits(m_requestEvent, EB_REQUEST_PENDING);
-				xEventGroupSetBits(m_requestEvent, EB_REQUEST_FREE);
+				m_requestPending = false;
 
 				if (m_replyPacket)
 					*m_replyPacket = packet;
 
 				xEventGroupSetBits(m_requestEvent, EB_REQUEST_COMPLETE);
 			}
+
+			xSemaphoreGive(m_requestMutex);
+		}
+
+		if (xSemaphoreTake(m_batchMutex, portMAX_DELAY))
+		{
+			for (auto request = m_batch; request && request < m_batch + m_batchCount; ++request)
+			{
+				if (request->state == REQUEST_PENDING &&
+					packet.header.to == T4ThisAddress &&
+					packet.header.protocol == DMP &&
+					request->message[0] == packet.message.device &&
+					request->message[1] == packet.message.command)
+				{
+					request->reply = packet;
+					request->state = REQUEST_DONE;
+					xEventGroupSetBits(m_requestEvent, EB_BATCH_REPLY);
+					break;
+				}
+			}
+
+			xSemaphoreGive(m_batchMutex);
 		}
 
 //		Serial.println("Packet received");
@@ -251,20 +318,179 @@ void T4Client::consumerTask()
 //			Serial.printf("%02X", packet.data[n]);
 //		Serial.println();
 
-		if (m_callback)
-			m_callback(packet);
+		size_t subscriptions_count = m_subscriptionsCount.load(std::memory_order_acquire);
+		for (auto subscription = m_subscriptions; subscription < m_subscriptions + subscriptions_count; ++subscription)
+		{
+			if (!subscription->matcher.match(packet))
+				continue;
+
+			if (subscription->subscriber)
+			{
+				m_dispatchSubscriber.store(subscription->name, std::memory_order_relaxed);
+				subscription->subscriber->onPacket(packet);
+				m_dispatchSubscriber.store(nullptr, std::memory_order_relaxed);
+				subscription->delivered.fetch_add(1, std::memory_order_relaxed);
+			}
+			else if (!queueSendDropOldest(subscription->queue, packet))
+			{
+				subscription->dropped.fetch_add(1, std::memory_order_relaxed);
+			}
+			else
+			{
+				subscription->delivered.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		m_dispatchStart.store(0, std::memory_order_relaxed);
+
+		uint32_t latency = micros() - packet.received;
+		if (xSemaphoreTake(m_statsMutex, portMAX_DELAY))
+		{
+			m_latency[m_frames++ % T4LatencySamples] = latency;
+			m_latencyMax = std::max(m_latencyMax, latency);
+			xSemaphoreGive(m_statsMutex);
+		}
 	}
 
 	m_consumerTaskHandle = nullptr;
 	vTaskDelete(nullptr);
 }
 
-bool T4Client::send(T4Packet& packet)
+T4Matcher::T4Matcher(const T4Filter& filter)
+{
+	auto set = [this](size_t index, uint8_t mask, uint8_t value)
+	{
+		m_mask |= uint64_t(mask) << ((index - OFFSET) * 8);
+		m_value |= uint64_t(value & mask) << ((index - OFFSET) * 8);
+		m_size = std::max<uint8_t>(m_size, index + 1);
+	};
+
+	// offsets in T4Packet::data
+	if (filter.mask & T4Filter::DESTINATION)
+	{
+		uint8_t destination[2] = { filter.destination.address, filter.destination.endpoint };
+		m_destinationMask = 0xFFFF;
+		memcpy(&m_destinationValue, destination, sizeof(destination));
+		m_size = std::max<uint8_t>(m_size, DESTINATION_OFFSET + 2);
+	}
+	if (filter.mask & T4Filter::SOURCE)
+	{
+		set(4, 0xFF, filter.source.address);
+		set(5, 0xFF, filter.source.endpoint);
+	}
+	if (filter.mask & T4Filter::DEVICE)
+		set(9, 0xFF, filter.device);
+	if (filter.mask & T4Filter::COMMAND)
+		set(10, 0xFF, filter.command);
+	if (filter.mask & T4Filter::FLAGS)
+	{
+		set(6, 0xFF, DMP);
+		set(11, filter.flags, filter.flags);
+	}
+}
+
+bool T4Client::subscribe(const char* name, T4Subscriber& subscriber, const T4Filter& filter)
+{
+	return subscribe(name, &subscriber, nullptr, filter);
+}
+
+bool T4Client::subscribe(const char* name, QueueHandle_t queue, const T4Filter& filter)
+{
+	return queue && subscribe(name, nullptr, queue, filter);
+}
+
+bool T4Client::subscribe(const char* name, T4Subscriber* subscriber, QueueHandle_t queue, const T4Filter& filter)
+{
+	// the consumer task reads the slots up to the count, so the slot is filled before the count is published
+	size_t index = m_subscriptionsCount.load();
+	if (index >= T4MaxSubscribers)
+		return false;
+
+	auto& subscription = m_subscriptions[index];
+	subscription.name = name;
+	subscription.subscriber = subscriber;
+	subscription.queue = queue;
+	subscription.matcher = T4Matcher(filter);
+	m_subscriptionsCount.store(index + 1, std::memory_order_release);
+	return true;
+}
+
+size_t T4Client::getSubscriberStats(T4SubscriberStats* stats, size_t count)
+{
+	count = std::min(count, m_subscriptionsCount.load(std::memory_order_acquire));
+	for (size_t n = 0; n < count; ++n)
+	{
+		auto& subscription = m_subscriptions[n];
+		stats[n] = { subscription.name, subscription.queue != nullptr, subscription.delivered.load(std::memory_order_relaxed), subscription.dropped.load(std::memory_order_relaxed) };
+		if (subscription.queue)
+		{
+			stats[n].queueUsed = uxQueueMessagesWaiting(subscription.queue);
+			stats[n].queueSize = stats[n].queueUsed + uxQueueSpacesAvailable(subscription.queue);
+		}
+	}
+
+	return count;
+}
+
+void T4Client::getLatencyStats(T4LatencyStats& stats)
 {
-	return xQueueSend(m_txQueue, &packet, portMAX_DELAY);
+	// the samples are selected in the scratch buffer, so the consumer task isn't held by it and nothing is allocated
+	if (!xSemaphoreTake(m_latencyScratchMutex, portMAX_DELAY))
+		return;
+
+	if (!xSemaphoreTake(m_statsMutex, portMAX_DELAY))
+	{
+		xSemaphoreGive(m_latencyScratchMutex);
+		return;
+	}
+
+	auto latency = m_latencyScratch;
+	size_t count = std::min<size_t>(m_frames, T4LatencySamples);
+	memcpy(latency, m_latency, count * sizeof(uint32_t));
+	stats.frames = m_frames;
+	stats.latencyMax = m_latencyMax;
+
+	xSemaphoreGive(m_statsMutex);
+
+	// p99 is found first, p50 then only among the samples below it
+	size_t p99 = count * 99 / 100;
+	size_t p50 = count * 50 / 100;
+	std::nth_element(latency, latency + p99, latency + count);
+	std::nth_element(latency, latency + p50, latency + p99);
+	stats.latency50 = count ? latency[p50] : 0;
+	stats.latency99 = count ? latency[p99] : 0;
+
+	xSemaphoreGive(m_latencyScratchMutex);
 }
 
-bool T4Client::sendRequest(uint8_t type, T4Source to, T4Source from, uint8_t protocol, uint8_t* messageData, uint8_t messageSize, T4Packet* reply, uint8_t retry)
+void T4Client::resetLatencyStats()
+{
+	if (xSemaphoreTake(m_statsMutex, portMAX_DELAY))
+	{
+		m_frames = 0;
+		m_latencyMax = 0;
+		xSemaphoreGive(m_statsMutex);
+	}
+}
+
+void T4Client::getHealth(T4Health& health)
+{
+	health.uartTime = m_uartTime.load(std::memory_order_relaxed);
+	health.dispatchStart = m_dispatchStart.load(std::memory_order_relaxed);
+	health.dispatchSubscriber = m_dispatchSubscriber.load(std::memory_order_relaxed);
+	health.rxQueueUsed = uxQueueMessagesWaiting(m_rxQueue);
+	health.rxQueueSize = health.rxQueueUsed + uxQueueSpacesAvailable(m_rxQueue);
+	health.txQueueUsed = uxQueueMessagesWaiting(m_txQueue);
+	health.txQueueSize = health.txQueueUsed + uxQueueSpacesAvailable(m_txQueue);
+	health.rxDropped = m_rxDropped.load(std::memory_order_relaxed);
+}
+
+bool T4Client::send(T4Packet& packet, TickType_t timeout)
+{
+	return xQueueSend(m_txQueue, &packet, timeout);
+}
+
+bool T4Client::sendRequest(uint8_t type, T4Source to, T4Source from, uint8_t protocol, uint8_t* messageData, uint8_t messageSize, T4Packet* reply, uint8_t retry, uint32_t timeout)
 {
 	do
 	{
@@ -272,25 +498,29 @@ bool T4Client::sendRequest(uint8_t type, T4Source to, T4Source from, uint8_t pro
 
 		// Serial.println("Request about to transmit");
 
+		T4Packet packet(type, to, from, protocol, messageData, messageSize);
+
+		xSemaphoreTake(m_requestMutex, portMAX_DELAY);
+		m_requestPacket = packet;
 		m_replyPacket = reply;
+		m_requestPending = true;
+		xSemaphoreGive(m_requestMutex);
 
-		m_requestPacket = T4Packet(type, to, from, protocol, messageData, messageSize);
-		xEventGroupSetBits(m_requestEvent, EB_REQUEST_PENDING);
-		send(m_requestPacket);
+		send(packet);
 
-		bool success = false;
-		if (xEventGroupWaitBits(m_requestEvent, EB_REQUEST_COMPLETE, true, true, 500) & EB_REQUEST_COMPLETE)
-		{
-			// Serial.println("Reply received");
+		xEventGroupWaitBits(m_requestEvent, EB_REQUEST_COMPLETE, true, true, timeout);
 
-			success = true;
-		}
-		else
-		{
+		// reply coming right after the timeout still counts, once the request isn't pending the consumer doesn't touch it
+		xSemaphoreTake(m_requestMutex, portMAX_DELAY);
+		bool success = !m_requestPending;
+		m_requestPending = false;
+		m_replyPacket = nullptr;
+		xSemaphoreGive(m_requestMutex);
+
+		if (!success)
 			Serial.printf("Waiting for reply timed out (%u:%02X:%02X, retry:%u)\r\n", protocol, messageData[0], messageData[1], retry);
-		}
 
-		xEventGroupClearBits(m_requestEvent, EB_REQUEST_PENDING | EB_REQUEST_COMPLETE);
+		xEventGroupClearBits(m_requestEvent, EB_REQUEST_COMPLETE);
 		xEventGroupSetBits(m_requestEvent, EB_REQUEST_FREE);
 
 		if (success)
@@ -301,6 +531,73 @@ bool T4Client::sendRequest(uint8_t type, T4Source to, T4Source from, uint8_t pro
 	return false;
 }
 
+size_t T4Client::sendRequests(T4Source to, T4Request* requests, size_t count, uint8_t window, uint8_t retry, uint32_t timeout)
+{
+	// the batch occupies the request engine, single requests wait until it's finished
+	xEventGroupWaitBits(m_requestEvent, EB_REQUEST_FREE, true, true, portMAX_DELAY);
+
+	xSemaphoreTake(m_batchMutex, portMAX_DELAY);
+	m_batch = requests;
+	m_batchCount = count;
+	xSemaphoreGive(m_batchMutex);
+
+	for (;;)
+	{
+		xEventGroupClearBits(m_requestEvent, EB_BATCH_REPLY);
+
+		xSemaphoreTake(m_batchMutex, portMAX_DELAY);
+
+		uint32_t now = millis();
+		size_t pending = 0;
+		size_t finished = 0;
+		for (auto request = requests; request < requests + count; ++request)
+		{
+			if (request->state == REQUEST_PENDING && now - request->sentTime >= timeout)
+			{
+				Serial.printf("Waiting for reply timed out (%u:%02X:%02X, retry:%u)\r\n", DMP, request->message[0], request->message[1], retry + 1 - request->attempts);
+				request->state = (request->attempts > retry) ? REQUEST_FAILED : REQUEST_QUEUED;
+			}
+
+			if (request->state == REQUEST_PENDING)
+				pending++;
+			else if (request->state != REQUEST_QUEUED)
+				finished++;
+		}
+
+		// keep the window of requests in flight
+		for (auto request = requests; request < requests + count && pending < window; ++request)
+		{
+			if (request->state != REQUEST_QUEUED)
+				continue;
+
+			// the mutex blocks dispatch of received frames, so a full TX queue isn't waited for, the request stays queued
+			T4Packet packet(0x55, to, T4ThisAddress, DMP, request->message, request->messageSize);
+			if (!send(packet, 0))
+				break;
+			request->state = REQUEST_PENDING;
+			request->attempts++;
+			request->sentTime = now;
+			pending++;
+		}
+
+		xSemaphoreGive(m_batchMutex);
+
+		if (finished == count)
+			break;
+
+		xEventGroupWaitBits(m_requestEvent, EB_BATCH_REPLY, true, false, 10);
+	}
+
+	xSemaphoreTake(m_batchMutex, portMAX_DELAY);
+	m_batch = nullptr;
+	m_batchCount = 0;
+	xSemaphoreGive(m_batchMutex);
+
+	xEventGroupSetBits(m_requestEvent, EB_REQUEST_FREE);
+
+	return std::count_if(requests, requests + count, [](const auto& request) { return request.state == REQUEST_DONE; });
+}
+
 T4Packet::T4Packet(uint8_t type, T4Source to, T4Source from, uint8_t protocol, uint8_t* messageData, uint8_t messageSize)
 {
 	// packet type
@@ -0,0 +1,43 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "tasks.h"
+
+// tasks are registered from setup(), before anything reads the list
+struct
+{
+	const TaskConfig* config;
+	TaskHandle_t handle;
+} tasks[MaxTasks];
+size_t tasksCount = 0;
+
+void registerTask(const TaskConfig& config, TaskHandle_t handle)
+{
+	if (handle && tasksCount < MaxTasks)
+		tasks[tasksCount++] = { &config, handle };
+}
+
+size_t getTaskStats(TaskStats* stats, size_t count)
+{
+	count = std::min(count, tasksCount);
+	for (size_t n = 0; n < count; ++n)
+	{
+		auto config = tasks[n].config;
+		stats[n] = { config->name, config->core, config->priority, config->stackSize, uxTaskGetStackHighWaterMark(tasks[n].handle) };
+	}
+
+	return count;
+}
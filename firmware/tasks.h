@@ -0,0 +1,168 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <Arduino.h>
+
+// tasks, queues and other primitives are allocated statically when set, so their memory is accounted at link time
+// and never competes with the heap
+#ifndef STATIC_ALLOCATION
+#define STATIC_ALLOCATION 0
+#endif
+
+// Wi-Fi and lwIP tasks of the core run on PRO_CPU, so the bus tasks are kept on APP_CPU, where they compete
+// only with the Arduino loop() (priority 1), and everything talking to the network stays with the stack
+const BaseType_t CORE_NETWORK = PRO_CPU_NUM;
+const BaseType_t CORE_BUS = APP_CPU_NUM;
+
+struct TaskConfig
+{
+	const char* name;
+	uint32_t stackSize;
+	UBaseType_t priority;
+	BaseType_t core;		// tskNO_AFFINITY lets the scheduler choose
+};
+
+// bus path: bytes -> frames -> dispatch to the modules
+inline constexpr TaskConfig TASK_T4_UART = { "t4_uartTask", 8192, 10, CORE_BUS };
+inline constexpr TaskConfig TASK_T4_CONSUMER = { "t4_consumerTask", 8192, 8, CORE_BUS };
+inline constexpr TaskConfig TASK_T4_SCAN = { "t4_scanTask", 8192, 3, CORE_BUS };
+inline constexpr TaskConfig TASK_T4_RECORDER = { "t4_recorderTask", 4096, 2, CORE_BUS };
+
+// network side, below lwIP (18) and Wi-Fi (23) tasks
+inline constexpr TaskConfig TASK_T4_PROXY = { "t4_proxyTask", 4096, 4, CORE_NETWORK };
+inline constexpr TaskConfig TASK_T4_RPC = { "t4_rpcTask", 4096, 4, CORE_NETWORK };
+inline constexpr TaskConfig TASK_T4_BRIDGE = { "t4_bridgeTask", 4096, 3, CORE_NETWORK };
+inline constexpr TaskConfig TASK_T4_WATCHDOG = { "t4_watchdogTask", 4096, 6, CORE_NETWORK };
+inline constexpr TaskConfig TASK_HTTP_SERVER = { "httpd", 6144, 5, CORE_NETWORK };
+inline constexpr TaskConfig TASK_HTTP_WORKER = { "http_workerTask", 6144, 2, CORE_NETWORK };
+inline constexpr TaskConfig TASK_WIFI_CHECK = { "wifi_checkTask", 4096, 1, CORE_NETWORK };
+inline constexpr TaskConfig TASK_WIFI_SIGNAL = { "wifi_signalTask", 4096, 1, CORE_NETWORK };
+
+constexpr size_t HTTP_WORKERS = 3;
+
+// lengths of the queues (in items)
+constexpr size_t QUEUE_T4_RX = 32;
+constexpr size_t QUEUE_T4_TX = 32;
+constexpr size_t QUEUE_PROXY = 32;
+constexpr size_t QUEUE_PROXY_RPC = 8;
+constexpr size_t QUEUE_HTTP_JOBS = 8;
+constexpr size_t QUEUE_WIFI_EVENTS = 8;
+
+// memory of the objects, kept by their owners, empty when the objects are allocated from the heap
+#if STATIC_ALLOCATION
+template <const TaskConfig& config>
+struct TaskBuffer
+{
+	StaticTask_t task;
+	StackType_t stack[config.stackSize / sizeof(StackType_t)];
+};
+
+template <typename T, size_t length>
+struct QueueBuffer
+{
+	StaticQueue_t queue;
+	uint8_t storage[length * sizeof(T)];
+};
+
+typedef StaticSemaphore_t MutexBuffer;
+typedef StaticEventGroup_t EventGroupBuffer;
+#else
+template <const TaskConfig& config>
+struct TaskBuffer {};
+
+template <typename T, size_t length>
+struct QueueBuffer {};
+
+struct MutexBuffer {};
+struct EventGroupBuffer {};
+#endif
+
+void registerTask(const TaskConfig& config, TaskHandle_t handle);
+
+template <const TaskConfig& config>
+bool createTask(TaskFunction_t function, TaskBuffer<config>& buffer, void* parameter, TaskHandle_t* handle)
+{
+#if STATIC_ALLOCATION
+	TaskHandle_t task = xTaskCreateStaticPinnedToCore(function, config.name, config.stackSize, parameter, config.priority, buffer.stack, &buffer.task, config.core);
+#else
+	TaskHandle_t task = nullptr;
+	xTaskCreatePinnedToCore(function, config.name, config.stackSize, parameter, config.priority, &task, config.core);
+#endif
+
+	registerTask(config, task);
+	if (handle)
+		*handle = task;
+	return task;
+}
+
+template <typename T, size_t length>
+QueueHandle_t createQueue(QueueBuffer<T, length>& buffer)
+{
+#if STATIC_ALLOCATION
+	return xQueueCreateStatic(length, sizeof(T), buffer.storage, &buffer.queue);
+#else
+	return xQueueCreate(length, sizeof(T));
+#endif
+}
+
+inline SemaphoreHandle_t createMutex(MutexBuffer& buffer)
+{
+#if STATIC_ALLOCATION
+	return xSemaphoreCreateMutexStatic(&buffer);
+#else
+	return xSemaphoreCreateMutex();
+#endif
+}
+
+inline EventGroupHandle_t createEventGroup(EventGroupBuffer& buffer)
+{
+#if STATIC_ALLOCATION
+	return xEventGroupCreateStatic(&buffer);
+#else
+	return xEventGroupCreate();
+#endif
+}
+
+// never blocks, when the queue is full its oldest item is dropped to make space (and false is returned)
+template <typename T>
+bool queueSendDropOldest(QueueHandle_t queue, const T& item)
+{
+	if (xQueueSend(queue, &item, 0))
+		return true;
+
+	T oldest;
+	xQueueReceive(queue, &oldest, 0);
+	xQueueSend(queue, &item, 0);
+	return false;
+}
+
+struct TaskStats
+{
+	const char* name;
+	BaseType_t core;
+	UBaseType_t priority;
+	uint32_t stackSize;
+	uint32_t stackFree;		// high-water mark, the least free stack since the start of the task (in bytes)
+};
+
+constexpr size_t MaxTasks = 16;
+
+size_t getTaskStats(TaskStats* stats, size_t count);
+
+#endif
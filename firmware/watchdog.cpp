@@ -0,0 +1,175 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "watchdog.h"
+
+const char* WatchdogSloStrings[SLO_COUNT] = { "UART task alive", "Frame dispatch time", "Frame latency p99", "Receive queue", "Subscriber queue" };
+
+// objectives, times in milliseconds, queues in percent of their length
+const uint32_t WatchdogSloLimits[SLO_COUNT] = { 500, 100, 20, 75, 75 };
+
+const uint32_t CHECK_INTERVAL = 250;
+
+// when the UART or consumer task makes no progress for this time, the bus path is dead and the module is restarted
+const uint32_t STALL_RESTART_TIME = 30000;
+
+// cause of the forced restart survives in RTC memory
+struct WatchdogRestart
+{
+	uint32_t magic;
+	WatchdogBreach breach;
+};
+
+const uint32_t RESTART_MAGIC = 0x57444F47;
+
+RTC_NOINIT_ATTR WatchdogRestart rtcRestart;
+
+void T4Watchdog::init()
+{
+	m_mutex = createMutex(m_mutexBuffer);
+
+	if (rtcRestart.magic == RESTART_MAGIC)
+	{
+		m_stats.restarted = true;
+		m_stats.lastRestart = rtcRestart.breach;
+	}
+	rtcRestart.magic = 0;
+
+	createTask(watchdogTaskThunk, m_watchdogTaskBuffer, this, &m_watchdogTaskHandle);
+}
+
+void T4Watchdog::watchdogTask()
+{
+	for (;;)
+	{
+		vTaskDelay(CHECK_INTERVAL);
+
+		T4Health health;
+		m_client.getHealth(health);
+
+		T4LatencyStats latency;
+		m_client.getLatencyStats(latency);
+
+		T4SubscriberStats subscribers[T4MaxSubscribers];
+		size_t subscribers_count = m_client.getSubscriberStats(subscribers, T4MaxSubscribers);
+
+		const char* fullest = "";
+		uint32_t fullest_fill = 0;
+		for (auto subscriber = subscribers; subscriber < subscribers + subscribers_count; ++subscriber)
+		{
+			uint32_t fill = subscriber->queueSize ? subscriber->queueUsed * 100 / subscriber->queueSize : 0;
+			if (fill > fullest_fill)
+			{
+				fullest = subscriber->name;
+				fullest_fill = fill;
+			}
+		}
+
+		uint32_t now = millis();
+		uint32_t uart_idle = now - health.uartTime;
+		uint32_t dispatch_time = health.dispatchStart ? now - health.dispatchStart : 0;
+		const char* dispatcher = health.dispatchSubscriber ? health.dispatchSubscriber : TASK_T4_CONSUMER.name;
+
+		check(SLO_UART_ALIVE, uart_idle, TASK_T4_UART.name, health);
+		check(SLO_DISPATCH_TIME, dispatch_time, dispatcher, health);
+		check(SLO_LATENCY, latency.latency99 / 1000, TASK_T4_CONSUMER.name, health);
+		check(SLO_RX_QUEUE, health.rxQueueSize ? health.rxQueueUsed * 100 / health.rxQueueSize : 0, TASK_T4_CONSUMER.name, health);
+		check(SLO_SUBSCRIBER_QUEUE, fullest_fill, fullest, health);
+
+		// queues already drop the oldest frames instead of blocking, restart is the last resort when a task is stuck
+		if (uart_idle >= STALL_RESTART_TIME || dispatch_time >= STALL_RESTART_TIME)
+		{
+			if (uart_idle >= STALL_RESTART_TIME)
+				rtcRestart.breach = createBreach(SLO_UART_ALIVE, uart_idle, TASK_T4_UART.name, health);
+			else
+				rtcRestart.breach = createBreach(SLO_DISPATCH_TIME, dispatch_time, dispatcher, health);
+			rtcRestart.magic = RESTART_MAGIC;
+
+			Serial.printf("Watchdog: %s stalled, restarting\r\n", rtcRestart.breach.task);
+			ESP.restart();
+		}
+	}
+
+	m_watchdogTaskHandle = nullptr;
+	vTaskDelete(nullptr);
+}
+
+void T4Watchdog::check(WatchdogSlo slo, uint32_t value, const char* task, const T4Health& health)
+{
+	bool breached = value > WatchdogSloLimits[slo];
+
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return;
+
+	// breach is recorded when it starts, not for every check it lasts
+	if (breached && !m_stats.breached[slo])
+	{
+		m_stats.breaches[slo]++;
+		m_breaches[m_breachesCount++ % WatchdogBreaches] = createBreach(slo, value, task, health);
+		Serial.printf("Watchdog: %s %u over %u (%s)\r\n", WatchdogSloStrings[slo], value, WatchdogSloLimits[slo], task);
+	}
+
+	m_stats.breached[slo] = breached;
+	m_stats.value[slo] = value;
+
+	xSemaphoreGive(m_mutex);
+}
+
+WatchdogBreach T4Watchdog::createBreach(WatchdogSlo slo, uint32_t value, const char* task, const T4Health& health)
+{
+	WatchdogBreach breach = {};
+	breach.time = millis();
+	breach.slo = slo;
+	breach.value = value;
+	snprintf(breach.task, sizeof(breach.task), "%s", task);
+	breach.rxQueueUsed = health.rxQueueUsed;
+	breach.txQueueUsed = health.txQueueUsed;
+	breach.rxDropped = health.rxDropped;
+	return breach;
+}
+
+void T4Watchdog::getStats(WatchdogStats& stats)
+{
+	if (xSemaphoreTake(m_mutex, portMAX_DELAY))
+	{
+		stats = m_stats;
+		xSemaphoreGive(m_mutex);
+	}
+}
+
+// the most recent first
+size_t T4Watchdog::getBreaches(WatchdogBreach* breaches, size_t count)
+{
+	if (!xSemaphoreTake(m_mutex, portMAX_DELAY))
+		return 0;
+
+	count = std::min({ count, m_breachesCount, WatchdogBreaches });
+	for (size_t n = 0; n < count; ++n)
+		breaches[n] = m_breaches[(m_breachesCount - 1 - n) % WatchdogBreaches];
+
+	xSemaphoreGive(m_mutex);
+	return count;
+}
+
+const char* T4Watchdog::getSloString(WatchdogSlo slo)
+{
+	return (slo < SLO_COUNT) ? WatchdogSloStrings[slo] : "";
+}
+
+uint32_t T4Watchdog::getSloLimit(WatchdogSlo slo)
+{
+	return (slo < SLO_COUNT) ? WatchdogSloLimits[slo] : 0;
+}
@@ -0,0 +1,88 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <Arduino.h>
+
+#include "t4.h"
+
+enum WatchdogSlo : uint8_t
+{
+	SLO_UART_ALIVE,			// time since the last loop of the UART task (ms)
+	SLO_DISPATCH_TIME,		// time the consumer task spends on one frame (ms)
+	SLO_LATENCY,			// p99 of time from reception of the frame to the end of its dispatch (ms)
+	SLO_RX_QUEUE,			// fill of the receive queue (%)
+	SLO_SUBSCRIBER_QUEUE,	// fill of the fullest queue of a subscriber (%)
+	SLO_COUNT
+};
+
+struct WatchdogBreach
+{
+	uint32_t time;			// millis() when the breach started
+	WatchdogSlo slo;
+	uint32_t value;
+	char task[16];			// task or subscriber the breach is attributed to
+	uint8_t rxQueueUsed;
+	uint8_t txQueueUsed;
+	uint32_t rxDropped;
+};
+
+struct WatchdogStats
+{
+	bool breached[SLO_COUNT];	// the objective isn't met now
+	uint32_t value[SLO_COUNT];	// last measured value
+	uint32_t breaches[SLO_COUNT];
+	bool restarted;				// the last restart was forced by the watchdog, lastRestart is its cause
+	WatchdogBreach lastRestart;
+};
+
+constexpr size_t WatchdogBreaches = 8;
+
+class T4Watchdog
+{
+public:
+	T4Watchdog(T4Client& client) : m_client(client) {}
+
+	void init();
+
+	void watchdogTask();
+	static void watchdogTaskThunk(void* self) { ((T4Watchdog*)self)->watchdogTask(); }
+
+	void getStats(WatchdogStats& stats);
+	size_t getBreaches(WatchdogBreach* breaches, size_t count);
+
+	static const char* getSloString(WatchdogSlo slo);
+	static uint32_t getSloLimit(WatchdogSlo slo);
+
+private:
+	void check(WatchdogSlo slo, uint32_t value, const char* task, const T4Health& health);
+	WatchdogBreach createBreach(WatchdogSlo slo, uint32_t value, const char* task, const T4Health& health);
+
+	T4Client& m_client;
+
+	TaskHandle_t m_watchdogTaskHandle = nullptr;
+	TaskBuffer<TASK_T4_WATCHDOG> m_watchdogTaskBuffer;
+	SemaphoreHandle_t m_mutex = nullptr;
+	MutexBuffer m_mutexBuffer;
+
+	WatchdogStats m_stats = {};
+	WatchdogBreach m_breaches[WatchdogBreaches] = {};
+	size_t m_breachesCount = 0;
+};
+
+#endif
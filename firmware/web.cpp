@@ -17,47 +17,108 @@
 #include <WiFi.h>
 
 #include "web.h"
+#include "webstream.h"
+#include "auth.h"
+#include "assets.h"
 #include "t4.h"
+#include "decode.h"
+#include "apply.h"
+#include "api.h"
+#include "analyzer.h"
+#include "recorder.h"
+#include "bridge.h"
+#include "watchdog.h"
+#include "wireless.h"
+#include "boot.h"
+#include "tasks.h"
 
 extern T4Client t4;
+extern T4Analyzer analyzer;
+extern T4Recorder recorder;
+extern T4Bridge bridge;
+extern T4Watchdog watchdog;
 
-WebServer web_server(80);
+HttpServer web_server;
 
 String basePath("/");
 
-void authenticate()
+WebAuth web_auth;
+
+const char* SESSION_COOKIE = "t4session";
+
+void startSession(HttpRequest& request)
+{
+	auto token = web_auth.createSession();
+	request.sendHeader("Set-Cookie", String(SESSION_COOKIE) + "=" + token + "; Path=" + basePath + "; Max-Age=" + String(WebSessionTimeout / 1000) + "; HttpOnly; SameSite=Strict");
+}
+
+bool authenticate(HttpRequest& request)
 {
-	if ((web_server.client().remoteIP() & 0x00FFFFFF) == (WiFi.gatewayIP() & 0x00FFFFFF))
+	if (uint32_t(request.remoteIP()) && (request.remoteIP() & 0x00FFFFFF) == (WiFi.gatewayIP() & 0x00FFFFFF))
 		// requests from local network require no authentication
-		return;
+		return true;
 
-	static const char* login = "login";
-	static const char* password = "fa9beb99e4029ad5a6615399e7bbae21356086b3"; // SHA1 hash of "changeme"
-	if (web_server.authenticateBasicSHA1(login, password))
+	if (web_auth.checkSession(request.cookie(SESSION_COOKIE)))
 		// already authenticated
-		return;
+		return true;
+
+	// clients using Basic authentication get the session cookie too, so the password isn't hashed on every request
+	String login, password;
+	if (request.getBasicCredentials(login, password))
+	{
+		if (web_auth.checkCredentials(login, password))
+		{
+			startSession(request);
+			return true;
+		}
+
+		if (auto lockout = web_auth.getLockout())
+		{
+			request.sendHeader("Retry-After", String((lockout + 999) / 1000));
+			request.send(429, "text/plain", "Too many failed attempts");
+			return false;
+		}
+	}
+
+	if (request.uri().startsWith(basePath + "api/"))
+	{
+		request.requestAuthentication();
+	}
+	else
+	{
+		request.sendHeader("Location", basePath + "login");
+		request.send(303, "text/plain", "Redirect");
+	}
 
-	web_server.requestAuthentication();
+	return false;
 }
 
-String header(const char* title = nullptr)
+void header(WebStream& html, const char* title = nullptr)
 {
-	return R"(
+	html += R"(
+<meta charset="utf-8"/>
 <meta name="viewport" content="width=device-width, initial-scale=0.6"/>
-<title>Nice T4 Web-Access)" + (title ? " " + String(title) : "") + R"(</title>
-<style>
-	* { font-family: sans-serif }
-	H1 { background-color: #01569D; color:white; padding:5px }
-	A { color: #01569D; text-decoration:none }
-	BUTTON { background-color: #01569D; color:white; border:0; padding:50px; margin-bottom:5px; width:100%; display-block }
-	INPUT[type=submit] { background-color: #01569D; color:white; border:0; padding:10px }
-	#footer, #footer A { color:#808080; font-size:12px }
-</style>)";
+<title>Nice T4 Web-Access)";
+	if (title)
+	{
+		html += ' ';
+		html += title;
+	}
+	html += "</title>";
+
+	// assets are cached by the browser forever, the version in query string changes with their content
+	for (const auto& asset : WebAssets)
+	{
+		if (!strcmp(asset.contentType, "text/css"))
+			html += "\n<link rel=\"stylesheet\" href=\"" + basePath + asset.path + "?v=" + asset.etag + "\"/>";
+		else
+			html += "\n<script src=\"" + basePath + asset.path + "?v=" + asset.etag + "\" defer></script>";
+	}
 }
 
-String footer()
+void footer(WebStream& html)
 {
-	return R"(
+	html += R"(
 <br/>
 <div id="footer">
 	Nice T4 Web-Access<br/>
@@ -65,38 +126,74 @@ String footer()
 </div>)";
 }
 
-String createSelect(uint8_t command, uint8_t value, const char* const strings[], size_t stringsCount, uint8_t* list, uint8_t listSize)
+class HtmlFieldSink : public T4FieldSink
 {
-	String html;
-	html += "<select id=\"p" + String(command) + "\" onchange=\"this.name=this.id\">";
+public:
+	HtmlFieldSink(WebStream& html) : m_html(html) {}
 
-	for (size_t n = 0; n < listSize; ++n)
+	void onField(const T4Field& field) override
 	{
-		auto m = list[n];
+		m_html += "<tr><td>";
+		m_html += field.label;
+		m_html += "</td><td>";
+		if (field.text)
+			m_html += field.text;
+		else if (field.scale != 1)
+			m_html += String(float(field.value) / field.scale, 2);
+		else
+			m_html += String(field.value);
+		if (field.unit)
+		{
+			m_html += ' ';
+			m_html += field.unit;
+		}
+		m_html += "</td></tr>";
+	}
+
+private:
+	WebStream& m_html;
+};
+
+void createSelect(WebStream& html, uint8_t command, uint8_t value, const T4Parameter& parameter)
+{
+	html += "<select id=\"p" + String(command) + "\">";
+
+	for (size_t n = 0; n < parameter.membersCount; ++n)
+	{
+		auto m = parameter.members[n];
 		html += "<option value=\"" + String(m) + "\"" + (value == m ? " selected" : "") + ">";
-		if (m < stringsCount)
-			html += strings[m];
+		if (auto string = parameter.getString(m))
+			html += string;
 		html += "</option>";
 	}
 
 	html += "</select>";
-	return html;
 }
 
-void web_root()
+void web_root(HttpRequest& request)
 {
-	authenticate();
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "root");
 
 	if (!t4.lockUnit())
-		return web_server.send(500, "text/plain", "Error");
+		return request.send(500, "text/plain", "Error");
 
 	auto& unit = t4.getUnit();
 
-	String html = header();
+	html.begin(200, "text/html");
+	header(html);
 	html += "<h1>Nice T4 Web-Access</h1>";
-	html += "Wi-Fi RSSI: " + String(WiFi.RSSI()) + " dBm<br/><br/>";
+	WifiStats wifi_stats;
+	getWifiStats(wifi_stats);
+	html += "Wi-Fi RSSI: " + String(WiFi.RSSI()) + " dBm (average " + String(wifi_stats.rssiAverage, 0) + " dBm, trend " + String(wifi_stats.rssiTrend, 1) + " dB)<br/>";
+	html += "Wi-Fi disconnects: " + String(wifi_stats.disconnects) + " (beacon losses " + String(wifi_stats.beaconLosses) + ", last reason " + String(wifi_stats.lastReason) + "), probe misses: " + String(wifi_stats.probeMisses) + ", forced reconnects: " + String(wifi_stats.escalations) + "<br/>";
+	html += "Wi-Fi reconnect time: " + String(wifi_stats.lastReconnectTime) + " ms (max. " + String(wifi_stats.maxReconnectTime) + " ms)<br/><br/>";
 	html += "Control unit address: " + String(unit.source.address) + ":" + String(unit.source.endpoint) + "<br/>";
 
+	html.flush();
+
 	T4Packet reply;
 
 	// CTRL_POSITION_CURRENT(0x11)
@@ -108,15 +205,20 @@ void web_root()
 	message[1] = 0x01;
 	if (t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3))
 	{
-		uint8_t automation_status = reply.message.dmp.data[0];
-		if (automation_status < std::size(T4AutomationStatusStrings) && T4AutomationStatusStrings[automation_status])
-			html += "Automation status: " + String(T4AutomationStatusStrings[automation_status]) + "<br/>";
+		if (auto automation_status = getAutomationStatusString(reply.message.dmp.data[0]))
+			html += "Automation status: " + String(automation_status) + "<br/>";
 	}
 
 	html += "<br/>";
 	html += "<a href=\"" + basePath + "configure\">Configure</a><br/>";
 	html += "<a href=\"" + basePath + "log\">Log</a><br/>";
 	html += "<a href=\"" + basePath + "status\">Status</a><br/>";
+	html += "<a href=\"" + basePath + "recorder\">Recorder</a><br/>";
+	html += "<a href=\"" + basePath + "analyzer\">Analyzer</a><br/>";
+	html += "<a href=\"" + basePath + "bridge\">Bridge</a><br/>";
+	html += "<a href=\"" + basePath + "perf\">Performance</a><br/>";
+	html += "<a href=\"" + basePath + "wifi\">Wi-Fi</a><br/>";
+	html += "<a href=\"" + basePath + "account\">Account</a><br/>";
 	html += "<br/>";
 
 	for (auto command : unit.commands)
@@ -124,30 +226,33 @@ void web_root()
 
 	t4.unlockUnit();
 
-	html += footer();
-
-	web_server.send(200, "text/html", html);
+	footer(html);
 }
 
-void web_configure_get()
+void web_configure_get(HttpRequest& request)
 {
-	authenticate();
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "configure");
 
 	if (!t4.lockUnit())
-		return web_server.send(500, "text/plain", "Error");
+		return request.send(500, "text/plain", "Error");
 
 	auto& unit = t4.getUnit();
 
-	auto root = web_server.arg("root").toInt();
+	auto root = request.arg("root").toInt();
 
 	auto root_menu_it = std::find_if(unit.menu.begin(), unit.menu.end(), [root](const auto& m) { return (m >> 8) == root; });
 	if (root_menu_it == unit.menu.end())
 	{
-		web_server.send(400, "text/plain", "Bad request");
+		t4.unlockUnit();
+		request.send(400, "text/plain", "Bad request");
 		return;
 	}
 
-	String html = header("Configuration");
+	html.begin(200, "text/html");
+	header(html, "Configuration");
 
 	html += "<h1>";
 	html += "Configuration";
@@ -212,106 +317,52 @@ void web_configure_get()
 			html += "</td><td>";
 			if (command_info)
 			{
+				// rows rendered so far are sent while waiting for the reply
+				html.flush();
+
 				T4Packet reply;
 				uint8_t message[5] = { CONTROLLER, command, REQ|GET|ACK|FIN, 0x00, 0x00 };
 				if (t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, sizeof(message), &reply, 3))
 				{
-					size_t value_size = command_info[0] & 0x7F;
-					uint64_t value = 0;
-					for (uint8_t n = 0; n < value_size; ++n)
-						value = (value << 8) | reply.message.dmp.data[n];
+					auto parameter = getParameter(command_info);
+					uint64_t value = decodeParameter(command_info, reply);
 
-					if (command_info[3] & 0x40)
+					if (parameter.kind == PARAMETER_LIST)
 					{
-						// list
-						if (command_info[2] == 0x01)
-						{
-							static const char* on_off_strings[] = { "Off", "On" };
-							html += createSelect(command, uint8_t(value), on_off_strings, std::size(on_off_strings), &command_info[5], command_info[4]);
-						}
-						else if (command_info[2] == 0xF2)
-						{
-							html += createSelect(command, uint8_t(value), T4ListInStrings, std::size(T4ListInStrings), &command_info[5], command_info[4]);
-						}
-						else if (command_info[2] == 0xF3)
-						{
-							html += createSelect(command, uint8_t(value), T4ListCommandStrings, std::size(T4ListCommandStrings), &command_info[5], command_info[4]);
-						}
-						else if (command_info[2] == 0xF4)
-						{
-							html += createSelect(command, uint8_t(value), T4ListOutStrings, std::size(T4ListOutStrings), &command_info[5], command_info[4]);
-						}
-						else if (command_info[2] == 0xF5)
-						{
-							html += createSelect(command, uint8_t(value), T4FunctionsModeStrings, std::size(T4FunctionsModeStrings), &command_info[5], command_info[4]);
-						}
-						else if (command_info[2] == 0xF7)
-						{
-							const char* delete_strings[256] = { "Nothing", "Positions", "Devices", "Functions" };
-							delete_strings[0x7D] = "All";
-							html += createSelect(command, uint8_t(value), delete_strings, std::size(delete_strings), &command_info[5], command_info[4]);
-						}
+						if (parameter.strings)
+							createSelect(html, command, uint8_t(value), parameter);
 					}
-					else if (command_info[1] == 0x03)
+					else if (parameter.kind == PARAMETER_TEXT)
 					{
-						// text
 						html += "<input value=\"" + String((const char*)&reply.message.dmp.data[1]) + "\" disabled/>";
 					}
 					else
 					{
-						// range
-						html += "<input id=\"p" + String(command) + "\" value=\"" + String(value) + "\" onchange=\"this.name=this.id\"/>";
-
-						if (command_info[1] == 0x25)
+						// known range is checked by the browser already
+						html += "<input id=\"p" + String(command) + "\" value=\"" + String(value) + "\"";
+						if (parameter.max)
 						{
-							// function type VIRTUAL_POSITION(0x25) seems to be always in millimeters, don't know why the unit doesn't report correct type info
-							html += " mm";
+							html += " type=\"number\" min=\"" + String(parameter.min) + "\" max=\"" + String(parameter.max) + "\"";
+							if (parameter.step)
+								html += " step=\"" + String(parameter.step) + "\"";
 						}
-						else
+						html += "/>";
+
+						if (parameter.unit)
 						{
-							switch (command_info[2])
-							{
-								case 0x0A: html += " %"; break;		// PCT
-								case 0x10: html += " m"; break;		// MINUTES
-								case 0x11: html += " s"; break;		// SECONDS
-								case 0x12: html += " ms"; break;	// MILLISECONDS
-								case 0x14: html += " m"; break;		// METERS
-								case 0x15: html += " cm"; break;	// CENTIMETERS
-								case 0x17: html += " &deg;"; break;	// DEGREES
-								case 0x18: html += " N"; break;		// NEWTON
-								case 0x19: html += " A"; break;		// AMPERE
-								case 0x1A: html += " mA"; break;	// MILLIAMP
-								case 0x1B: html += " V"; break;		// VOLT
-								case 0x1C: html += " mV"; break;	// MILLIVOLT
-								case 0x1D: html += " W"; break;		// WATT
-								case 0x1E: html += " mW"; break;	// MILLIWATT
-							}
+							html += ' ';
+							html += parameter.unit;
 						}
 
-						uint8_t* info_ptr = &command_info[4];
-						auto info_pop = [&](size_t n)
-						{
-							uint64_t value = 0;
-							while (n-- > 0)
-								value = (value << 8) | *info_ptr++;
-							return value;
-						};
-						uint64_t min = info_pop(value_size);
-						uint64_t max = info_pop(value_size);
-						uint64_t step = info_pop(value_size);
-						uint64_t scale = info_pop(sizeof(uint16_t));
-						bool divide = command_info[3] & 0x10;
-						bool multiply = command_info[3] & 0x20;
-
-						if (max)
+						if (parameter.max)
 						{
-							html += " (" + String(min) + "&#8209;" + String(max);
-							if (step)
-								html += ":" + String(step);
-							if (divide)
-								html += "/" + String(scale);
-							else if (multiply)
-								html += "*" + String(scale);
+							html += " (" + String(parameter.min) + "&#8209;" + String(parameter.max);
+							if (parameter.step)
+								html += ":" + String(parameter.step);
+							if (parameter.divide)
+								html += "/" + String(parameter.scale);
+							else if (parameter.multiply)
+								html += "*" + String(parameter.scale);
 							html += ")";
 						}
 					}
@@ -333,7 +384,7 @@ void web_configure_get()
 	html += "</table>\n";
 
 	if (show_save)
-		html += "<input type=\"submit\" value=\"Save\"/>";
+		html += "<label><input type=\"checkbox\" name=\"rollback\" value=\"1\" checked/> Roll back all if any write fails</label><br/><input type=\"submit\" value=\"Save\"/>";
 
 	html += "</form>\n";
 
@@ -342,25 +393,30 @@ void web_configure_get()
 		html += "configure?root=" + String(upper_root);
 	html += "\">&Ll; Back</a><br/>";
 
-	html += footer();
-
-	web_server.send(200, "text/html", html);
+	footer(html);
 }
 
-void web_configure_post()
+void web_configure_post(HttpRequest& request)
 {
-	authenticate();
+	if (!authenticate(request))
+		return;
 
 	if (!t4.lockUnit())
-		return web_server.send(500, "text/plain", "Error");
+		return request.send(500, "text/plain", "Error");
 
 	auto& unit = t4.getUnit();
 
-	auto root = web_server.arg("root").toInt();
+	auto root = request.arg("root").toInt();
+	bool rollback = request.hasArg("rollback");
+
+	T4ApplyWrite writes[T4ApplyMaxWrites];
+	size_t writes_count = 0;
+	String errors;
 
-	for (size_t n = 0; n < web_server.args(); ++n)
+	// all the values are validated before anything is written to the unit
+	for (size_t n = 0; n < request.args(); ++n)
 	{
-		auto arg_name = web_server.argName(n);
+		auto arg_name = request.argName(n);
 		if (arg_name[0] != 'p')
 			continue;
 		char* number_end;
@@ -368,36 +424,63 @@ void web_configure_post()
 		if (!command || command > 0xFF || *number_end)
 			continue;
 
-		auto arg_value = web_server.arg(n).toInt();
-
 		auto command_info = unit.commandsInfo[command].get();
 		if (!command_info)
 			continue;
 
-		uint8_t message[5 + 32] = { CONTROLLER, uint8_t(command), REQ|SET|ACK|FIN, 0x00, 0x00 };
+		auto arg_value = request.arg(n).toInt();
 
-		size_t value_size = command_info[0] & 0x7F;
-		for (uint8_t n = 0; n < value_size; ++n)
-			message[5 + n] = ((const uint8_t*)&arg_value)[value_size - n - 1];
+		auto error = (arg_value < 0) ? PARAMETER_BELOW_MIN : validateParameter(getParameter(command_info), arg_value);
+		if (error != PARAMETER_VALID)
+		{
+			errors += "<tr><td>" + String(T4MenuStrings[command]) + "</td><td>" + String(arg_value) + "</td><td>" + getParameterErrorString(error) + "</td></tr>\n";
+			continue;
+		}
 
-		T4Packet reply;
-		t4.sendRequest(0x55, unit.source, T4ThisAddress, DMP, message, 5 + value_size, &reply, 3);
+		if (writes_count < std::size(writes))
+			writes[writes_count++] = { uint8_t(command), uint64_t(arg_value) };
 	}
 
+	bool success = false;
+	if (!errors.length())
+		success = applyParameters(t4, unit, writes, writes_count, rollback);
+
 	t4.unlockUnit();
 
-	web_server.sendHeader("Location", "?root=" + String(root));
-	web_server.send(303, "text/plain", "Redirect");
+	WebStream html(request, "configure");
+	html.begin(errors.length() ? 400 : 200, "text/html");
+	header(html, "Configuration");
+
+	if (errors.length())
+	{
+		html += "<h1>Rejected values</h1>\n<table>\n";
+		html += errors;
+		html += "</table>\nNothing was written to the unit.<br/>";
+	}
+	else
+	{
+		html += success ? "<h1>Configuration saved</h1>\n" : "<h1>Configuration failed</h1>\n";
+		html += "<table>\n";
+		for (size_t n = 0; n < writes_count; ++n)
+			html += "<tr><td>" + String(T4MenuStrings[writes[n].command]) + "</td><td>" + String(writes[n].value) + "</td><td>" + getApplyResultString(writes[n].result) + "</td></tr>\n";
+		html += "</table>\n";
+	}
+
+	html += "<br/><a href=\"?root=" + String(root) + "\">&Ll; Back</a><br/>";
+	footer(html);
 }
 
-void web_diagnostics()
+void web_diagnostics(HttpRequest& request)
 {
-	authenticate();
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "diagnostics");
 
-	auto root = web_server.arg("root").toInt();
+	auto root = request.arg("root").toInt();
 
 	if (!t4.lockUnit())
-		return web_server.send(500, "text/plain", "Error");
+		return request.send(500, "text/plain", "Error");
 
 	auto& unit = t4.getUnit();
 
@@ -409,285 +492,46 @@ void web_diagnostics()
 
 	if (reply_ok && command_info)
 	{
-		String html = header("Diagnostics");
+		html.begin(200, "text/html");
+		header(html, "Diagnostics");
 
-		switch (command_info[2])
+		auto block = getDiagnosticsBlock(command_info);
+		if (block)
 		{
-			case 0xE1:
-			{
-				html += "<h1>Diagnostics / Inputs/Outputs</h1>\n";
-
-				const auto data = reply.message.dmp.data;
-				const auto info = &command_info[5];
-
-				html += "<table>\n";
-
-				if (info[0] & 0x01)
-					html += "<tr><td>Input halt</td><td>" + String((data[0] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[0] & 0x02)
-					html += "<tr><td>Input 1 PP</td><td>" + String((data[0] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[0] & 0x04)
-					html += "<tr><td>Input 2 AP</td><td>" + String((data[0] & 0x04) ? "On" : "Off") + "</td></tr>";
-				if (info[0] & 0x08)
-					html += "<tr><td>Input 3 CH</td><td>" + String((data[0] & 0x08) ? "On" : "Off") + "</td></tr>";
-				if (info[0] & 0x10)
-					html += "<tr><td>Loop 1</td><td>" + String((data[0] & 0x10) ? "On" : "Off") + "</td></tr>";
-				if (info[0] & 0x20)
-					html += "<tr><td>Loop 2</td><td>" + String((data[0] & 0x20) ? "On" : "Off") + "</td></tr>";
-
-				if (info[1] & 0x01)
-					html += "<tr><td>Button 1</td><td>" + String((data[1] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[1] & 0x02)
-					html += "<tr><td>Button 2</td><td>" + String((data[1] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[1] & 0x04)
-					html += "<tr><td>Button 3</td><td>" + String((data[1] & 0x04) ? "On" : "Off") + "</td></tr>";
-
-				if (info[2] & 0x01)
-					html += "<tr><td>Fca M1</td><td>" + String((data[2] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[2] & 0x02)
-					html += "<tr><td>Fcc M1</td><td>" + String((data[2] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[2] & 0x04)
-					html += "<tr><td>Fca M2</td><td>" + String((data[2] & 0x04) ? "On" : "Off") + "</td></tr>";
-				if (info[2] & 0x08)
-					html += "<tr><td>Fcc M2</td><td>" + String((data[2] & 0x08) ? "On" : "Off") + "</td></tr>";
-				if (info[2] & 0x10)
-					html += "<tr><td>Unlock M1</td><td>" + String((data[2] & 0x10) ? "On" : "Off") + "</td></tr>";
-				if (info[2] & 0x20)
-					html += "<tr><td>Unlock M2</td><td>" + String((data[2] & 0x20) ? "On" : "Off") + "</td></tr>";
-				if (info[2] & 0x40)
-					html += "<tr><td>Selection direction</td><td>" + String((data[2] & 0x40) ? "Left" : "Right") + "</td></tr>";
-				if (info[2] & 0x80)
-					html += "<tr><td>Selection engine</td><td>" + String((data[2] & 0x80) ? "Left" : "Right") + "</td></tr>";
-
-				if (info[3] & 0x01)
-					html += "<tr><td>State enc M1</td><td>" + String((data[3] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[3] & 0x02)
-					html += "<tr><td>State enc M2</td><td>" + String((data[3] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[3] & 0x04)
-					html += "<tr><td>Input enc M1</td><td>" + String((data[3] & 0x04) ? "On" : "Off") + "</td></tr>";
-				if (info[3] & 0x08)
-					html += "<tr><td>Input enc M2</td><td>" + String((data[3] & 0x08) ? "On" : "Off") + "</td></tr>";
-
-				if (info[4] & 0x01)
-					html += "<tr><td>Output M1</td><td>" + String((data[4] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[4] & 0x02)
-					html += "<tr><td>Output M2</td><td>" + String((data[4] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[4] & 0x04)
-					html += "<tr><td>Output 1</td><td>" + String((data[4] & 0x04) ? "On" : "Off") + "</td></tr>";
-				if (info[4] & 0x08)
-					html += "<tr><td>Output 2</td><td>" + String((data[4] & 0x08) ? "On" : "Off") + "</td></tr>";
-				if (info[4] & 0x10)
-					html += "<tr><td>Output 3</td><td>" + String((data[4] & 0x10) ? "On" : "Off") + "</td></tr>";
-				if (info[4] & 0x20)
-					html += "<tr><td>Output fan</td><td>" + String((data[4] & 0x20) ? "On" : "Off") + "</td></tr>";
-				if (info[4] & 0x40)
-					html += "<tr><td>Green light signal</td><td>" + String((data[4] & 0x40) ? "On" : "Off") + "</td></tr>";
-				if (info[4] & 0x80)
-					html += "<tr><td>Red light signal</td><td>" + String((data[4] & 0x80) ? "On" : "Off") + "</td></tr>";
-
-				if (info[5] == 0xFF)
-				{
-					html += "<tr><td>State halt</td><td>";
-					switch (data[5])
-					{
-						case 0:
-							html += "Not set";
-							break;
-						case 1:
-							html += "B1";
-							break;
-						case 2:
-							html += "B2";
-							break;
-						case 3:
-							html += "NC";
-							break;
-						case 4:
-							html += "NO";
-							break;
-						case 5:
-							html += "Out of range";
-							break;
-						case 6:
-							html += "Border OSE";
-							break;
-						default:
-							html += "-";
-							break;
-					}
-					html += "</td></tr>";
-				}
-
-				if (info[6] & 0x01)
-					html += "<tr><td>Input radio 1</td><td>" + String((data[6] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[6] & 0x02)
-					html += "<tr><td>Input radio 2</td><td>" + String((data[6] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[6] & 0x04)
-					html += "<tr><td>Input radio 3</td><td>" + String((data[6] & 0x04) ? "On" : "Off") + "</td></tr>";
-				if (info[6] & 0x08)
-					html += "<tr><td>Input radio 4</td><td>" + String((data[6] & 0x08) ? "On" : "Off") + "</td></tr>";
-
-				if (info[7] & 0x01)
-					html += "<tr><td>Input T4 mode 1/1</td><td>" + String((data[7] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[7] & 0x02)
-					html += "<tr><td>Input T4 mode 1/2</td><td>" + String((data[7] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[7] & 0x04)
-					html += "<tr><td>Input T4 mode 1/3</td><td>" + String((data[7] & 0x04) ? "On" : "Off") + "</td></tr>";
-				if (info[7] & 0x08)
-					html += "<tr><td>Input T4 mode 1/4</td><td>" + String((data[7] & 0x08) ? "On" : "Off") + "</td></tr>";
-
-				if (info[8] == 0xFF)
-					html += "<tr><td>Input T4 mode 2</td><td>" + String(data[8]) + "</td></tr>";
-
-				if (info[9] & 0x01)
-					html += "<tr><td>Thermal</td><td>" + String((data[9] & 0x01) ? "On" : "Off") + "</td></tr>";
-				if (info[9] & 0x02)
-					html += "<tr><td>Heating</td><td>" + String((data[9] & 0x02) ? "On" : "Off") + "</td></tr>";
-				if (info[9] & 0x04)
-					html += "<tr><td>Stand-by</td><td>" + String((data[9] & 0x04) ? "On" : "Off") + "</td></tr>";
-				if (info[9] & 0x08)
-					html += "<tr><td>Battery</td><td>" + String((data[9] & 0x08) ? "On" : "Off") + "</td></tr>";
-				if (info[9] & 0x10)
-					html += "<tr><td>Power supply requency</td><td>" + String((data[9] & 0x10) ? "60 Hz" : "50 Hz") + "</td></tr>";
-				if (info[9] & 0x20)
-					html += "<tr><td>Automatic opening</td><td>" + String((data[9] & 0x20) ? "On" : "Off") + "</td></tr>";
-
-				if (info[10] & 0x01)
-					html += "<tr><td>Error positions</td><td>" + String((data[10] & 0x01) ? "KO" : "OK") + "</td></tr>";
-				if (info[10] & 0x02)
-					html += "<tr><td>Error BlueBus</td><td>" + String((data[10] & 0x02) ? "KO" : "OK") + "</td></tr>";
-				if (info[10] & 0x04)
-					html += "<tr><td>Error halt</td><td>" + String((data[10] & 0x04) ? "KO" : "OK") + "</td></tr>";
-				if (info[10] & 0x08)
-					html += "<tr><td>Error function</td><td>" + String((data[10] & 0x08) ? "KO" : "OK") + "</td></tr>";
-				if (info[10] & 0x10)
-					html += "<tr><td>Error regulations</td><td>" + String((data[10] & 0x10) ? "KO" : "OK") + "</td></tr>";
-				if (info[10] & 0x20)
-					html += "<tr><td>Error map 1</td><td>" + String((data[10] & 0x20) ? "KO" : "OK") + "</td></tr>";
-				if (info[10] & 0x40)
-					html += "<tr><td>Error map 2</td><td>" + String((data[10] & 0x40) ? "KO" : "OK") + "</td></tr>";
-
-				if (info[11] == 0xFF)
-				{
-					html += "<tr><td>State manoeuvre limiter</td><td>";
-					switch (data[11])
-					{
-						case 0:
-							html += "OK";
-							break;
-						case 1:
-							html += "Threshold 1";
-							break;
-						case 2:
-							html += "Threshold 2";
-							break;
-						case 3:
-							html += "Alarm engine";
-							break;
-						default:
-							html += "-";
-							break;
-					}
-					html += "</td></tr>";
-				}
-
-				if (info[12] & 0x01)
-					html += "<tr><td>Overload output 1</td><td>" + String((data[12] & 0x01) ? "OK" : "KO") + "</td></tr>";
-				if (info[12] & 0x02)
-					html += "<tr><td>Overload output 2</td><td>" + String((data[12] & 0x02) ? "OK" : "KO") + "</td></tr>";
-				if (info[12] & 0x04)
-					html += "<tr><td>Overload output 3</td><td>" + String((data[12] & 0x04) ? "OK" : "KO") + "</td></tr>";
-				if (info[12] & 0x10)
-					html += "<tr><td>Overtravel low enc M1</td><td>" + String((data[12] & 0x10) ? "On" : "Off") + "</td></tr>";
-				if (info[12] & 0x20)
-					html += "<tr><td>Overtravel high enc M1</td><td>" + String((data[12] & 0x20) ? "On" : "Off") + "</td></tr>";
-				if (info[12] & 0x40)
-					html += "<tr><td>Overtravel low enc M2</td><td>" + String((data[12] & 0x40) ? "On" : "Off") + "</td></tr>";
-				if (info[12] & 0x80)
-					html += "<tr><td>Overtravel high enc M2</td><td>" + String((data[12] & 0x80) ? "On" : "Off") + "</td></tr>";
-
-				if ((reply.header.messageSize - 6) >= 14)
-				{
-					if (info[14] & 0x01)
-						html += "<tr><td>Input 4</td><td>" + String((data[14] & 0x01) ? "On" : "Off") + "</td></tr>";
-					if (info[14] & 0x02)
-						html += "<tr><td>Input 5</td><td>" + String((data[14] & 0x02) ? "On" : "Off") + "</td></tr>";
-					if (info[14] & 0x04)
-						html += "<tr><td>Input 6</td><td>" + String((data[14] & 0x04) ? "On" : "Off") + "</td></tr>";
-					if (info[15] & 0x01)
-						html += "<tr><td>Output 4</td><td>" + String((data[15] & 0x01) ? "On" : "Off") + "</td></tr>";
-					if (info[15] & 0x02)
-						html += "<tr><td>Output 5</td><td>" + String((data[15] & 0x02) ? "On" : "Off") + "</td></tr>";
-					if (info[15] & 0x04)
-						html += "<tr><td>Output 6</td><td>" + String((data[15] & 0x04) ? "On" : "Off") + "</td></tr>";
-				}
-
-				html += "</table>\n";
-				break;
-			}
-
-			case 0xE2:
-			{
-				html += "<h1>Diagnostics / Hardware</h1>";
-
-				const auto data = (uint16_t*)reply.message.dmp.data;
-				const auto info = (uint16_t*)&command_info[5];
-
-				html += "<table>\n";
-
-				if (info[0] & 0x0080)
-					html += "<tr><td>Work time</td><td>" + String(std::byteswap(data[0])) + " s</td></tr>";
-				if (info[1] & 0x0080)
-					html += "<tr><td>Pause time</td><td>" + String(std::byteswap(data[1])) + " s</td></tr>";
-				if (info[2] & 0x0080)
-					html += "<tr><td>Courtesy light</td><td>" + String(std::byteswap(data[2])) + " s</td></tr>";
-				if (info[3] & 0x0080)
-					html += "<tr><td>Bus average current</td><td>" + String(std::byteswap(data[3])) + " %</td></tr>";
-				if (info[4] & 0x0080)
-					html += "<tr><td>Service voltage</td><td>" + String(std::byteswap(data[4])) + " V</td></tr>";
-				if (info[5] & 0x0080)
-					html += "<tr><td>Torque M1</td><td>" + String(std::byteswap(data[5])) + " %</td></tr>";
-				if (info[6] & 0x0080)
-					html += "<tr><td>Torque M2</td><td>" + String(std::byteswap(data[6])) + " %</td></tr>";
-				if (info[7] & 0x0080)
-					html += "<tr><td>Temperature</td><td>" + String(std::byteswap(data[7])) + " &deg;C</td></tr>";
-				if (info[8] & 0x0080)
-					html += "<tr><td>Voltage M1</td><td>" + String(std::byteswap(data[8])) + " V</td></tr>";
-				if (info[9] & 0x0080)
-					html += "<tr><td>Voltage M2</td><td>" + String(std::byteswap(data[9])) + " V</td></tr>";
-				if (info[10] & 0x0080)
-					html += "<tr><td>Speed M1</td><td>" + String(std::byteswap(data[10])) + " %</td></tr>";
-				if (info[11] & 0x0080)
-					html += "<tr><td>Speed M2</td><td>" + String(std::byteswap(data[11])) + " %</td></tr>";
-
-				html += "</table>\n";
-				break;
-			}
-
-			default:
-				html += "Not supported";
-				break;
+			html += "<h1>Diagnostics / ";
+			html += block->title;
+			html += "</h1>\n";
+
+			html += "<table>\n";
+			HtmlFieldSink sink(html);
+			decodeDiagnostics(*block, command_info, reply, sink);
+			html += "</table>\n";
+		}
+		else
+		{
+			html += "Not supported";
 		}
 
 		html += "<br/><a href=\"" + basePath + "configure?root=246\">&Ll; Back</a><br/>";
-		html += footer();
-
-		web_server.send(200, "text/html", html);
+		footer(html);
 	}
 	else
 	{
-		web_server.send(500, "text/plain", "Error");
+		request.send(500, "text/plain", "Error");
 	}
 
 	t4.unlockUnit();
 }
 
-void web_log()
+void web_log(HttpRequest& request)
 {
-	authenticate();
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "log");
 
 	if (!t4.lockUnit())
-		return web_server.send(500, "text/plain", "Error");
+		return request.send(500, "text/plain", "Error");
 
 	auto& unit = t4.getUnit();
 
@@ -700,37 +544,39 @@ void web_log()
 
 	if (reply_ok)
 	{
-		String html = header("Log");
+		html.begin(200, "text/html");
+		header(html, "Log");
 
 		html += "<h1>Manoeuvers log</h1>";
 
 		for (size_t n = 0; n < 8; ++n)
 		{
 			auto log = reply.message.dmp.data[n];
-			if (log < std::size(T4ManoeuvreStatusStrings))
-				html += String(T4ManoeuvreStatusStrings[log]);
+			if (auto log_string = getManoeuvreStatusString(log))
+				html += log_string;
 			else
 				html += "UNKNOWN(" + String(log) + ")";
 			html += "<br/>";
 		}
 
 		html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
-		html += footer();
-
-		web_server.send(200, "text/html", html);
+		footer(html);
 	}
 	else
 	{
-		web_server.send(500, "text/plain", "Error");
+		request.send(500, "text/plain", "Error");
 	}
 }
 
-void web_status()
+void web_status(HttpRequest& request)
 {
-	authenticate();
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "status");
 
 	if (!t4.lockUnit())
-		return web_server.send(500, "text/plain", "Error");
+		return request.send(500, "text/plain", "Error");
 
 	auto& unit = t4.getUnit();
 
@@ -743,77 +589,643 @@ void web_status()
 
 	if (reply_ok)
 	{
-		String html = header("Status");
+		html.begin(200, "text/html");
+		header(html, "Status");
 
 		html += "<h1>Status</h1>\n";
 
 		html += "<table>\n";
 
-		auto status = reply.message.dmp.data[0];
-		auto flags = reply.message.dmp.data[1];
-		auto log = reply.message.dmp.data[2];
+		HtmlFieldSink sink(html);
+		decodeStatus(reply, sink);
+		html += "</table>\n";
 
-		if (status < std::size(T4AutomationStatusStrings) && T4AutomationStatusStrings[status])
-			html += "<tr><td>Automation status</td><td>" + String(T4AutomationStatusStrings[status]) + "</td></tr>";
+		html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
+		footer(html);
+	}
+	else
+	{
+		request.send(500, "text/plain", "Error");
+	}
+}
 
-		html += "<tr><td>Last manoeuvre status</td><td>";
-		if (log < std::size(T4ManoeuvreStatusStrings))
-			html += String(T4ManoeuvreStatusStrings[log]);
-		else
-			html += "UNKNOWN(" + String(log) + ")";
-		html += "</td></tr>";
-
-		html += "<tr><td>Devices search</td><td>" + String(flags & 0x01 ? "Not in progress" : "In progress") + "</td></tr>";
-		html += "<tr><td>Posititons search</td><td>" + String(flags & 0x02 ? "Not in progress" : "In progress") + "</td></tr>";
-		html += "<tr><td>First learning manoeuvers</td><td>" + String(flags & 0x04 ? "Completed" : "Not completed") + "</td></tr>";
-		html += "<tr><td>Configuration</td><td>" + String(flags & 0x08 ? "Not in progress" : "In progress") + "</td></tr>";
-		html += "<tr><td>EEPROM errors</td><td>" + String(flags & 0x10 ? "No errors found" : "Errors found") + "</td></tr>";
+String manoeuvreString(uint8_t manoeuvre)
+{
+	if (auto manoeuvre_string = getManoeuvreStatusString(manoeuvre))
+		return manoeuvre_string;
+	return "UNKNOWN(" + String(manoeuvre) + ")";
+}
+
+void web_recorder(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "recorder");
+
+	auto snapshot = std::make_unique<uint8_t[]>(T4RecorderSlotSize);
+	auto snapshot_header = (const T4SnapshotHeader*)snapshot.get();
+
+	if (request.hasArg("slot"))
+	{
+		auto slot = request.arg("slot").toInt();
+		size_t size = recorder.loadSnapshot(slot, snapshot.get());
+		if (!size)
+		{
+			request.send(404, "text/plain", "Not found");
+			return;
+		}
+
+		if (request.arg("format") == "bin")
+		{
+			// raw snapshot for offline analysis
+			request.sendHeader("Content-Disposition", "attachment; filename=\"snapshot" + String(slot) + ".bin\"");
+			request.send(200, "application/octet-stream", (const char*)snapshot.get(), size);
+			return;
+		}
+
+		html.begin(200, "text/html");
+		header(html, "Recorder");
+
+		html += "<h1>Recorder / Snapshot " + String(slot) + "</h1>\n";
+
+		html += "<table>\n";
+		html += "<tr><td>Boot</td><td>" + String(snapshot_header->boot) + "</td></tr>";
+		html += "<tr><td>Uptime</td><td>" + String(snapshot_header->time) + " ms</td></tr>";
+		if (auto status_string = getAutomationStatusString(snapshot_header->status))
+			html += "<tr><td>Automation status</td><td>" + String(status_string) + "</td></tr>";
+		html += "<tr><td>Last manoeuvre status</td><td>" + manoeuvreString(snapshot_header->manoeuvre) + "</td></tr>";
 		html += "</table>\n";
 
-		html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
-		html += footer();
+		html += "<br/><a href=\"" + basePath + "recorder?slot=" + String(slot) + "&format=bin\">Download</a><br/><br/>\n";
+
+		html += "<table>\n";
 
-		web_server.send(200, "text/html", html);
+		const uint8_t* records = snapshot.get() + sizeof(T4SnapshotHeader);
+		for (size_t offset = 0; offset + 6 <= snapshot_header->recordsSize; )
+		{
+			int32_t time;
+			memcpy(&time, &records[offset], sizeof(time));
+			uint8_t kind = records[offset + 4];
+			uint8_t record_size = records[offset + 5];
+			const uint8_t* data = &records[offset + 6];
+
+			offset += 6 + record_size;
+			if (offset > snapshot_header->recordsSize)
+				break;
+
+			html += "<tr><td>" + String(time) + " ms</td><td>";
+			if (kind == RECORD_SAMPLE && record_size >= sizeof(T4RecordSample))
+			{
+				auto sample = (const T4RecordSample*)data;
+				if (auto status_string = getAutomationStatusString(sample->status))
+					html += status_string;
+				html += ", position " + String((sample->position[0] << 8) | sample->position[1]);
+				html += ", " + manoeuvreString(sample->manoeuvre);
+			}
+			else
+			{
+				html += "<tt>";
+				for (uint8_t n = 0; n < record_size; ++n)
+				{
+					char hex[3];
+					snprintf(hex, sizeof(hex), "%02X", data[n]);
+					html += hex;
+				}
+				html += "</tt>";
+			}
+			html += "</td></tr>\n";
+		}
+
+		html += "</table>\n";
+
+		html += "<br/><a href=\"" + basePath + "recorder\">&Ll; Back</a><br/>";
 	}
 	else
 	{
-		web_server.send(500, "text/plain", "Error");
+		html.begin(200, "text/html");
+		header(html, "Recorder");
+
+		html += "<h1>Recorder</h1>\n";
+
+		html += "Current boot: " + String(recorder.getBoot()) + "<br/><br/>";
+
+		html += "<table>\n";
+
+		bool empty = true;
+		for (size_t slot = 0; slot < T4RecorderSlots; ++slot)
+		{
+			if (!recorder.loadSnapshot(slot, snapshot.get()))
+				continue;
+
+			html += "<tr><td><a href=\"" + basePath + "recorder?slot=" + String(slot) + "\">Snapshot " + String(slot) + "</a></td>";
+			html += "<td>boot " + String(snapshot_header->boot) + ", uptime " + String(snapshot_header->time / 1000) + " s</td>";
+			html += "<td>" + manoeuvreString(snapshot_header->manoeuvre) + "</td></tr>\n";
+
+			empty = false;
+		}
+
+		html += "</table>\n";
+
+		if (empty)
+			html += "No snapshots captured<br/>";
+		else
+			html += "<br/><form method=\"post\" action=\"" + basePath + "recorder\"><input type=\"submit\" value=\"Clear\"/></form>";
+
+		html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
 	}
+
+	footer(html);
 }
 
-void web_execute()
+void web_recorder_clear(HttpRequest& request)
 {
-	authenticate();
+	if (!authenticate(request))
+		return;
+
+	recorder.clearSnapshots();
+
+	request.sendHeader("Location", basePath + "recorder");
+	request.send(303, "text/plain", "Redirect");
+}
+
+void web_analyzer(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "analyzer");
+
+	auto snapshot = std::make_unique<T4AnalyzerSnapshot>();
+	analyzer.getSnapshot(*snapshot);
+
+	static const char* error_names[] = { "framing", "checksum", "timeout" };
+	static const char* gap_names[] = { "<1", "1-2", "2-4", "4-8", "8-16", "16-32", "32-64", "64-128", "128-256", "256-512", ">=512" };
+
+	// bus load of 8N1 frames at 19200 baud
+	auto load = [](const T4AnalyzerCounters& counters, size_t seconds) { return counters.bytes * 10 * 100.0f / (19200 * seconds); };
+	auto error_rate = [](const T4AnalyzerCounters& counters) { return counters.frames + counters.errors ? counters.errors * 100.0f / (counters.frames + counters.errors) : 0.0f; };
+	auto rate = [](uint32_t count) { return float(count) / T4AnalyzerRateWindow; };
+
+	if (request.arg("format") == "json")
+	{
+		html.begin(200, "application/json");
+
+		JsonWriter json(html);
+		json.beginObject();
+		json.number("uptime", snapshot->seconds);
+
+		json.beginObject("total").number("bytes", snapshot->total.bytes).number("frames", snapshot->total.frames).number("errors", snapshot->total.errors).endObject();
+
+		json.beginArray("windows");
+		for (size_t n = 0; n < std::size(T4AnalyzerWindows); ++n)
+		{
+			const auto& window = snapshot->windows[n];
+			json.beginObject().number("seconds", T4AnalyzerWindows[n]).number("bytes", window.bytes).number("frames", window.frames).number("errors", window.errors);
+			json.number("load", load(window, T4AnalyzerWindows[n])).number("errorRate", error_rate(window)).endObject();
+		}
+		json.endArray();
+
+		json.beginObject("errors");
+		for (size_t n = 0; n < std::size(error_names); ++n)
+			json.number(error_names[n], snapshot->errors[n]);
+		json.endObject();
+
+		json.beginObject("gaps").number("min", snapshot->gapMin).number("max", snapshot->gapMax).beginArray("histogram");
+		for (size_t n = 0; n < T4AnalyzerGapBuckets; ++n)
+			json.number(nullptr, snapshot->gaps[n]);
+		json.endArray().endObject();
+
+		json.beginArray("sources");
+		for (size_t n = 0; n < snapshot->sourcesCount; ++n)
+		{
+			const auto& source = snapshot->sources[n];
+			json.beginObject().number("address", source.source.address).number("endpoint", source.source.endpoint).number("frames", source.total).number("rate", rate(source.recent)).endObject();
+		}
+		json.endArray();
+
+		json.beginArray("commands");
+		for (size_t n = 0; n < snapshot->commandsCount; ++n)
+		{
+			const auto& command = snapshot->commands[n];
+			json.beginObject().number("device", command.device).number("command", command.command).number("frames", command.total).number("rate", rate(command.recent)).endObject();
+		}
+		json.endArray();
+		json.number("otherCommands", snapshot->otherCommands);
+		json.endObject();
+		return;
+	}
+
+	html.begin(200, "text/html");
+	header(html, "Analyzer");
+
+	html += "<h1>Bus analyzer</h1>\n";
+
+	html += "<table>\n";
+	html += "<tr><td>Window</td><td>Load</td><td>Frames</td><td>Errors</td><td>Error rate</td></tr>\n";
+	for (size_t n = 0; n < std::size(T4AnalyzerWindows); ++n)
+	{
+		const auto& window = snapshot->windows[n];
+		html += "<tr><td>" + String(T4AnalyzerWindows[n]) + " s</td><td>" + String(load(window, T4AnalyzerWindows[n]), 1) + " %</td><td>" + String(window.frames) + "</td><td>" + String(window.errors) + "</td><td>" + String(error_rate(window), 2) + " %</td></tr>\n";
+	}
+	html += "<tr><td>Total</td><td></td><td>" + String(snapshot->total.frames) + "</td><td>" + String(snapshot->total.errors) + "</td><td>" + String(error_rate(snapshot->total), 2) + " %</td></tr>\n";
+	html += "</table><br/>\n";
+
+	html += "<table>\n";
+	for (size_t n = 0; n < std::size(error_names); ++n)
+		html += "<tr><td>Errors " + String(error_names[n]) + "</td><td>" + String(snapshot->errors[n]) + "</td></tr>\n";
+	html += "</table><br/>\n";
+
+	html += "<table>\n";
+	html += "<tr><td>Inter-frame gap</td><td>Frames</td></tr>\n";
+	for (size_t n = 0; n < T4AnalyzerGapBuckets; ++n)
+		html += "<tr><td>" + String(gap_names[n]) + " ms</td><td>" + String(snapshot->gaps[n]) + "</td></tr>\n";
+	html += "<tr><td>Minimum</td><td>" + String(snapshot->gapMin) + " &micro;s</td></tr>\n";
+	html += "<tr><td>Maximum</td><td>" + String(snapshot->gapMax) + " &micro;s</td></tr>\n";
+	html += "</table>\n";
+	html += "Gaps are measured when the bytes are read by the UART task, up to 2 ms after they arrive, so short gaps are not accurate.<br/><br/>\n";
+
+	html += "<table>\n";
+	html += "<tr><td>Source</td><td>Frames</td><td>Frames/s</td></tr>\n";
+	for (size_t n = 0; n < snapshot->sourcesCount; ++n)
+	{
+		const auto& source = snapshot->sources[n];
+		html += "<tr><td>" + String(source.source.address) + ":" + String(source.source.endpoint) + "</td><td>" + String(source.total) + "</td><td>" + String(rate(source.recent), 1) + "</td></tr>\n";
+	}
+	html += "</table><br/>\n";
+
+	html += "<table>\n";
+	html += "<tr><td>Device:Command</td><td>Frames</td><td>Frames/s</td></tr>\n";
+	for (size_t n = 0; n < snapshot->commandsCount; ++n)
+	{
+		const auto& command = snapshot->commands[n];
+		html += "<tr><td>" + String(command.device) + ":" + String(command.command, HEX) + "</td><td>" + String(command.total) + "</td><td>" + String(rate(command.recent), 1) + "</td></tr>\n";
+	}
+	if (snapshot->otherCommands)
+		html += "<tr><td>Other</td><td>" + String(snapshot->otherCommands) + "</td><td></td></tr>\n";
+	html += "</table>\n";
+
+	html += "<br/><a href=\"" + basePath + "analyzer?format=json\">JSON</a><br/>";
+	html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
+	footer(html);
+}
+
+void web_bridge(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "bridge");
+
+	T4BridgeClientStats stats[T4BridgeClients];
+	size_t count = bridge.getStats(stats);
+
+	html.begin(200, "text/html");
+	header(html, "Bridge");
+
+	html += "<h1>TCP bridge</h1>\n";
+
+	html += "<table>\n";
+	html += "<tr><td>Client</td><td>Lag</td><td>Peak lag</td><td>Sent</td><td>Received</td><td>Dropped</td><td>Rejected</td></tr>\n";
+	for (size_t n = 0; n < count; ++n)
+	{
+		const auto& client = stats[n];
+		html += "<tr><td>" + client.address.toString() + "</td><td>" + String(client.lag) + " B</td><td>" + String(client.lagPeak) + " B</td><td>" + String(client.sent) + "</td><td>" + String(client.received) + "</td><td>" + String(client.dropped) + "</td><td>" + String(client.rejected) + "</td></tr>\n";
+	}
+	html += "</table>\n";
+
+	if (!count)
+		html += "No clients connected<br/>";
+
+	html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
+	footer(html);
+}
+
+void web_perf(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "perf");
+	html.begin(200, "text/html");
+	header(html, "Performance");
+
+	html += "<h1>Web performance</h1>\n";
+
+	html += "Free heap: " + String(ESP.getFreeHeap()) + " B<br/>";
+	html += "Minimum free heap: " + String(ESP.getMinFreeHeap()) + " B<br/>";
+	html += "Largest free block: " + String(ESP.getMaxAllocHeap()) + " B<br/>";
+	html += "Tasks and queues allocated: " + String(STATIC_ALLOCATION ? "statically" : "from heap") + "<br/><br/>";
+
+	WifiStats wifi_stats;
+	getWifiStats(wifi_stats);
+
+	html += "<table>\n";
+	for (size_t stage = 0; stage < BOOT_STAGES; ++stage)
+	{
+		auto time = getBootTime(BootStage(stage));
+		html += "<tr><td>" + String(getBootStageString(BootStage(stage))) + "</td><td>" + (time ? String(time / 1000) + " ms" : String("-")) + "</td></tr>\n";
+	}
+	html += "<tr><td>Wi-Fi connections to cached AP</td><td>" + String(wifi_stats.fastConnects) + "</td></tr>\n";
+	html += "<tr><td>Wi-Fi connections with scan</td><td>" + String(wifi_stats.scans) + "</td></tr>\n";
+	html += "</table><br/>\n";
+
+	HttpStats server_stats;
+	web_server.getStats(server_stats);
+
+	html += "<table>\n";
+	html += "<tr><td>Requests</td><td>" + String(server_stats.requests) + "</td></tr>\n";
+	html += "<tr><td>Rejected (busy)</td><td>" + String(server_stats.rejected) + "</td></tr>\n";
+	html += "<tr><td>Waiting for worker</td><td>" + String(server_stats.pending) + "</td></tr>\n";
+	html += "<tr><td>Requests/s</td><td>" + String(server_stats.rate, 1) + "</td></tr>\n";
+	html += "<tr><td>Latency p50</td><td>" + String(server_stats.latency50 / 1000) + " ms</td></tr>\n";
+	html += "<tr><td>Latency p99</td><td>" + String(server_stats.latency99 / 1000) + " ms</td></tr>\n";
+	html += "<tr><td>Latency max.</td><td>" + String(server_stats.latencyMax / 1000) + " ms</td></tr>\n";
+	html += "</table><br/>\n";
+
+	T4LatencyStats latency_stats;
+	t4.getLatencyStats(latency_stats);
+
+	html += "<table>\n";
+	html += "<tr><td>Bus frames</td><td>" + String(latency_stats.frames) + "</td></tr>\n";
+	html += "<tr><td>Frame handling p50</td><td>" + String(latency_stats.latency50) + " &micro;s</td></tr>\n";
+	html += "<tr><td>Frame handling p99</td><td>" + String(latency_stats.latency99) + " &micro;s</td></tr>\n";
+	html += "<tr><td>Frame handling max.</td><td>" + String(latency_stats.latencyMax) + " &micro;s</td></tr>\n";
+	html += "</table><br/>\n";
+
+	WatchdogStats watchdog_stats;
+	watchdog.getStats(watchdog_stats);
+
+	T4Health health;
+	t4.getHealth(health);
+
+	html += "<table>\n";
+	html += "<tr><td>Objective</td><td>Limit</td><td>Current</td><td>Breaches</td></tr>\n";
+	for (size_t slo = 0; slo < SLO_COUNT; ++slo)
+	{
+		String unit = (slo == SLO_RX_QUEUE || slo == SLO_SUBSCRIBER_QUEUE) ? " %" : " ms";
+		html += "<tr><td>" + String(T4Watchdog::getSloString(WatchdogSlo(slo))) + "</td><td>" + String(T4Watchdog::getSloLimit(WatchdogSlo(slo))) + unit + "</td>";
+		html += "<td>" + String(watchdog_stats.value[slo]) + unit + (watchdog_stats.breached[slo] ? " (breached)" : "") + "</td><td>" + String(watchdog_stats.breaches[slo]) + "</td></tr>\n";
+	}
+	html += "<tr><td>Receive queue drops</td><td></td><td>" + String(health.rxDropped) + "</td><td></td></tr>\n";
+	html += "</table><br/>\n";
+
+	WatchdogBreach breaches[WatchdogBreaches];
+	size_t breaches_count = watchdog.getBreaches(breaches, WatchdogBreaches);
+	if (watchdog_stats.restarted)
+		html += "Last restart forced by the watchdog: " + String(T4Watchdog::getSloString(watchdog_stats.lastRestart.slo)) + " " + String(watchdog_stats.lastRestart.value) + " (" + watchdog_stats.lastRestart.task + ")<br/><br/>\n";
+	if (breaches_count)
+	{
+		html += "<table>\n";
+		html += "<tr><td>Time</td><td>Objective</td><td>Value</td><td>Task</td><td>Rx queue</td><td>Tx queue</td><td>Rx drops</td></tr>\n";
+		for (auto breach = breaches; breach < breaches + breaches_count; ++breach)
+		{
+			html += "<tr><td>" + String(breach->time / 1000) + " s</td><td>" + T4Watchdog::getSloString(breach->slo) + "</td><td>" + String(breach->value) + "</td><td>" + breach->task + "</td>";
+			html += "<td>" + String(breach->rxQueueUsed) + "</td><td>" + String(breach->txQueueUsed) + "</td><td>" + String(breach->rxDropped) + "</td></tr>\n";
+		}
+		html += "</table><br/>\n";
+	}
+
+	T4SubscriberStats subscriber_stats[T4MaxSubscribers];
+	size_t subscriber_count = t4.getSubscriberStats(subscriber_stats, T4MaxSubscribers);
+
+	html += "<table>\n";
+	html += "<tr><td>Subscriber</td><td>Delivery</td><td>Frames</td><td>Dropped</td></tr>\n";
+	for (auto stats = subscriber_stats; stats < subscriber_stats + subscriber_count; ++stats)
+	{
+		html += "<tr><td>" + String(stats->name) + "</td><td>" + (stats->queued ? "queue " + String(stats->queueUsed) + "/" + String(stats->queueSize) : String("call")) + "</td>";
+		html += "<td>" + String(stats->delivered) + "</td><td>" + String(stats->dropped) + "</td></tr>\n";
+	}
+	html += "</table><br/>\n";
+
+	html += "<table>\n";
+	html += "<tr><td>Task</td><td>Core</td><td>Priority</td><td>Stack</td><td>Min. free stack</td></tr>\n";
+	TaskStats task_stats[MaxTasks];
+	size_t task_count = getTaskStats(task_stats, MaxTasks);
+	for (auto stats = task_stats; stats < task_stats + task_count; ++stats)
+	{
+		html += "<tr><td>" + String(stats->name) + "</td><td>" + (stats->core == tskNO_AFFINITY ? String("any") : String(stats->core)) + "</td><td>" + String(stats->priority) + "</td>";
+		html += "<td>" + String(stats->stackSize) + " B</td><td>" + String(stats->stackFree) + " B</td></tr>\n";
+	}
+	html += "</table><br/>\n";
+
+	auto page_stats = std::make_unique<WebPageStats[]>(WebPages);
+	size_t page_count = WebStream::getStats(page_stats.get());
+
+	html += "<table>\n";
+	html += "<tr><td>Page</td><td>Requests</td><td>TTFB</td><td>Max. TTFB</td><td>Time</td><td>Max. time</td><td>Heap</td><td>Max. heap</td><td>Size</td></tr>\n";
+	for (auto stats = page_stats.get(); stats < page_stats.get() + page_count; ++stats)
+	{
+		html += "<tr><td>" + String(stats->page) + "</td><td>" + String(stats->requests) + "</td>";
+		html += "<td>" + String(stats->ttfb / 1000) + " ms</td><td>" + String(stats->ttfbMax / 1000) + " ms</td>";
+		html += "<td>" + String(stats->time / 1000) + " ms</td><td>" + String(stats->timeMax / 1000) + " ms</td>";
+		html += "<td>" + String(stats->heapPeak) + " B</td><td>" + String(stats->heapPeakMax) + " B</td>";
+		html += "<td>" + String(stats->size) + " B</td></tr>\n";
+	}
+	html += "</table>\n";
+
+	html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
+	footer(html);
+}
+
+void web_execute(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
 
 	if (!t4.lockUnit())
-		return web_server.send(500, "text/plain", "Error");
+		return request.send(500, "text/plain", "Error");
 
 	auto& unit = t4.getUnit();
 
 	// send DEP packet to execute the command
-	uint8_t message[4] = { OVIEW, 0x82, uint8_t(web_server.arg("command").toInt()), 100 };
+	uint8_t message[4] = { OVIEW, 0x82, uint8_t(request.arg("command").toInt()), 100 };
 	T4Packet packet(0x55, unit.source, T4ThisAddress, 1, message, sizeof(message));
 	t4.send(packet);
 
 	t4.unlockUnit();
 
-	web_server.sendHeader("Location", basePath);
-	web_server.send(303, "text/plain", "Redirect");
+	request.sendHeader("Location", basePath);
+	request.send(303, "text/plain", "Redirect");
 }
 
-void webServerInit()
+void web_asset(HttpRequest& request, const WebAsset& asset)
 {
-	web_server.on(basePath, web_root);
-	web_server.on(basePath + "configure", HTTP_GET, web_configure_get);
-	web_server.on(basePath + "configure", HTTP_POST, web_configure_post);
-	web_server.on(basePath + "diagnostics", web_diagnostics);
-	web_server.on(basePath + "log", web_log);
-	web_server.on(basePath + "status", web_status);
-	web_server.on(basePath + "execute", web_execute);
-	web_server.begin();
+	String etag = String("\"") + asset.etag + "\"";
+
+	request.sendHeader("ETag", etag);
+	request.sendHeader("Cache-Control", "public, max-age=31536000, immutable");
+
+	if (request.header("If-None-Match") == etag)
+		return request.send(304, asset.contentType, "");
+
+	request.sendHeader("Content-Encoding", "gzip");
+	request.send(200, asset.contentType, (const char*)asset.data, asset.size);
+}
+
+void web_login_get(HttpRequest& request)
+{
+	WebStream html(request, "login");
+	html.begin(200, "text/html");
+	header(html, "Login");
+
+	html += "<h1>Login</h1>\n";
+	if (auto lockout = web_auth.getLockout())
+		html += "Too many failed attempts, try again in " + String((lockout + 999) / 1000) + " s.<br/><br/>\n";
+	else if (request.hasArg("failed"))
+		html += "Invalid login or password.<br/><br/>\n";
+	html += "<form method=\"post\"><table>\n";
+	html += "<tr><td>Login</td><td><input name=\"login\" autocomplete=\"username\"/></td></tr>\n";
+	html += "<tr><td>Password</td><td><input name=\"password\" type=\"password\" autocomplete=\"current-password\"/></td></tr>\n";
+	html += "</table><input type=\"submit\" value=\"Login\"/></form>\n";
+
+	footer(html);
 }
 
-void webServerHandle()
+void web_login_post(HttpRequest& request)
 {
-	web_server.handleClient();
+	// repeated failures are locked out by web_auth, the worker isn't held by any delay
+	if (!web_auth.checkCredentials(request.arg("login"), request.arg("password")))
+	{
+		request.sendHeader("Location", basePath + "login?failed=1");
+		return request.send(303, "text/plain", "Redirect");
+	}
+
+	startSession(request);
+	request.sendHeader("Location", basePath);
+	request.send(303, "text/plain", "Redirect");
+}
+
+void web_logout(HttpRequest& request)
+{
+	web_auth.removeSession(request.cookie(SESSION_COOKIE));
+
+	request.sendHeader("Set-Cookie", String(SESSION_COOKIE) + "=; Path=" + basePath + "; Max-Age=0");
+	request.sendHeader("Location", basePath + "login");
+	request.send(303, "text/plain", "Redirect");
+}
+
+void web_account_get(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "account");
+	html.begin(200, "text/html");
+	header(html, "Account");
+
+	html += "<h1>Account</h1>\n";
+	if (request.hasArg("result"))
+		html += (request.arg("result") == "ok") ? "Credentials changed.<br/><br/>\n" : "Credentials not changed, check the current password.<br/><br/>\n";
+	html += "<form method=\"post\"><table>\n";
+	html += "<tr><td>Current password</td><td><input name=\"current\" type=\"password\" autocomplete=\"current-password\"/></td></tr>\n";
+	html += "<tr><td>New login</td><td><input name=\"login\" autocomplete=\"username\" value=\"" + web_auth.getLogin() + "\"/></td></tr>\n";
+	html += "<tr><td>New password</td><td><input name=\"password\" type=\"password\" autocomplete=\"new-password\"/></td></tr>\n";
+	html += "</table><input type=\"submit\" value=\"Save\"/></form>\n";
+	html += "<br/><a href=\"" + basePath + "logout\">Logout</a><br/>";
+	html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
+
+	footer(html);
+}
+
+void web_account_post(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	bool changed = web_auth.checkCredentials(web_auth.getLogin(), request.arg("current")) && web_auth.setCredentials(request.arg("login"), request.arg("password"));
+	if (changed)
+		startSession(request);
+
+	request.sendHeader("Location", basePath + "account?result=" + (changed ? "ok" : "failed"));
+	request.send(303, "text/plain", "Redirect");
+}
+
+void web_wifi_get(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WebStream html(request, "wifi");
+	html.begin(200, "text/html");
+	header(html, "Wi-Fi");
+
+	auto profile = getWifiPowerProfile();
+
+	html += "<h1>Wi-Fi power save</h1>\n";
+	if (request.hasArg("result"))
+		html += (request.arg("result") == "ok") ? "Profile changed.<br/><br/>\n" : "Invalid profile.<br/><br/>\n";
+	html += "<form method=\"post\"><table>\n";
+	html += "<tr><td>Mode</td><td><select name=\"mode\">";
+	for (size_t mode = 0; mode < POWER_SAVE_MODES; ++mode)
+	{
+		html += "<option value=\"" + String(getWifiPowerSaveString(WifiPowerSave(mode))) + "\"";
+		if (mode == profile.mode)
+			html += " selected";
+		html += ">" + String(getWifiPowerSaveString(WifiPowerSave(mode))) + "</option>";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Listen interval (max-modem)</td><td><input name=\"interval\" type=\"number\" min=\"1\" max=\"10\" value=\"" + String(profile.listenInterval) + "\"/></td></tr>\n";
+	html += "</table><input type=\"submit\" value=\"Save\"/></form><br/>\n";
+
+	html += "<table>\n";
+	html += "<tr><td>Profile</td><td>Estimated current</td></tr>\n";
+	for (size_t mode = 0; mode < POWER_SAVE_MODES; ++mode)
+	{
+		WifiPowerProfile estimate = { WifiPowerSave(mode), profile.listenInterval };
+		html += "<tr><td>" + String(getWifiPowerSaveString(estimate.mode)) + "</td><td>" + String(estimateWifiCurrent(estimate), 0) + " mA</td></tr>\n";
+	}
+	html += "</table>\n";
+
+	html += "<br/><a href=\"" + basePath + "\">&Ll; Back</a><br/>";
+	footer(html);
+}
+
+void web_wifi_post(HttpRequest& request)
+{
+	if (!authenticate(request))
+		return;
+
+	WifiPowerProfile profile = getWifiPowerProfile();
+	bool changed = parseWifiPowerSave(request.arg("mode"), profile.mode);
+	if (request.hasArg("interval"))
+		profile.listenInterval = std::clamp<long>(request.arg("interval").toInt(), 0, 0xFF);
+	changed = changed && setWifiPowerProfile(profile);
+
+	request.sendHeader("Location", basePath + "wifi?result=" + (changed ? "ok" : "failed"));
+	request.send(303, "text/plain", "Redirect");
+}
+
+void webServerInit(uint16_t port)
+{
+	static const char* headers[] = { "If-None-Match" };
+	web_server.collectHeaders(headers, std::size(headers));
+
+	for (const auto& asset : WebAssets)
+		web_server.on(basePath + asset.path, HTTP_GET, [&asset](HttpRequest& request) { web_asset(request, asset); }, false);
+
+	web_server.on(basePath, HTTP_GET, web_root);
+	web_server.on(basePath + "configure", HTTP_GET, web_configure_get);
+	web_server.on(basePath + "configure", HTTP_POST, web_configure_post);
+	web_server.on(basePath + "diagnostics", HTTP_GET, web_diagnostics);
+	web_server.on(basePath + "log", HTTP_GET, web_log);
+	web_server.on(basePath + "status", HTTP_GET, web_status);
+	web_server.on(basePath + "execute", HTTP_GET, web_execute);
+	web_server.on(basePath + "recorder", HTTP_GET, web_recorder);
+	web_server.on(basePath + "recorder", HTTP_POST, web_recorder_clear);
+	web_server.on(basePath + "analyzer", HTTP_GET, web_analyzer);
+	web_server.on(basePath + "bridge", HTTP_GET, web_bridge);
+	web_server.on(basePath + "login", HTTP_GET, web_login_get, false);
+	web_server.on(basePath + "login", HTTP_POST, web_login_post);
+	web_server.on(basePath + "logout", HTTP_GET, web_logout, false);
+	web_server.on(basePath + "account", HTTP_GET, web_account_get);
+	web_server.on(basePath + "account", HTTP_POST, web_account_post);
+	web_server.on(basePath + "wifi", HTTP_GET, web_wifi_get, false);
+	web_server.on(basePath + "wifi", HTTP_POST, web_wifi_post, false);
+	// pages which don't touch the bus are served directly by the server task
+	web_server.on(basePath + "perf", HTTP_GET, web_perf, false);
+	apiInit();
+	web_auth.init();
+	WebStream::init();
+	web_server.begin(port);
 }
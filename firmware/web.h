@@ -18,9 +18,14 @@
 #define WEB_H
 
 #include <Arduino.h>
-#include <WebServer.h>
 
-void webServerInit();
-void webServerHandle();
+#include "httpserver.h"
+
+extern HttpServer web_server;
+extern String basePath;
+
+bool authenticate(HttpRequest& request);
+
+void webServerInit(uint16_t port = 80);
 
 #endif
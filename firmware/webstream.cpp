@@ -0,0 +1,468 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "webstream.h"
+
+WebPageStats WebStream::s_stats[WebPages];
+SemaphoreHandle_t WebStream::s_mutex = nullptr;
+MutexBuffer WebStream::s_mutexBuffer;
+
+void WebStream::init()
+{
+	s_mutex = createMutex(s_mutexBuffer);
+}
+
+size_t WebStream::getStats(WebPageStats* stats)
+{
+	size_t count = 0;
+
+	if (xSemaphoreTake(s_mutex, portMAX_DELAY))
+	{
+		while (count < WebPages && s_stats[count].page)
+		{
+			stats[count] = s_stats[count];
+			count++;
+		}
+
+		xSemaphoreGive(s_mutex);
+	}
+
+	return count;
+}
+
+WebStream::WebStream(HttpRequest& request, const char* page) : m_request(request), m_page(page)
+{
+	m_start = micros();
+	m_heapStart = ESP.getFreeHeap();
+	m_heapMin = m_heapStart;
+}
+
+WebStream::~WebStream()
+{
+	end();
+}
+
+void WebStream::begin(int code, const char* contentType)
+{
+	// status and headers are sent with the first chunk
+	m_code = code;
+	m_contentType = contentType;
+	m_started = true;
+}
+
+void WebStream::write(const char* data, size_t size)
+{
+	while (size)
+	{
+		size_t chunk = std::min(size, sizeof(m_buffer) - m_size);
+		memcpy(&m_buffer[m_size], data, chunk);
+		m_size += chunk;
+		data += chunk;
+		size -= chunk;
+
+		if (m_size == sizeof(m_buffer))
+			flush();
+	}
+}
+
+void WebStream::flush()
+{
+	sample();
+
+	if (!m_started || !m_size)
+		return;
+
+	if (!m_sent)
+		m_ttfb = micros() - m_start;
+
+	m_request.sendChunk(m_code, m_contentType, m_buffer, m_size);
+	m_sent += m_size;
+	m_size = 0;
+}
+
+void WebStream::end()
+{
+	if (!m_started)
+		return;
+
+	flush();
+
+	m_request.endChunks(m_code, m_contentType);
+	m_started = false;
+
+	if (!m_sent)
+		m_ttfb = micros() - m_start;
+
+	if (!xSemaphoreTake(s_mutex, portMAX_DELAY))
+		return;
+
+	uint32_t time = micros() - m_start;
+	uint32_t heap_peak = m_heapStart - m_heapMin;
+
+	auto stats = std::find_if(std::begin(s_stats), std::end(s_stats), [this](const auto& s) { return !s.page || !strcmp(s.page, m_page); });
+	if (stats != std::end(s_stats))
+	{
+		stats->page = m_page;
+		stats->requests++;
+		stats->ttfb = m_ttfb;
+		stats->ttfbMax = std::max(stats->ttfbMax, m_ttfb);
+		stats->time = time;
+		stats->timeMax = std::max(stats->timeMax, time);
+		stats->heapPeak = heap_peak;
+		stats->heapPeakMax = std::max(stats->heapPeakMax, heap_peak);
+		stats->size = m_sent;
+	}
+
+	xSemaphoreGive(s_mutex);
+}
+
+void WebStream::sample()
+{
+	m_heapMin = std::min(m_heapMin, ESP.getFreeHeap());
+}
+
+JsonWriter& JsonWriter::beginObject(const char* key)
+{
+	prefix(key);
+	m_stream += '{';
+	m_filled &= ~(1 << ++m_depth);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+	m_depth--;
+	m_stream += '}';
+	return *this;
+}
+
+JsonWriter& JsonWriter::beginArray(const char* key)
+{
+	prefix(key);
+	m_stream += '[';
+	m_filled &= ~(1 << ++m_depth);
+	return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+	m_depth--;
+	m_stream += ']';
+	return *this;
+}
+
+JsonWriter& JsonWriter::string(const char* key, const char* value)
+{
+	if (!value)
+		return null(key);
+
+	prefix(key);
+	escape(value);
+	return *this;
+}
+
+JsonWriter& JsonWriter::boolean(const char* key, bool value)
+{
+	return raw(key, value ? "true" : "false");
+}
+
+JsonWriter& JsonWriter::null(const char* key)
+{
+	return raw(key, "null");
+}
+
+JsonWriter& JsonWriter::raw(const char* key, const char* text)
+{
+	prefix(key);
+	m_stream += text;
+	return *this;
+}
+
+void JsonWriter::prefix(const char* key)
+{
+	if (m_filled & (1 << m_depth))
+		m_stream += ',';
+	m_filled |= (1 << m_depth);
+
+	if (key)
+	{
+		escape(key);
+		m_stream += ':';
+	}
+}
+
+void JsonWriter::escape(const char* text)
+{
+	m_stream += '"';
+
+	for (; *text; ++text)
+	{
+		char c = *text;
+		if (c == '"' || c == '\\')
+		{
+			m_stream += '\\';
+			m_stream += c;
+		}
+		else if (uint8_t(c) < 0x20)
+		{
+			char code[7];
+			snprintf(code, sizeof(code), "\\u%04X", c);
+			m_stream += code;
+		}
+		else
+		{
+			m_stream += c;
+		}
+	}
+
+	m_stream += '"';
+}
+
+bool JsonReader::nextKey(char* key, size_t size)
+{
+	if (m_failed || m_finished)
+		return false;
+
+	if (!m_started)
+	{
+		m_started = true;
+		if (!expect('{'))
+			return fail();
+		whitespace();
+		if (*m_text == '}')
+		{
+			m_text++;
+			m_finished = true;
+			return false;
+		}
+	}
+	else
+	{
+		whitespace();
+		if (*m_text == '}')
+		{
+			m_text++;
+			m_finished = true;
+			return false;
+		}
+		if (!expect(','))
+			return fail();
+	}
+
+	whitespace();
+	if (!string(key, size) || !expect(':'))
+		return fail();
+
+	return true;
+}
+
+bool JsonReader::integer(long long& value)
+{
+	if (m_failed)
+		return false;
+
+	whitespace();
+
+	bool negative = (*m_text == '-');
+	if (negative)
+		m_text++;
+
+	if (!isdigit(*m_text))
+		return fail();
+
+	// 18 digits never overflow
+	value = 0;
+	for (size_t digits = 0; isdigit(*m_text); ++digits, ++m_text)
+	{
+		if (digits == 18)
+			return fail();
+		value = value * 10 + (*m_text - '0');
+	}
+
+	// fractions and exponents aren't integers
+	if (*m_text == '.' || *m_text == 'e' || *m_text == 'E')
+		return fail();
+
+	if (negative)
+		value = -value;
+	return true;
+}
+
+bool JsonReader::skip()
+{
+	return !m_failed && (skipValue(0) || fail());
+}
+
+bool JsonReader::valid()
+{
+	if (m_failed)
+		return false;
+
+	// read the rest of the members
+	char key[2];
+	while (nextKey(key, 0) && skip())
+		;
+
+	whitespace();
+	return !m_failed && m_finished && !*m_text;
+}
+
+void JsonReader::whitespace()
+{
+	while (*m_text == ' ' || *m_text == '\t' || *m_text == '\r' || *m_text == '\n')
+		m_text++;
+}
+
+bool JsonReader::expect(char c)
+{
+	whitespace();
+	if (*m_text != c)
+		return false;
+	m_text++;
+	return true;
+}
+
+bool JsonReader::string(char* text, size_t size)
+{
+	// text is nullptr or size is 0 when the string is skipped, longer strings are truncated
+	size_t length = 0;
+
+	if (*m_text != '"')
+		return false;
+	m_text++;
+
+	for (;;)
+	{
+		// the terminator is never consumed, so nothing reads past it
+		char c = *m_text;
+		if (!c || uint8_t(c) < 0x20)
+			return false;
+		m_text++;
+		if (c == '"')
+			break;
+
+		if (c == '\\')
+		{
+			c = *m_text;
+			if (!c)
+				return false;
+			m_text++;
+			switch (c)
+			{
+				case '"': case '\\': case '/': break;
+				case 'b': c = '\b'; break;
+				case 'f': c = '\f'; break;
+				case 'n': c = '\n'; break;
+				case 'r': c = '\r'; break;
+				case 't': c = '\t'; break;
+				case 'u':
+					{
+						unsigned code = 0;
+						for (size_t n = 0; n < 4; ++n, ++m_text)
+						{
+							if (!isxdigit(*m_text))
+								return false;
+							code = code * 16 + (isdigit(*m_text) ? *m_text - '0' : (tolower(*m_text) - 'a' + 10));
+						}
+						// keys of the API are ASCII only
+						c = (code < 0x80) ? char(code) : '?';
+					}
+					break;
+				default:
+					return false;
+			}
+		}
+
+		if (length + 1 < size)
+			text[length++] = c;
+	}
+
+	if (size)
+		text[length] = 0;
+	return true;
+}
+
+bool JsonReader::literal(const char* text)
+{
+	size_t length = strlen(text);
+	if (strncmp(m_text, text, length))
+		return false;
+	m_text += length;
+	return true;
+}
+
+bool JsonReader::skipValue(uint8_t depth)
+{
+	// nesting is limited, the stack of the worker is small
+	if (depth > 8)
+		return false;
+
+	whitespace();
+	switch (*m_text)
+	{
+		case '"':
+			return string(nullptr, 0);
+
+		case '{':
+		case '[':
+			{
+				char close = (*m_text++ == '{') ? '}' : ']';
+				whitespace();
+				if (*m_text == close)
+				{
+					m_text++;
+					return true;
+				}
+				for (;;)
+				{
+					if (close == '}')
+					{
+						whitespace();
+						if (!string(nullptr, 0) || !expect(':'))
+							return false;
+					}
+					if (!skipValue(depth + 1))
+						return false;
+					whitespace();
+					if (*m_text == close)
+					{
+						m_text++;
+						return true;
+					}
+					if (!expect(','))
+						return false;
+				}
+			}
+
+		case 't':
+			return literal("true");
+		case 'f':
+			return literal("false");
+		case 'n':
+			return literal("null");
+
+		default:
+			{
+				if (*m_text == '-')
+					m_text++;
+				if (!isdigit(*m_text))
+					return false;
+				while (isdigit(*m_text) || *m_text == '.' || *m_text == 'e' || *m_text == 'E' || *m_text == '+' || *m_text == '-')
+					m_text++;
+				return true;
+			}
+	}
+}
@@ -0,0 +1,162 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WEBSTREAM_H
+#define WEBSTREAM_H
+
+#include <Arduino.h>
+
+#include "httpserver.h"
+
+struct WebPageStats
+{
+	const char* page = nullptr;
+	uint32_t requests = 0;
+
+	// time to first byte and total time of the last request (in microseconds)
+	uint32_t ttfb = 0;
+	uint32_t ttfbMax = 0;
+	uint32_t time = 0;
+	uint32_t timeMax = 0;
+
+	// heap taken while the page was rendered, sampled at every chunk
+	uint32_t heapPeak = 0;
+	uint32_t heapPeakMax = 0;
+
+	size_t size = 0;
+};
+
+constexpr size_t WebPages = 16;
+
+// response sent by chunked transfer-encoding, the page is never held in memory as a whole
+class WebStream
+{
+public:
+	WebStream(HttpRequest& request, const char* page);
+	~WebStream();
+
+	void begin(int code, const char* contentType);
+	void flush();
+	void end();
+
+	void write(const char* data, size_t size);
+
+	WebStream& operator+=(const char* text) { write(text, strlen(text)); return *this; }
+	WebStream& operator+=(const String& text) { write(text.c_str(), text.length()); return *this; }
+	WebStream& operator+=(char c) { write(&c, 1); return *this; }
+
+	static void init();
+	static size_t getStats(WebPageStats* stats);
+
+private:
+	void sample();
+
+	HttpRequest& m_request;
+	const char* m_page;
+
+	bool m_started = false;
+	int m_code = 200;
+	const char* m_contentType = nullptr;
+	uint32_t m_start = 0;
+	uint32_t m_ttfb = 0;
+	uint32_t m_heapStart = 0;
+	uint32_t m_heapMin = 0;
+	size_t m_sent = 0;
+
+	char m_buffer[512];
+	size_t m_size = 0;
+
+	static WebPageStats s_stats[WebPages];
+	static SemaphoreHandle_t s_mutex;
+	static MutexBuffer s_mutexBuffer;
+};
+
+// JSON serializer writing directly to the stream, nothing is allocated on the heap
+class JsonWriter
+{
+public:
+	JsonWriter(WebStream& stream) : m_stream(stream) {}
+
+	// key is nullptr for elements of arrays
+	JsonWriter& beginObject(const char* key = nullptr);
+	JsonWriter& endObject();
+	JsonWriter& beginArray(const char* key = nullptr);
+	JsonWriter& endArray();
+
+	JsonWriter& string(const char* key, const char* value);
+	JsonWriter& boolean(const char* key, bool value);
+	JsonWriter& null(const char* key);
+
+	template <typename T>
+	JsonWriter& number(const char* key, T value)
+	{
+		char text[24];
+		if constexpr (std::is_floating_point_v<T>)
+			snprintf(text, sizeof(text), "%.2f", double(value));
+		else if constexpr (std::is_signed_v<T>)
+			snprintf(text, sizeof(text), "%lld", (long long)value);
+		else
+			snprintf(text, sizeof(text), "%llu", (unsigned long long)value);
+		return raw(key, text);
+	}
+
+private:
+	JsonWriter& raw(const char* key, const char* text);
+	void prefix(const char* key);
+	void escape(const char* text);
+
+	WebStream& m_stream;
+
+	// bit per nesting level, set when the level already has an element and the next one needs a comma
+	uint32_t m_filled = 0;
+	uint8_t m_depth = 0;
+};
+
+// reader of the members of a flat JSON object, values other than integers can only be skipped
+//
+//	JsonReader json(body);
+//	while (json.nextKey(key, sizeof(key)))
+//		strcmp(key, "value") ? json.skip() : json.integer(value);
+//	if (!json.valid()) ...
+class JsonReader
+{
+public:
+	JsonReader(const char* text) : m_text(text) {}
+
+	// reads key of the next member (and the opening brace before the first one), false at the end of the object or on error
+	bool nextKey(char* key, size_t size);
+
+	bool integer(long long& value);
+	bool skip();
+
+	// the whole text was read and it's a well-formed object
+	bool valid();
+
+private:
+	void whitespace();
+	bool expect(char c);
+	bool string(char* text, size_t size);
+	bool literal(const char* text);
+	bool skipValue(uint8_t depth);
+	bool fail() { m_failed = true; return false; }
+
+	const char* m_text;
+	bool m_started = false;
+	bool m_finished = false;
+	bool m_failed = false;
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "wireless.h"
+
+// power save profiles, shared by the firmware and the host build
+
+const char* WifiPowerSaveStrings[POWER_SAVE_MODES] = { "none", "min-modem", "max-modem" };
+
+const uint8_t LISTEN_INTERVAL_MAX = 10;
+
+// model of the current: CPU in modem sleep plus receiver duty cycle, the station is assumed to stay awake few ms after each beacon
+const float CURRENT_CPU = 30.0f;
+const float CURRENT_RX = 100.0f;
+const float BEACON_INTERVAL = 102.4f;
+const float BEACON_AWAKE_TIME = 4.0f;
+
+bool isValidWifiPowerProfile(const WifiPowerProfile& profile)
+{
+	return profile.mode < POWER_SAVE_MODES && profile.listenInterval >= 1 && profile.listenInterval <= LISTEN_INTERVAL_MAX;
+}
+
+const char* getWifiPowerSaveString(WifiPowerSave mode)
+{
+	return (mode < POWER_SAVE_MODES) ? WifiPowerSaveStrings[mode] : "";
+}
+
+bool parseWifiPowerSave(const String& string, WifiPowerSave& mode)
+{
+	for (size_t n = 0; n < POWER_SAVE_MODES; ++n)
+	{
+		if (string == WifiPowerSaveStrings[n])
+		{
+			mode = WifiPowerSave(n);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+float estimateWifiCurrent(const WifiPowerProfile& profile)
+{
+	// DTIM period 1 is assumed for min-modem
+	float duty = 1.0f;
+	if (profile.mode == POWER_SAVE_MIN_MODEM)
+		duty = BEACON_AWAKE_TIME / BEACON_INTERVAL;
+	else if (profile.mode == POWER_SAVE_MAX_MODEM)
+		duty = BEACON_AWAKE_TIME / (BEACON_INTERVAL * profile.listenInterval);
+
+	return CURRENT_CPU + CURRENT_RX * duty;
+}
@@ -22,8 +22,12 @@
 #include <lwip/inet_chksum.h>
 #include <lwip/sockets.h>
 #include <lwip/err.h>
+#include <Preferences.h>
+#include <esp_wifi.h>
 
 #include "wireless.h"
+#include "boot.h"
+#include "tasks.h"
 
 IPAddress ip(192, 168, 1, 20);
 IPAddress gateway(192, 168, 1, 1);
@@ -34,19 +38,220 @@ const char* wifiSSID = "your_ssid";
 const char* wifiPassword = "your_password";
 
 TaskHandle_t checkTaskHandle = nullptr;
+TaskBuffer<TASK_WIFI_CHECK> checkTaskBuffer;
+QueueHandle_t eventQueue = nullptr;
+
+std::vector<WifiCallback> connectedCallbacks;
+
+SemaphoreHandle_t statsMutex = nullptr;
+MutexBuffer statsMutexBuffer;
+WifiStats stats = {};
 
 const int signalLED = 25;
 TaskHandle_t signalTaskHandle = nullptr;
+TaskBuffer<TASK_WIFI_SIGNAL> signalTaskBuffer;
+
+// gateway is probed every 10s, or every 1s after a miss, 3 misses in a row mean the link is lost
+const uint32_t PROBE_INTERVAL = 10000;
+const uint32_t PROBE_RETRY_INTERVAL = 1000;
+const uint32_t PROBE_TIMEOUT = 500;
+const size_t PROBE_MISSES = 3;
+
+// escalation when the connection isn't restored by automatic reconnects
+const uint32_t ESCALATION_RESTART_WIFI = 30000;
+const uint32_t ESCALATION_RESTART_ESP = 300000;
+
+void updateStats(const std::function<void(WifiStats&)>& update)
+{
+	if (xSemaphoreTake(statsMutex, portMAX_DELAY))
+	{
+		update(stats);
+		xSemaphoreGive(statsMutex);
+	}
+}
+
+// connection to the cached access point falls back to full scan after this time
+const uint32_t FAST_CONNECT_TIMEOUT = 3000;
+
+// wifi_err_reason_t
+const uint8_t REASON_BEACON_TIMEOUT = 200;
+
+// access point of the last successful connection, RTC memory survives software restarts, NVS power cycles
+struct WifiCache
+{
+	uint32_t magic;
+	uint8_t bssid[6];
+	uint8_t channel;
+};
+
+const uint32_t CACHE_MAGIC = 0x57494649;
 
-bool ping()
+RTC_NOINIT_ATTR WifiCache rtcCache;
+bool fastConnecting = false;
+
+bool loadCache(WifiCache& cache)
 {
-	if (WiFi.status() != WL_CONNECTED)
+	if (rtcCache.magic == CACHE_MAGIC)
+	{
+		cache = rtcCache;
+		return true;
+	}
+
+	Preferences prefs;
+	if (!prefs.begin("wifi", true))
 		return false;
 
+	bool ok = prefs.getBytes("cache", &cache, sizeof(cache)) == sizeof(cache) && cache.magic == CACHE_MAGIC;
+	prefs.end();
+
+	if (ok)
+		rtcCache = cache;
+	return ok;
+}
+
+void storeCache()
+{
+	WifiCache cache = {};
+	cache.magic = CACHE_MAGIC;
+	memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+	cache.channel = WiFi.channel();
+
+	// flash is written only when the access point changes
+	if (!memcmp(&cache, &rtcCache, sizeof(cache)))
+		return;
+	rtcCache = cache;
+
+	Preferences prefs;
+	if (prefs.begin("wifi"))
+	{
+		prefs.putBytes("cache", &cache, sizeof(cache));
+		prefs.end();
+	}
+}
+
+void invalidateCache()
+{
+	rtcCache.magic = 0;
+
+	Preferences prefs;
+	if (prefs.begin("wifi"))
+	{
+		prefs.remove("cache");
+		prefs.end();
+	}
+}
+
+const uint8_t LISTEN_INTERVAL_DEFAULT = 3;
+
+WifiPowerProfile powerProfile = { POWER_SAVE_MIN_MODEM, LISTEN_INTERVAL_DEFAULT };
+
+void loadPowerProfile()
+{
+	Preferences prefs;
+	if (!prefs.begin("wifi", true))
+		return;
+
+	WifiPowerProfile profile;
+	if (prefs.getBytes("power", &profile, sizeof(profile)) == sizeof(profile) && isValidWifiPowerProfile(profile))
+		powerProfile = profile;
+	prefs.end();
+}
+
+// listen interval is a parameter of the association, it takes effect with the next connection
+bool applyListenInterval()
+{
+	wifi_config_t config;
+	if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK || config.sta.listen_interval == powerProfile.listenInterval)
+		return false;
+
+	config.sta.listen_interval = powerProfile.listenInterval;
+	return esp_wifi_set_config(WIFI_IF_STA, &config) == ESP_OK;
+}
+
+void applyPowerProfile()
+{
+	static const wifi_ps_type_t modes[POWER_SAVE_MODES] = { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM };
+	WiFi.setSleep(modes[powerProfile.mode]);
+}
+
+bool setWifiPowerProfile(const WifiPowerProfile& profile)
+{
+	if (!isValidWifiPowerProfile(profile))
+		return false;
+
+	powerProfile = profile;
+	applyPowerProfile();
+	if (applyListenInterval())
+		WiFi.reconnect();
+
+	Preferences prefs;
+	if (prefs.begin("wifi"))
+	{
+		prefs.putBytes("power", &powerProfile, sizeof(powerProfile));
+		prefs.end();
+	}
+
+	return true;
+}
+
+WifiPowerProfile getWifiPowerProfile()
+{
+	return powerProfile;
+}
+
+// connects directly to the cached access point if there's any, otherwise scans all channels
+void connect()
+{
+	WifiCache cache;
+	fastConnecting = loadCache(cache);
+	if (fastConnecting)
+		WiFi.begin(wifiSSID, wifiPassword, cache.channel, cache.bssid);
+	else
+		WiFi.begin(wifiSSID, wifiPassword);
+
+	applyPowerProfile();
+	if (applyListenInterval())
+		WiFi.reconnect();
+
+	updateStats([](WifiStats& s) { s.fastConnects += fastConnecting; s.scans += !fastConnecting; });
+}
+
+struct WifiEvent
+{
+	arduino_event_id_t id;
+	uint8_t reason;
+};
+
+QueueBuffer<WifiEvent, QUEUE_WIFI_EVENTS> eventQueueBuffer;
+
+// raw socket is kept open while the station has IP address
+int probeSocket = -1;
+uint16_t probeSequence = 0;
+
+void closeProbe()
+{
+	if (probeSocket >= 0)
+		closesocket(probeSocket);
+	probeSocket = -1;
+}
+
+bool probe()
+{
+	if (probeSocket < 0)
+	{
+		probeSocket = socket(AF_INET, SOCK_RAW, IP_PROTO_ICMP);
+		if (probeSocket < 0)
+			return false;
+
+		static const struct timeval timeout = { 0, PROBE_TIMEOUT * 1000 };
+		setsockopt(probeSocket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	}
+
 	icmp_echo_hdr icmp_request = {};
 
 	ICMPH_TYPE_SET(&icmp_request, ICMP_ECHO);
 	ICMPH_CODE_SET(&icmp_request, 0);
+	icmp_request.seqno = htons(++probeSequence);
 	icmp_request.chksum = inet_chksum((icmp_echo_hdr*)&icmp_request, sizeof(icmp_request));
 
 	struct sockaddr_in to_address;
@@ -54,57 +259,168 @@ bool ping()
 	to_address.sin_family = AF_INET;
 	to_address.sin_addr.s_addr = gateway;
 
-	bool ok = false;
+	if (sendto(probeSocket, &icmp_request, sizeof(icmp_request), 0, (struct sockaddr*)&to_address, sizeof(to_address)) != sizeof(icmp_request))
+	{
+		closeProbe();
+		return false;
+	}
 
-	int sock = socket(AF_INET, SOCK_RAW, IP_PROTO_ICMP);
-	if (sock != -1)
+	// replies to earlier probes which came too late are skipped
+	uint32_t start = millis();
+	while (millis() - start < PROBE_TIMEOUT)
 	{
-		static const struct timeval timeout = { 2, 0 };
-		if (!setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)))
-		{
-			if (sendto(sock, &icmp_request, sizeof(icmp_request), 0, (struct sockaddr*)&to_address, sizeof(to_address)) == sizeof(icmp_request))
-			{
-				// do not check response itself, it doesn't really matter what it is, any response confirms the WiFi is still online
-				char response[64];
-				ok = (recv(sock, response, sizeof(response), 0) > 0);
-			}
-		}
+		uint8_t response[64];
+		int size = recv(probeSocket, response, sizeof(response), 0);
+		if (size <= 0)
+			break;
 
-		closesocket(sock);
+		size_t header_size = (response[0] & 0x0F) * 4;
+		if (size_t(size) < header_size + sizeof(icmp_echo_hdr))
+			continue;
+
+		auto icmp_reply = (icmp_echo_hdr*)&response[header_size];
+		if (ICMPH_TYPE(icmp_reply) == ICMP_ER && icmp_reply->seqno == icmp_request.seqno)
+			return true;
 	}
 
-	return ok;
+	return false;
+}
+
+void getWifiStats(WifiStats& copy)
+{
+	if (xSemaphoreTake(statsMutex, portMAX_DELAY))
+	{
+		copy = stats;
+		xSemaphoreGive(statsMutex);
+	}
 }
 
 void checkTask(void*)
 {
-	size_t ping_misses = 0;
-	size_t reconnects_fails = 0;
+	bool connected = false;
+	uint32_t lost_time = millis();
+	uint32_t next_probe = 0;
+	size_t probe_misses = 0;
+	bool wifi_restarted = false;
 
 	for (;;)
 	{
-		if (ping())
+		uint32_t now = millis();
+		TickType_t wait = connected ? std::max<int32_t>(0, next_probe - now) : PROBE_RETRY_INTERVAL;
+
+		WifiEvent event;
+		if (xQueueReceive(eventQueue, &event, wait))
 		{
-			ping_misses = 0;
-			reconnects_fails = 0;
+			now = millis();
+
+			if (event.id == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+			{
+				bootMark(BOOT_WIFI_IP);
+				storeCache();
+				fastConnecting = false;
 
-			// postpone next check by 10s
-			vTaskDelay(10000);
+				connected = true;
+				probe_misses = 0;
+				wifi_restarted = false;
+				next_probe = now;
+
+				updateStats([&](WifiStats& s)
+				{
+					s.connected = true;
+					s.lastReconnectTime = now - lost_time;
+					s.maxReconnectTime = std::max(s.maxReconnectTime, s.lastReconnectTime);
+				});
+
+				Serial.println("Wi-Fi connected");
+				for (auto& callback : connectedCallbacks)
+					callback();
+			}
+			else if (event.id == ARDUINO_EVENT_WIFI_STA_DISCONNECTED || event.id == ARDUINO_EVENT_WIFI_STA_LOST_IP)
+			{
+				if (connected)
+					lost_time = now;
+				connected = false;
+				closeProbe();
+
+				updateStats([&](WifiStats& s)
+				{
+					s.connected = false;
+					if (event.id == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+					{
+						s.disconnects++;
+						s.lastReason = event.reason;
+						if (event.reason == REASON_BEACON_TIMEOUT)
+							s.beaconLosses++;
+					}
+				});
+			}
+
+			continue;
 		}
-		else
+
+		now = millis();
+
+		if (connected)
 		{
-			if (++ping_misses == 10)
+			bool ok = probe();
+			int rssi = WiFi.RSSI();
+
+			updateStats([&](WifiStats& s)
 			{
-				ping_misses = 0;
+				if (!ok)
+					s.probeMisses++;
 
-				if (++reconnects_fails == 3)
-					ESP.restart();
-				else
-					WiFi.reconnect();
-			}
+				// short and long term averages of the signal, their difference is the trend
+				if (!s.rssiAverage)
+					s.rssiAverage = rssi;
+				float short_average = s.rssiAverage + s.rssiTrend;
+				short_average += (rssi - short_average) / 2;
+				s.rssiAverage += (rssi - s.rssiAverage) / 16;
+				s.rssiTrend = short_average - s.rssiAverage;
+				s.rssi = rssi;
+			});
 
-			// postpone next check by 1s
-			vTaskDelay(1000);
+			if (ok)
+			{
+				probe_misses = 0;
+				next_probe = now + PROBE_INTERVAL;
+			}
+			else if (++probe_misses == PROBE_MISSES)
+			{
+				// station is associated, but the network doesn't work
+				Serial.println("Wi-Fi link lost, reconnecting");
+				connected = false;
+				lost_time = now;
+				closeProbe();
+				updateStats([](WifiStats& s) { s.connected = false; s.escalations++; });
+				WiFi.reconnect();
+			}
+			else
+			{
+				next_probe = now + PROBE_RETRY_INTERVAL;
+			}
+		}
+		else if (fastConnecting && now - lost_time >= FAST_CONNECT_TIMEOUT)
+		{
+			// cached access point is not available anymore
+			Serial.println("Wi-Fi fast connect failed, scanning");
+			invalidateCache();
+			WiFi.disconnect();
+			connect();
+		}
+		else if (now - lost_time >= ESCALATION_RESTART_ESP)
+		{
+			Serial.println("Wi-Fi not restored, restarting");
+			ESP.restart();
+		}
+		else if (now - lost_time >= ESCALATION_RESTART_WIFI && !wifi_restarted)
+		{
+			Serial.println("Wi-Fi not restored, restarting Wi-Fi");
+			wifi_restarted = true;
+			updateStats([](WifiStats& s) { s.escalations++; });
+			invalidateCache();
+			WiFi.disconnect();
+			connect();
 		}
 	}
 
@@ -131,21 +447,36 @@ void signalTask(void*)
 void wifiInit()
 {
 	pinMode(signalLED, OUTPUT);
-	xTaskCreate(signalTask, "wifi_signalTask", 4096, NULL, 1, &signalTaskHandle);
+	createTask(signalTask, signalTaskBuffer, NULL, &signalTaskHandle);
+
+	statsMutex = createMutex(statsMutexBuffer);
+	eventQueue = createQueue(eventQueueBuffer);
+
+	// events are only passed to the supervision task, handlers run in the event task of the stack
+	WiFi.onEvent([](arduino_event_id_t id, arduino_event_info_t info)
+	{
+		WifiEvent event = { id, 0 };
+		if (id == ARDUINO_EVENT_WIFI_STA_CONNECTED)
+			bootMark(BOOT_WIFI_ASSOCIATED);
+		if (id == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+			event.reason = info.wifi_sta_disconnected.reason;
+		if (id == ARDUINO_EVENT_WIFI_STA_GOT_IP || id == ARDUINO_EVENT_WIFI_STA_LOST_IP || id == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+			xQueueSend(eventQueue, &event, 0);
+	});
 
 	WiFi.persistent(false);
 	WiFi.mode(WIFI_STA);
 	WiFi.config(ip, gateway, subnet, dns);
 	WiFi.hostname("Nice-T4-WebAccess");
-	WiFi.begin(wifiSSID, wifiPassword);
 	WiFi.setAutoReconnect(true);
+	loadPowerProfile();
+	connect();
 
-	xTaskCreate(checkTask, "wifi_checkTask", 4096, NULL, 1, &checkTaskHandle);
+	// connection is established in background, services started meanwhile work as soon as it's up
+	createTask(checkTask, checkTaskBuffer, NULL, &checkTaskHandle);
+}
 
-	while (WiFi.status() != WL_CONNECTED)
-	{
-		Serial.print(".");
-		delay(500);
-	}
-	Serial.println("Wi-Fi connected");
+void wifiOnConnected(WifiCallback callback)
+{
+	connectedCallbacks.push_back(callback);
 }
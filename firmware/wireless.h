@@ -17,6 +17,57 @@
 #ifndef WIRELESS_H
 #define WIRELESS_H
 
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+
+struct WifiStats
+{
+	bool connected;
+	int rssi;
+	float rssiAverage;
+	float rssiTrend;			// difference of short and long term average, negative when the signal gets weaker
+	uint32_t disconnects;
+	uint32_t beaconLosses;
+	uint8_t lastReason;			// reason of the last disconnection (wifi_err_reason_t)
+	uint32_t probeMisses;
+	uint32_t lastReconnectTime;	// time without connection (in milliseconds)
+	uint32_t maxReconnectTime;
+	uint32_t escalations;		// reconnects and restarts of Wi-Fi forced by the supervision
+	uint32_t fastConnects;		// connections to the cached access point and channel
+	uint32_t scans;				// connections with full scan
+};
+
+enum WifiPowerSave : uint8_t
+{
+	POWER_SAVE_NONE,
+	POWER_SAVE_MIN_MODEM,		// radio wakes up for every DTIM beacon
+	POWER_SAVE_MAX_MODEM,		// radio wakes up every listenInterval beacons
+	POWER_SAVE_MODES
+};
+
+struct WifiPowerProfile
+{
+	WifiPowerSave mode;
+	uint8_t listenInterval;		// in beacon intervals, used by POWER_SAVE_MAX_MODEM only
+};
+
+typedef std::function<void()> WifiCallback;
+
 void wifiInit();
 
+// callback is called from Wi-Fi task whenever the station gets IP address, it must be registered before wifiInit()
+void wifiOnConnected(WifiCallback callback);
+void getWifiStats(WifiStats& stats);
+
+// profile is applied immediately (change of listen interval forces reconnect) and stored in NVS
+bool setWifiPowerProfile(const WifiPowerProfile& profile);
+WifiPowerProfile getWifiPowerProfile();
+bool isValidWifiPowerProfile(const WifiPowerProfile& profile);
+const char* getWifiPowerSaveString(WifiPowerSave mode);
+bool parseWifiPowerSave(const String& string, WifiPowerSave& mode);
+
+// rough estimate of average current of the module (in mA) with idle link, real draw depends on traffic and DTIM period of the AP
+float estimateWifiCurrent(const WifiPowerProfile& profile);
+
 #endif
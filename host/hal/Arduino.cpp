@@ -0,0 +1,199 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+
+#include <chrono>
+#include <memory>
+#include <poll.h>
+#include <random>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+
+HardwareSerial Serial(STDIN_FILENO, STDOUT_FILENO);
+HardwareSerial Serial2;
+EspClass ESP;
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+unsigned long millis()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+unsigned long micros()
+{
+	// wraps around like on the module, where unsigned long has 32 bits
+	return (uint32_t)esp_timer_get_time();
+}
+
+void delay(unsigned long ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+int64_t esp_timer_get_time()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+uint32_t esp_random()
+{
+	static std::random_device device;
+	return device();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+}
+
+int digitalRead(uint8_t pin)
+{
+	return LOW;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+	size_t written = 0;
+	while (size-- && write(*buffer++))
+		written++;
+	return written;
+}
+
+size_t Print::printf(const char* format, ...)
+{
+	char buffer[256];
+
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	if (size < 0)
+		return 0;
+	if (size < (int)sizeof(buffer))
+		return write(buffer, size);
+
+	std::unique_ptr<char[]> text(new char[size + 1]);
+	va_start(args, format);
+	vsnprintf(text.get(), size + 1, format, args);
+	va_end(args);
+	return write(text.get(), size);
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t size)
+{
+	size_t count = 0;
+	unsigned long start = millis();
+	while (count < size)
+	{
+		int c = read();
+		if (c >= 0)
+		{
+			buffer[count++] = c;
+			continue;
+		}
+
+		if (millis() - start >= m_timeout)
+			break;
+		delay(1);
+	}
+
+	return count;
+}
+
+int HardwareSerial::available()
+{
+	int size = 0;
+	if (m_readFd < 0 || ioctl(m_readFd, FIONREAD, &size) < 0)
+		return 0;
+	return size;
+}
+
+int HardwareSerial::read()
+{
+	uint8_t c;
+	if (!available() || ::read(m_readFd, &c, 1) != 1)
+		return -1;
+	return c;
+}
+
+size_t HardwareSerial::readBytes(uint8_t* buffer, size_t size)
+{
+	// the descriptor is polled, so a waiting task sleeps in the kernel instead of spinning
+	size_t count = 0;
+	unsigned long start = millis();
+	while (count < size && m_readFd >= 0)
+	{
+		unsigned long elapsed = millis() - start;
+		if (elapsed >= m_timeout)
+			break;
+
+		struct pollfd fd = { m_readFd, POLLIN, 0 };
+		int ready = poll(&fd, 1, m_timeout - elapsed);
+		if (ready < 0)
+			break;
+		if (!ready)
+			continue;
+
+		// hang-up of the other side of a pty is reported until somebody opens it again
+		if (!(fd.revents & POLLIN))
+		{
+			delay(10);
+			continue;
+		}
+
+		ssize_t received = ::read(m_readFd, buffer + count, size - count);
+		if (received > 0)
+			count += received;
+		else
+			delay(10);
+	}
+
+	return count;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+	size_t written = 0;
+	while (written < size && m_writeFd >= 0)
+	{
+		ssize_t result = ::write(m_writeFd, buffer + written, size - written);
+		if (result <= 0)
+			break;
+		written += result;
+	}
+
+	return written;
+}
+
+String IPAddress::toString() const
+{
+	char text[16];
+	snprintf(text, sizeof(text), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+	return String(text);
+}
+
+void EspClass::restart()
+{
+	fprintf(stderr, "restart\n");
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,176 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Arduino core of the host build, enough of it to compile the bus client and the web API on Linux
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "WString.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define PROGMEM
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define DEC 10
+#define HEX 16
+
+#define SERIAL_8N1 0x800001c
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+int64_t esp_timer_get_time();
+uint32_t esp_random();
+
+// there are no pins on the host
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+class Print
+{
+public:
+	virtual ~Print() = default;
+
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	size_t write(const char* string) { return string ? write((const uint8_t*)string, strlen(string)) : 0; }
+	size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+	size_t print(const char* string) { return write(string); }
+	size_t print(const String& string) { return write(string.c_str(), string.length()); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(long value, int base = DEC) { return print(String(value, base)); }
+	size_t print(int value, int base = DEC) { return print(String(value, base)); }
+	size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+	size_t print(unsigned int value, int base = DEC) { return print(String(value, base)); }
+	size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+
+	template <typename T> size_t println(const T& value) { return print(value) + println(); }
+	size_t println() { return write("\r\n"); }
+
+	size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+public:
+	virtual int available() = 0;
+	virtual int read() = 0;
+
+	void setTimeout(unsigned long timeout) { m_timeout = timeout; }
+	unsigned long getTimeout() const { return m_timeout; }
+
+	// waits for the data at most the timeout, returns number of bytes read
+	virtual size_t readBytes(uint8_t* buffer, size_t size);
+	size_t readBytes(char* buffer, size_t size) { return readBytes((uint8_t*)buffer, size); }
+
+protected:
+	unsigned long m_timeout = 1000;
+};
+
+// serial port backed by file descriptors, usually master side of a pty, or a pipe, FIFO or real tty
+class HardwareSerial : public Stream
+{
+public:
+	HardwareSerial(int readFd = -1, int writeFd = -1) : m_readFd(readFd), m_writeFd(writeFd) {}
+
+	void attach(int readFd, int writeFd) { m_readFd = readFd; m_writeFd = writeFd; }
+
+	// line settings are up to the other side of the descriptors
+	void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1) {}
+	void end() {}
+
+	int available() override;
+	int read() override;
+	size_t readBytes(uint8_t* buffer, size_t size) override;
+	using Stream::readBytes;
+
+	size_t write(uint8_t c) override { return write(&c, 1); }
+	size_t write(const uint8_t* buffer, size_t size) override;
+	size_t write(unsigned long n) { return write((uint8_t)n); }
+	size_t write(long n) { return write((uint8_t)n); }
+	size_t write(unsigned int n) { return write((uint8_t)n); }
+	size_t write(int n) { return write((uint8_t)n); }
+	using Print::write;
+
+	void flush() {}
+
+private:
+	int m_readFd;
+	int m_writeFd;
+};
+
+// Serial is the console (stdin and stdout), Serial2 the bus, attached by the host program
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+class IPAddress
+{
+public:
+	IPAddress() : m_address(0) {}
+	IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : m_address(a | (b << 8) | (c << 16) | ((uint32_t)d << 24)) {}
+	IPAddress(uint32_t address) : m_address(address) {}
+
+	operator uint32_t() const { return m_address; }
+	uint8_t operator[](int index) const { return m_address >> (index * 8); }
+	bool operator==(const IPAddress& address) const { return m_address == address.m_address; }
+
+	String toString() const;
+
+private:
+	// in network order, like lwIP keeps it
+	uint32_t m_address;
+};
+
+class EspClass
+{
+public:
+	// there's no restart on the host, the process exits, so it can be restarted by the caller
+	[[noreturn]] void restart();
+
+	// heap of the host isn't limited, so there's nothing meaningful to report
+	uint32_t getFreeHeap() { return 0; }
+	uint32_t getMinFreeHeap() { return 0; }
+	uint32_t getMaxAllocHeap() { return 0; }
+	uint32_t getHeapSize() { return 0; }
+};
+
+extern EspClass ESP;
+
+#endif
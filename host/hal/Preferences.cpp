@@ -0,0 +1,123 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Preferences.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// namespace and key to the stored bytes
+static std::map<std::string, std::vector<uint8_t>> storage;
+static std::mutex storageMutex;
+
+static std::string storageKey(const String& name, const char* key)
+{
+	return std::string(name.c_str()) + '/' + key;
+}
+
+bool Preferences::begin(const char* name, bool readOnly)
+{
+	m_name = name;
+	m_readOnly = readOnly;
+	m_started = true;
+	return true;
+}
+
+void Preferences::end()
+{
+	m_started = false;
+}
+
+bool Preferences::isKey(const char* key)
+{
+	std::lock_guard<std::mutex> lock(storageMutex);
+	return m_started && storage.count(storageKey(m_name, key));
+}
+
+bool Preferences::remove(const char* key)
+{
+	std::lock_guard<std::mutex> lock(storageMutex);
+	return m_started && !m_readOnly && storage.erase(storageKey(m_name, key));
+}
+
+size_t Preferences::getBytesLength(const char* key)
+{
+	std::lock_guard<std::mutex> lock(storageMutex);
+	auto value = storage.find(storageKey(m_name, key));
+	return (m_started && value != storage.end()) ? value->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t size)
+{
+	std::lock_guard<std::mutex> lock(storageMutex);
+	auto value = storage.find(storageKey(m_name, key));
+	if (!m_started || value == storage.end() || value->second.size() > size)
+		return 0;
+
+	memcpy(buffer, value->second.data(), value->second.size());
+	return value->second.size();
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t size)
+{
+	if (!m_started || m_readOnly)
+		return 0;
+
+	std::lock_guard<std::mutex> lock(storageMutex);
+	storage[storageKey(m_name, key)].assign((const uint8_t*)value, (const uint8_t*)value + size);
+	return size;
+}
+
+uint8_t Preferences::getUChar(const char* key, uint8_t defaultValue)
+{
+	uint8_t value;
+	return (getBytes(key, &value, sizeof(value)) == sizeof(value)) ? value : defaultValue;
+}
+
+size_t Preferences::putUChar(const char* key, uint8_t value)
+{
+	return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char* key, uint32_t defaultValue)
+{
+	uint32_t value;
+	return (getBytes(key, &value, sizeof(value)) == sizeof(value)) ? value : defaultValue;
+}
+
+size_t Preferences::putUInt(const char* key, uint32_t value)
+{
+	return putBytes(key, &value, sizeof(value));
+}
+
+String Preferences::getString(const char* key, const String& defaultValue)
+{
+	size_t size = getBytesLength(key);
+	if (!size)
+		return defaultValue;
+
+	std::vector<char> value(size);
+	getBytes(key, value.data(), size);
+	return String(value.data());
+}
+
+size_t Preferences::putString(const char* key, const char* value)
+{
+	// stored with the terminator, as NVS does
+	return putBytes(key, value, strlen(value) + 1);
+}
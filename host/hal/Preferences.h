@@ -0,0 +1,50 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+// NVS of the host build, kept in memory of the process, so everything stored is lost with its exit
+
+#include "Arduino.h"
+
+class Preferences
+{
+public:
+	bool begin(const char* name, bool readOnly = false);
+	void end();
+
+	bool isKey(const char* key);
+	bool remove(const char* key);
+
+	size_t getBytesLength(const char* key);
+	size_t getBytes(const char* key, void* buffer, size_t size);
+	size_t putBytes(const char* key, const void* value, size_t size);
+
+	uint8_t getUChar(const char* key, uint8_t defaultValue = 0);
+	size_t putUChar(const char* key, uint8_t value);
+	uint32_t getUInt(const char* key, uint32_t defaultValue = 0);
+	size_t putUInt(const char* key, uint32_t value);
+	String getString(const char* key, const String& defaultValue = String());
+	size_t putString(const char* key, const char* value);
+
+private:
+	String m_name;
+	bool m_started = false;
+	bool m_readOnly = false;
+};
+
+#endif
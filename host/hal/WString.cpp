@@ -0,0 +1,158 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "WString.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <strings.h>
+
+static std::string toString(unsigned long long value, bool negative, unsigned char base)
+{
+	if (base < 2 || base > 36)
+		base = 10;
+
+	std::string string;
+	do
+	{
+		string += "0123456789abcdefghijklmnopqrstuvwxyz"[value % base];
+		value /= base;
+	}
+	while (value);
+
+	if (negative)
+		string += '-';
+
+	std::reverse(string.begin(), string.end());
+	return string;
+}
+
+static std::string toString(long long value, unsigned char base)
+{
+	// only decimal numbers are signed, like in Arduino
+	if (base == 10 && value < 0)
+		return toString(0ULL - (unsigned long long)value, true, base);
+
+	return toString((unsigned long long)value, false, base);
+}
+
+static std::string toString(double value, unsigned int decimals)
+{
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+	return buffer;
+}
+
+String::String(unsigned char value, unsigned char base) : m_string(toString((unsigned long long)value, false, base)) {}
+String::String(int value, unsigned char base) : m_string(toString((long long)value, base)) {}
+String::String(unsigned int value, unsigned char base) : m_string(toString((unsigned long long)value, false, base)) {}
+String::String(long value, unsigned char base) : m_string(toString((long long)value, base)) {}
+String::String(unsigned long value, unsigned char base) : m_string(toString((unsigned long long)value, false, base)) {}
+String::String(long long value, unsigned char base) : m_string(toString(value, base)) {}
+String::String(unsigned long long value, unsigned char base) : m_string(toString(value, false, base)) {}
+String::String(float value, unsigned int decimals) : m_string(toString((double)value, decimals)) {}
+String::String(double value, unsigned int decimals) : m_string(toString(value, decimals)) {}
+
+long String::toInt() const
+{
+	return strtol(m_string.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const
+{
+	return strtof(m_string.c_str(), nullptr);
+}
+
+bool String::equalsIgnoreCase(const String& string) const
+{
+	return m_string.size() == string.m_string.size() && !strcasecmp(m_string.c_str(), string.m_string.c_str());
+}
+
+bool String::startsWith(const String& prefix) const
+{
+	return m_string.compare(0, prefix.m_string.size(), prefix.m_string) == 0;
+}
+
+bool String::endsWith(const String& suffix) const
+{
+	return m_string.size() >= suffix.m_string.size() && m_string.compare(m_string.size() - suffix.m_string.size(), suffix.m_string.size(), suffix.m_string) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const
+{
+	auto index = m_string.find(c, from);
+	return index != std::string::npos ? (int)index : -1;
+}
+
+int String::indexOf(const String& string, unsigned int from) const
+{
+	auto index = m_string.find(string.m_string, from);
+	return index != std::string::npos ? (int)index : -1;
+}
+
+int String::lastIndexOf(char c) const
+{
+	auto index = m_string.rfind(c);
+	return index != std::string::npos ? (int)index : -1;
+}
+
+String String::substring(unsigned int from) const
+{
+	return substring(from, m_string.size());
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+	if (from > to)
+		std::swap(from, to);
+	if (from >= m_string.size())
+		return String();
+
+	return String(m_string.substr(from, std::min<size_t>(to, m_string.size()) - from));
+}
+
+void String::remove(unsigned int index)
+{
+	if (index < m_string.size())
+		m_string.erase(index);
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+	if (index < m_string.size())
+		m_string.erase(index, count);
+}
+
+void String::trim()
+{
+	auto space = [](unsigned char c) { return isspace(c); };
+	m_string.erase(std::find_if_not(m_string.rbegin(), m_string.rend(), space).base(), m_string.end());
+	m_string.erase(m_string.begin(), std::find_if_not(m_string.begin(), m_string.end(), space));
+}
+
+void String::toLowerCase()
+{
+	for (auto& c : m_string)
+		c = tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+	for (auto& c : m_string)
+		c = toupper((unsigned char)c);
+}
@@ -0,0 +1,94 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <cstddef>
+#include <string>
+
+// Arduino String of the host build, only the part used by the firmware
+class String
+{
+public:
+	String(const char* string = "") : m_string(string ? string : "") {}
+	String(const char* string, unsigned int length) : m_string(string, length) {}
+	String(const std::string& string) : m_string(string) {}
+	explicit String(char c) : m_string(1, c) {}
+	explicit String(unsigned char value, unsigned char base = 10);
+	explicit String(int value, unsigned char base = 10);
+	explicit String(unsigned int value, unsigned char base = 10);
+	explicit String(long value, unsigned char base = 10);
+	explicit String(unsigned long value, unsigned char base = 10);
+	explicit String(long long value, unsigned char base = 10);
+	explicit String(unsigned long long value, unsigned char base = 10);
+	explicit String(float value, unsigned int decimals = 2);
+	explicit String(double value, unsigned int decimals = 2);
+
+	String& operator+=(const String& string) { m_string += string.m_string; return *this; }
+	String& operator+=(const char* string) { m_string += string; return *this; }
+	String& operator+=(char c) { m_string += c; return *this; }
+	template<typename T> String& operator+=(T value) { return *this += String(value); }
+
+	friend String operator+(const String& a, const String& b) { return String(a.m_string + b.m_string); }
+	friend String operator+(const String& a, const char* b) { return String(a.m_string + b); }
+	friend String operator+(const char* a, const String& b) { return String(a + b.m_string); }
+	friend String operator+(const String& a, char b) { return String(a.m_string + b); }
+
+	bool operator==(const String& string) const { return m_string == string.m_string; }
+	bool operator==(const char* string) const { return m_string == string; }
+	bool operator!=(const String& string) const { return m_string != string.m_string; }
+	bool operator!=(const char* string) const { return m_string != string; }
+	bool operator<(const String& string) const { return m_string < string.m_string; }
+
+	char operator[](unsigned int index) const { return index < m_string.size() ? m_string[index] : 0; }
+	char& operator[](unsigned int index) { return m_string[index]; }
+
+	const char* c_str() const { return m_string.c_str(); }
+	unsigned int length() const { return m_string.size(); }
+	bool isEmpty() const { return m_string.empty(); }
+	void reserve(unsigned int size) { m_string.reserve(size); }
+
+	char* begin() { return m_string.data(); }
+	char* end() { return m_string.data() + m_string.size(); }
+	const char* begin() const { return m_string.data(); }
+	const char* end() const { return m_string.data() + m_string.size(); }
+
+	long toInt() const;
+	float toFloat() const;
+
+	bool equals(const String& string) const { return m_string == string.m_string; }
+	bool equalsIgnoreCase(const String& string) const;
+	bool startsWith(const String& prefix) const;
+	bool endsWith(const String& suffix) const;
+
+	int indexOf(char c, unsigned int from = 0) const;
+	int indexOf(const String& string, unsigned int from = 0) const;
+	int lastIndexOf(char c) const;
+	String substring(unsigned int from) const;
+	String substring(unsigned int from, unsigned int to) const;
+
+	void remove(unsigned int index);
+	void remove(unsigned int index, unsigned int count);
+	void trim();
+	void toLowerCase();
+	void toUpperCase();
+
+private:
+	std::string m_string;
+};
+
+#endif
@@ -0,0 +1,36 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef WIFI_H
+#define WIFI_H
+
+// station of the host build, the network of the host is always up and the API is reached over loopback
+
+#include "Arduino.h"
+
+class WiFiClass
+{
+public:
+	bool isConnected() { return true; }
+	int RSSI() { return 0; }
+	IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+	// clients on the same /24 as the gateway need no authentication, so this makes local clients of the host trusted
+	IPAddress gatewayIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
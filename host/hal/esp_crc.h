@@ -0,0 +1,37 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ESP_CRC_H
+#define ESP_CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+// same as the ROM function, CRC-32 compatible with zlib when started with 0
+inline uint32_t esp_crc32_le(uint32_t crc, const uint8_t* buffer, uint32_t size)
+{
+	crc = ~crc;
+	while (size--)
+	{
+		crc ^= *buffer++;
+		for (int n = 0; n < 8; ++n)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+
+	return ~crc;
+}
+
+#endif
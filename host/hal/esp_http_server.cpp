@@ -0,0 +1,492 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "esp_http_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <string>
+#include <strings.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// requests with longer head are refused
+const size_t MaxHeadSize = 16384;
+
+struct HalHttpServer
+{
+	httpd_config_t config;
+	int socket;
+
+	std::mutex mutex;
+	std::vector<httpd_uri_t> handlers;
+};
+
+struct HalHttpConnection
+{
+	HalHttpServer* server;
+	int socket;
+
+	// received data not processed yet
+	std::string buffer;
+
+	std::string uri;
+	std::vector<std::pair<std::string, std::string>> headers;
+	size_t bodyRemaining;
+	bool keepAlive;
+
+	std::string status;
+	std::string type;
+	std::vector<std::pair<std::string, std::string>> responseHeaders;
+	bool headersSent;
+
+	// copies of the request held by asynchronous handlers
+	std::mutex mutex;
+	std::condition_variable completed;
+	int pending = 0;
+};
+
+static HalHttpConnection* connectionOf(httpd_req_t* req)
+{
+	return (HalHttpConnection*)req->aux;
+}
+
+static bool sendAll(int socket, const char* data, size_t size)
+{
+	while (size)
+	{
+		ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+		if (sent <= 0)
+			return false;
+
+		data += sent;
+		size -= sent;
+	}
+
+	return true;
+}
+
+static bool sendHead(HalHttpConnection* connection, bool chunked, size_t size)
+{
+	std::string head = "HTTP/1.1 " + connection->status + "\r\nContent-Type: " + connection->type + "\r\n";
+	for (auto& header : connection->responseHeaders)
+		head += header.first + ": " + header.second + "\r\n";
+
+	if (chunked)
+		head += "Transfer-Encoding: chunked\r\n";
+	else
+		head += "Content-Length: " + std::to_string(size) + "\r\n";
+
+	if (!connection->keepAlive)
+		head += "Connection: close\r\n";
+
+	head += "\r\n";
+	connection->headersSent = true;
+	return sendAll(connection->socket, head.data(), head.size());
+}
+
+static const char* findHeader(HalHttpConnection* connection, const char* field)
+{
+	for (auto& header : connection->headers)
+		if (!strcasecmp(header.first.c_str(), field))
+			return header.second.c_str();
+	return nullptr;
+}
+
+static esp_err_t copyValue(const char* value, char* buffer, size_t size)
+{
+	if (!size)
+		return ESP_ERR_INVALID_ARG;
+
+	size_t length = strlen(value);
+	size_t copied = std::min(length, size - 1);
+	memcpy(buffer, value, copied);
+	buffer[copied] = 0;
+	return copied < length ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+// reads the head of the next request to the connection, false when the connection should be closed
+static bool readHead(HalHttpConnection* connection, std::string& method)
+{
+	size_t end;
+	while ((end = connection->buffer.find("\r\n\r\n")) == std::string::npos)
+	{
+		if (connection->buffer.size() > MaxHeadSize)
+			return false;
+
+		char data[1024];
+		ssize_t received = recv(connection->socket, data, sizeof(data), 0);
+		if (received <= 0)
+			return false;
+
+		connection->buffer.append(data, received);
+	}
+
+	std::string head = connection->buffer.substr(0, end + 2);
+	connection->buffer.erase(0, end + 4);
+
+	size_t lineEnd = head.find("\r\n");
+	std::string line = head.substr(0, lineEnd);
+	size_t space1 = line.find(' ');
+	size_t space2 = line.rfind(' ');
+	if (space1 == std::string::npos || space2 <= space1)
+		return false;
+
+	method = line.substr(0, space1);
+	connection->uri = line.substr(space1 + 1, space2 - space1 - 1);
+	std::string version = line.substr(space2 + 1);
+
+	connection->headers.clear();
+	for (size_t start = lineEnd + 2; start < head.size();)
+	{
+		size_t next = head.find("\r\n", start);
+		std::string header = head.substr(start, next - start);
+		start = next + 2;
+
+		size_t colon = header.find(':');
+		if (colon == std::string::npos)
+			continue;
+
+		size_t value = header.find_first_not_of(" \t", colon + 1);
+		connection->headers.emplace_back(header.substr(0, colon), value != std::string::npos ? header.substr(value) : "");
+	}
+
+	auto length = findHeader(connection, "Content-Length");
+	connection->bodyRemaining = length ? strtoul(length, nullptr, 10) : 0;
+
+	auto keepAlive = findHeader(connection, "Connection");
+	if (version == "HTTP/1.1")
+		connection->keepAlive = !keepAlive || strcasecmp(keepAlive, "close");
+	else
+		connection->keepAlive = keepAlive && !strcasecmp(keepAlive, "keep-alive");
+
+	connection->status = "200 OK";
+	connection->type = "text/html";
+	connection->responseHeaders.clear();
+	connection->headersSent = false;
+	return true;
+}
+
+static int parseMethod(const std::string& method)
+{
+	static const char* const methods[] = { "DELETE", "GET", "HEAD", "POST", "PUT" };
+	for (size_t n = 0; n < sizeof(methods) / sizeof(methods[0]); ++n)
+		if (method == methods[n])
+			return n;
+	return -1;
+}
+
+static void connectionThread(HalHttpServer* server, int socket)
+{
+	pthread_setname_np(pthread_self(), "httpd_conn");
+
+	struct timeval timeout = { server->config.recv_wait_timeout, 0 };
+	setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	// headers and chunks are sent separately, Nagle and delayed ACK of the client would add 40 ms to each response
+	int enable = 1;
+	setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+	auto connection = std::make_unique<HalHttpConnection>();
+	connection->server = server;
+	connection->socket = socket;
+
+	std::string method;
+	while (readHead(connection.get(), method))
+	{
+		httpd_uri_t handler = {};
+		int methodId = parseMethod(method);
+		size_t pathSize = connection->uri.find('?');
+		if (pathSize == std::string::npos)
+			pathSize = connection->uri.size();
+
+		{
+			std::lock_guard<std::mutex> lock(server->mutex);
+			for (auto& uri : server->handlers)
+			{
+				if (uri.method != methodId)
+					continue;
+
+				bool match = server->config.uri_match_fn
+					? server->config.uri_match_fn(uri.uri, connection->uri.c_str(), pathSize)
+					: strlen(uri.uri) == pathSize && !strncmp(uri.uri, connection->uri.c_str(), pathSize);
+				if (match)
+				{
+					handler = uri;
+					break;
+				}
+			}
+		}
+
+		std::unique_ptr<httpd_req_t> req(new httpd_req_t{ server, methodId, {}, connection->bodyRemaining, connection.get(), handler.user_ctx });
+		strncpy((char*)req->uri, connection->uri.c_str(), HTTPD_MAX_URI_LEN);
+
+		esp_err_t result = ESP_FAIL;
+		if (handler.handler && connection->uri.size() <= HTTPD_MAX_URI_LEN)
+		{
+			result = handler.handler(req.get());
+		}
+		else
+		{
+			connection->status = "404 Not Found";
+			connection->type = "text/plain";
+			result = httpd_resp_send(req.get(), "Not found", HTTPD_RESP_USE_STRLEN);
+		}
+
+		{
+			std::unique_lock<std::mutex> lock(connection->mutex);
+			connection->completed.wait(lock, [&]() { return connection->pending == 0; });
+		}
+
+		if (result != ESP_OK || !connection->keepAlive)
+			break;
+
+		// unread rest of the body is skipped
+		char data[1024];
+		while (connection->bodyRemaining)
+			if (httpd_req_recv(req.get(), data, sizeof(data)) <= 0)
+				break;
+		if (connection->bodyRemaining)
+			break;
+	}
+
+	close(socket);
+}
+
+static void acceptThread(HalHttpServer* server)
+{
+	pthread_setname_np(pthread_self(), "httpd");
+
+	// every connection gets its own thread, limit of open sockets isn't enforced
+	for (;;)
+	{
+		int socket = accept(server->socket, nullptr, nullptr);
+		if (socket < 0)
+			break;
+
+		std::thread(connectionThread, server, socket).detach();
+	}
+}
+
+bool httpd_uri_match_wildcard(const char* uriTemplate, const char* uri, size_t size)
+{
+	// "/path/*" matches anything under "/path/", "/path/?" also matches "/path", "/path/?*" matches both
+	size_t exact = strlen(uriTemplate);
+	bool asterisk = exact && uriTemplate[exact - 1] == '*';
+	if (asterisk)
+		exact--;
+	bool optional = exact && uriTemplate[exact - 1] == '?';
+	if (optional)
+		exact--;
+
+	if (size >= exact && !strncmp(uriTemplate, uri, exact))
+		return asterisk || size == exact;
+
+	return optional && exact && size == exact - 1 && !strncmp(uriTemplate, uri, size);
+}
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config)
+{
+	int socket = ::socket(AF_INET6, SOCK_STREAM, 0);
+	if (socket < 0)
+		return ESP_FAIL;
+
+	int enable = 1;
+	int disable = 0;
+	setsockopt(socket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+	setsockopt(socket, IPPROTO_IPV6, IPV6_V6ONLY, &disable, sizeof(disable));
+
+	struct sockaddr_in6 address = {};
+	address.sin6_family = AF_INET6;
+	address.sin6_addr = in6addr_any;
+	address.sin6_port = htons(config->server_port);
+	if (bind(socket, (struct sockaddr*)&address, sizeof(address)) || listen(socket, config->backlog_conn))
+	{
+		close(socket);
+		return ESP_FAIL;
+	}
+
+	auto server = new HalHttpServer;
+	server->config = *config;
+	server->socket = socket;
+	std::thread(acceptThread, server).detach();
+
+	*handle = server;
+	return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+	// the accept thread ends with the socket, the server itself stays allocated for the connections still open
+	auto server = (HalHttpServer*)handle;
+	shutdown(server->socket, SHUT_RDWR);
+	close(server->socket);
+	return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri)
+{
+	auto server = (HalHttpServer*)handle;
+	std::lock_guard<std::mutex> lock(server->mutex);
+	if (server->handlers.size() >= server->config.max_uri_handlers)
+		return ESP_ERR_NO_MEM;
+
+	server->handlers.push_back(*uri);
+	return ESP_OK;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t* req)
+{
+	auto query = strchr(req->uri, '?');
+	return query ? strlen(query + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buffer, size_t size)
+{
+	auto query = strchr(req->uri, '?');
+	if (!query)
+		return ESP_ERR_NOT_FOUND;
+
+	return copyValue(query + 1, buffer, size);
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t* req, const char* field)
+{
+	auto value = findHeader(connectionOf(req), field);
+	return value ? strlen(value) : 0;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* req, const char* field, char* buffer, size_t size)
+{
+	auto value = findHeader(connectionOf(req), field);
+	if (!value)
+		return ESP_ERR_NOT_FOUND;
+
+	return copyValue(value, buffer, size);
+}
+
+int httpd_req_recv(httpd_req_t* req, char* buffer, size_t size)
+{
+	auto connection = connectionOf(req);
+	size = std::min(size, connection->bodyRemaining);
+	if (!size)
+		return 0;
+
+	if (!connection->buffer.empty())
+	{
+		size = std::min(size, connection->buffer.size());
+		memcpy(buffer, connection->buffer.data(), size);
+		connection->buffer.erase(0, size);
+		connection->bodyRemaining -= size;
+		return size;
+	}
+
+	ssize_t received = recv(connection->socket, buffer, size, 0);
+	if (received < 0)
+		return errno == EAGAIN || errno == EWOULDBLOCK ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+	if (!received)
+		return HTTPD_SOCK_ERR_FAIL;
+
+	connection->bodyRemaining -= received;
+	return received;
+}
+
+int httpd_req_to_sockfd(httpd_req_t* req)
+{
+	return connectionOf(req)->socket;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status)
+{
+	connectionOf(req)->status = status;
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type)
+{
+	connectionOf(req)->type = type;
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value)
+{
+	auto connection = connectionOf(req);
+	if (connection->responseHeaders.size() >= connection->server->config.max_resp_headers)
+		return ESP_ERR_HTTPD_RESP_HDR;
+
+	connection->responseHeaders.emplace_back(field, value);
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buffer, ssize_t size)
+{
+	auto connection = connectionOf(req);
+	if (size == HTTPD_RESP_USE_STRLEN)
+		size = buffer ? strlen(buffer) : 0;
+
+	if (!sendHead(connection, false, size) || !sendAll(connection->socket, buffer, size))
+		return ESP_ERR_HTTPD_RESP_SEND;
+	return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buffer, ssize_t size)
+{
+	auto connection = connectionOf(req);
+	if (size == HTTPD_RESP_USE_STRLEN)
+		size = buffer ? strlen(buffer) : 0;
+
+	if (!connection->headersSent && !sendHead(connection, true, 0))
+		return ESP_ERR_HTTPD_RESP_SEND;
+
+	char prefix[16];
+	int prefixSize = snprintf(prefix, sizeof(prefix), "%zx\r\n", (size_t)size);
+	if (!sendAll(connection->socket, prefix, prefixSize) || (size && !sendAll(connection->socket, buffer, size)) || !sendAll(connection->socket, "\r\n", 2))
+		return ESP_ERR_HTTPD_RESP_SEND;
+	return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t* req, httpd_req_t** copy)
+{
+	auto connection = connectionOf(req);
+	{
+		std::lock_guard<std::mutex> lock(connection->mutex);
+		connection->pending++;
+	}
+
+	*copy = new httpd_req_t(*req);
+	return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t* req)
+{
+	auto connection = connectionOf(req);
+	delete req;
+
+	std::lock_guard<std::mutex> lock(connection->mutex);
+	connection->pending--;
+	connection->completed.notify_all();
+	return ESP_OK;
+}
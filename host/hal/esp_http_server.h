@@ -0,0 +1,132 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef ESP_HTTP_SERVER_H
+#define ESP_HTTP_SERVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+// esp_http_server of the host build, HTTP/1.1 server on POSIX sockets with a thread per connection
+// only the functions used by HttpServer are provided
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_HTTPD_BASE 0xb000
+#define ESP_ERR_HTTPD_RESULT_TRUNC (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESP_HDR (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_SEND (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_INVALID_REQ (ESP_ERR_HTTPD_BASE + 6)
+#define ESP_ERR_HTTPD_TASK (ESP_ERR_HTTPD_BASE + 8)
+
+#define HTTPD_SOCK_ERR_FAIL -1
+#define HTTPD_SOCK_ERR_INVALID -2
+#define HTTPD_SOCK_ERR_TIMEOUT -3
+
+#define HTTPD_MAX_URI_LEN 512
+#define HTTPD_RESP_USE_STRLEN -1
+
+// values of http_parser, like in IDF
+enum http_method
+{
+	HTTP_DELETE = 0,
+	HTTP_GET = 1,
+	HTTP_HEAD = 2,
+	HTTP_POST = 3,
+	HTTP_PUT = 4
+};
+
+typedef enum http_method httpd_method_t;
+typedef void* httpd_handle_t;
+
+struct httpd_req
+{
+	httpd_handle_t handle;
+	int method;
+	const char uri[HTTPD_MAX_URI_LEN + 1];
+	size_t content_len;
+	void* aux;
+	void* user_ctx;
+	void* sess_ctx;
+	void* free_ctx;
+	bool ignore_sess_ctx_changes;
+};
+
+typedef struct httpd_req httpd_req_t;
+
+typedef bool (*httpd_uri_match_func_t)(const char* uriTemplate, const char* uri, size_t size);
+
+struct httpd_uri
+{
+	const char* uri;
+	httpd_method_t method;
+	esp_err_t (*handler)(httpd_req_t* req);
+	void* user_ctx;
+};
+
+typedef struct httpd_uri httpd_uri_t;
+
+struct httpd_config
+{
+	unsigned task_priority;
+	size_t stack_size;
+	int core_id;
+	uint16_t server_port;
+	uint16_t ctrl_port;
+	uint16_t max_open_sockets;
+	uint16_t max_uri_handlers;
+	uint16_t max_resp_headers;
+	uint16_t backlog_conn;
+	bool lru_purge_enable;
+	uint16_t recv_wait_timeout;
+	uint16_t send_wait_timeout;
+	httpd_uri_match_func_t uri_match_fn;
+};
+
+typedef struct httpd_config httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() httpd_config_t{ 5, 4096, 0x7FFFFFFF, 80, 32768, 7, 8, 8, 5, false, 5, 5, nullptr }
+
+bool httpd_uri_match_wildcard(const char* uriTemplate, const char* uri, size_t size);
+
+esp_err_t httpd_start(httpd_handle_t* handle, const httpd_config_t* config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri);
+
+size_t httpd_req_get_url_query_len(httpd_req_t* req);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t* req, char* buffer, size_t size);
+size_t httpd_req_get_hdr_value_len(httpd_req_t* req, const char* field);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t* req, const char* field, char* buffer, size_t size);
+int httpd_req_recv(httpd_req_t* req, char* buffer, size_t size);
+int httpd_req_to_sockfd(httpd_req_t* req);
+
+esp_err_t httpd_resp_set_status(httpd_req_t* req, const char* status);
+esp_err_t httpd_resp_set_type(httpd_req_t* req, const char* type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t* req, const char* field, const char* value);
+esp_err_t httpd_resp_send(httpd_req_t* req, const char* buffer, ssize_t size);
+esp_err_t httpd_resp_send_chunk(httpd_req_t* req, const char* buffer, ssize_t size);
+
+// the connection isn't read until the copy of the request is completed
+esp_err_t httpd_req_async_handler_begin(httpd_req_t* req, httpd_req_t** copy);
+esp_err_t httpd_req_async_handler_complete(httpd_req_t* req);
+
+#endif
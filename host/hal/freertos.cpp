@@ -0,0 +1,348 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "freertos/FreeRTOS.h"
+
+#include <chrono>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct HalTask
+{
+	std::string name;
+	uint32_t stackSize;
+	UBaseType_t priority;
+	BaseType_t core;
+};
+
+struct HalQueue
+{
+	std::mutex mutex;
+	std::condition_variable changed;
+
+	// ring of items copied in and out, like FreeRTOS does
+	std::vector<uint8_t> storage;
+	size_t itemSize;
+	size_t length;
+	size_t head = 0;
+	size_t count = 0;
+};
+
+struct HalSemaphore
+{
+	std::mutex mutex;
+	std::condition_variable changed;
+	UBaseType_t count;
+	UBaseType_t maxCount;
+};
+
+struct HalEventGroup
+{
+	std::mutex mutex;
+	std::condition_variable changed;
+	EventBits_t bits = 0;
+};
+
+// setup() of the sketch runs in the main thread, like it runs in loopTask on the module
+static HalTask mainTask = { "loopTask", 8192, 1, APP_CPU_NUM };
+static thread_local HalTask* currentTask = &mainTask;
+
+static const auto startTime = std::chrono::steady_clock::now();
+
+template <typename Predicate>
+static bool wait(std::condition_variable& changed, std::unique_lock<std::mutex>& lock, TickType_t timeout, Predicate predicate)
+{
+	if (timeout == portMAX_DELAY)
+	{
+		changed.wait(lock, predicate);
+		return true;
+	}
+
+	return changed.wait_for(lock, std::chrono::milliseconds(timeout), predicate);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackSize, void* parameter, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core)
+{
+	// tasks run on threads with the default stack, the firmware stack sizes are too small for sanitized builds;
+	// handles stay valid after the task ends, so the task registry may still read them
+	auto task = new HalTask{ name, stackSize, priority, core };
+
+	std::thread([task, function, parameter]()
+	{
+		currentTask = task;
+		pthread_setname_np(pthread_self(), task->name.substr(0, 15).c_str());
+		function(parameter);
+	}).detach();
+
+	if (handle)
+		*handle = task;
+	return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackSize, void* parameter, UBaseType_t priority, TaskHandle_t* handle)
+{
+	return xTaskCreatePinnedToCore(function, name, stackSize, parameter, priority, handle, tskNO_AFFINITY);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char* name, uint32_t stackSize, void* parameter, UBaseType_t priority, StackType_t* stack, StaticTask_t* buffer, BaseType_t core)
+{
+	TaskHandle_t task = nullptr;
+	xTaskCreatePinnedToCore(function, name, stackSize, parameter, priority, &task, core);
+	return task;
+}
+
+TaskHandle_t xTaskCreateStatic(TaskFunction_t function, const char* name, uint32_t stackSize, void* parameter, UBaseType_t priority, StackType_t* stack, StaticTask_t* buffer)
+{
+	return xTaskCreateStaticPinnedToCore(function, name, stackSize, parameter, priority, stack, buffer, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	if (!task || task == currentTask)
+		pthread_exit(nullptr);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	if (ticks)
+		std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+	else
+		std::this_thread::yield();
+}
+
+TickType_t xTaskGetTickCount()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+	return currentTask;
+}
+
+const char* pcTaskGetName(TaskHandle_t task)
+{
+	return (task ? task : currentTask)->name.c_str();
+}
+
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task)
+{
+	return (task ? task : currentTask)->priority;
+}
+
+BaseType_t xTaskGetAffinity(TaskHandle_t task)
+{
+	return (task ? task : currentTask)->core;
+}
+
+BaseType_t xPortGetCoreID()
+{
+	return currentTask->core != tskNO_AFFINITY ? currentTask->core : PRO_CPU_NUM;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+	return (task ? task : currentTask)->stackSize;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+	auto queue = new HalQueue;
+	queue->storage.resize(length * itemSize);
+	queue->itemSize = itemSize;
+	queue->length = length;
+	return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* storage, StaticQueue_t* buffer)
+{
+	return xQueueCreate(length, itemSize);
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void* item, TickType_t timeout, bool front)
+{
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	if (!wait(queue->changed, lock, timeout, [queue]() { return queue->count < queue->length; }))
+		return errQUEUE_FULL;
+
+	size_t slot;
+	if (front)
+		slot = queue->head = (queue->head + queue->length - 1) % queue->length;
+	else
+		slot = (queue->head + queue->count) % queue->length;
+
+	memcpy(&queue->storage[slot * queue->itemSize], item, queue->itemSize);
+	queue->count++;
+
+	queue->changed.notify_all();
+	return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t timeout)
+{
+	return queueSend(queue, item, timeout, false);
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void* item, TickType_t timeout)
+{
+	return queueSend(queue, item, timeout, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t timeout)
+{
+	return queueSend(queue, item, timeout, true);
+}
+
+static BaseType_t queueReceive(QueueHandle_t queue, void* item, TickType_t timeout, bool remove)
+{
+	std::unique_lock<std::mutex> lock(queue->mutex);
+	if (!wait(queue->changed, lock, timeout, [queue]() { return queue->count > 0; }))
+		return errQUEUE_EMPTY;
+
+	memcpy(item, &queue->storage[queue->head * queue->itemSize], queue->itemSize);
+	if (remove)
+	{
+		queue->head = (queue->head + 1) % queue->length;
+		queue->count--;
+		queue->changed.notify_all();
+	}
+
+	return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t timeout)
+{
+	return queueReceive(queue, item, timeout, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t timeout)
+{
+	return queueReceive(queue, item, timeout, false);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue)
+{
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	return queue->length - queue->count;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+	std::lock_guard<std::mutex> lock(queue->mutex);
+	queue->head = 0;
+	queue->count = 0;
+	queue->changed.notify_all();
+	return pdPASS;
+}
+
+// mutexes are semaphores created given, ownership and priority inheritance aren't emulated
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+	return new HalSemaphore{ {}, {}, 1, 1 };
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buffer)
+{
+	return xSemaphoreCreateMutex();
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+	return new HalSemaphore{ {}, {}, 0, 1 };
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* buffer)
+{
+	return xSemaphoreCreateBinary();
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout)
+{
+	std::unique_lock<std::mutex> lock(semaphore->mutex);
+	if (!wait(semaphore->changed, lock, timeout, [semaphore]() { return semaphore->count > 0; }))
+		return pdFALSE;
+
+	semaphore->count--;
+	return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore)
+{
+	std::lock_guard<std::mutex> lock(semaphore->mutex);
+	if (semaphore->count >= semaphore->maxCount)
+		return pdFALSE;
+
+	semaphore->count++;
+	semaphore->changed.notify_one();
+	return pdTRUE;
+}
+
+EventGroupHandle_t xEventGroupCreate()
+{
+	return new HalEventGroup;
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t* buffer)
+{
+	return xEventGroupCreate();
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+	std::lock_guard<std::mutex> lock(group->mutex);
+	group->bits |= bits;
+	group->changed.notify_all();
+	return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+	std::lock_guard<std::mutex> lock(group->mutex);
+	EventBits_t previous = group->bits;
+	group->bits &= ~bits;
+	return previous;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+	std::lock_guard<std::mutex> lock(group->mutex);
+	return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit, BaseType_t waitForAll, TickType_t timeout)
+{
+	std::unique_lock<std::mutex> lock(group->mutex);
+	auto satisfied = [group, bits, waitForAll]() { return waitForAll ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+	if (!wait(group->changed, lock, timeout, satisfied))
+		return group->bits;
+
+	// bits are returned as they were before clearing
+	EventBits_t result = group->bits;
+	if (clearOnExit)
+		group->bits &= ~bits;
+	return result;
+}
@@ -0,0 +1,154 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mbedtls/md.h"
+#include "mbedtls/sha256.h"
+
+#include <cstring>
+
+// FIPS 180-4, fast enough for the password hashing and signing of session tokens
+
+static const uint32_t K[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+struct Sha256
+{
+	uint32_t state[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+	uint8_t block[64];
+	size_t blockSize = 0;
+	uint64_t total = 0;
+
+	static uint32_t rotate(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+	void transform()
+	{
+		uint32_t w[64];
+		for (int n = 0; n < 16; ++n)
+			w[n] = (uint32_t(block[n * 4]) << 24) | (block[n * 4 + 1] << 16) | (block[n * 4 + 2] << 8) | block[n * 4 + 3];
+		for (int n = 16; n < 64; ++n)
+		{
+			uint32_t s0 = rotate(w[n - 15], 7) ^ rotate(w[n - 15], 18) ^ (w[n - 15] >> 3);
+			uint32_t s1 = rotate(w[n - 2], 17) ^ rotate(w[n - 2], 19) ^ (w[n - 2] >> 10);
+			w[n] = w[n - 16] + s0 + w[n - 7] + s1;
+		}
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4], f = state[5], g = state[6], h = state[7];
+		for (int n = 0; n < 64; ++n)
+		{
+			uint32_t t1 = h + (rotate(e, 6) ^ rotate(e, 11) ^ rotate(e, 25)) + ((e & f) ^ (~e & g)) + K[n] + w[n];
+			uint32_t t2 = (rotate(a, 2) ^ rotate(a, 13) ^ rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+	}
+
+	void update(const uint8_t* data, size_t size)
+	{
+		total += size;
+		while (size--)
+		{
+			block[blockSize++] = *data++;
+			if (blockSize == sizeof(block))
+			{
+				transform();
+				blockSize = 0;
+			}
+		}
+	}
+
+	void finish(uint8_t* output)
+	{
+		uint64_t bits = total * 8;
+		uint8_t padding = 0x80;
+		update(&padding, 1);
+		padding = 0;
+		while (blockSize != 56)
+			update(&padding, 1);
+		for (int n = 7; n >= 0; --n)
+		{
+			uint8_t byte = bits >> (n * 8);
+			update(&byte, 1);
+		}
+
+		for (int n = 0; n < 8; ++n)
+		{
+			output[n * 4] = state[n] >> 24;
+			output[n * 4 + 1] = state[n] >> 16;
+			output[n * 4 + 2] = state[n] >> 8;
+			output[n * 4 + 3] = state[n];
+		}
+	}
+};
+
+int mbedtls_sha256(const unsigned char* input, size_t size, unsigned char* output, int is224)
+{
+	if (is224)
+		return -1;
+
+	Sha256 sha;
+	sha.update(input, size);
+	sha.finish(output);
+	return 0;
+}
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type)
+{
+	static const mbedtls_md_info_t sha256 = { MBEDTLS_MD_SHA256 };
+	return (type == MBEDTLS_MD_SHA256) ? &sha256 : nullptr;
+}
+
+int mbedtls_md_hmac(const mbedtls_md_info_t* info, const unsigned char* key, size_t keySize, const unsigned char* input, size_t size, unsigned char* output)
+{
+	if (!info || info->type != MBEDTLS_MD_SHA256)
+		return -1;
+
+	// RFC 2104, keys longer than the block are hashed first
+	uint8_t block[64] = {};
+	if (keySize > sizeof(block))
+		mbedtls_sha256(key, keySize, block, 0);
+	else
+		memcpy(block, key, keySize);
+
+	uint8_t pad[64];
+	uint8_t inner[32];
+
+	Sha256 sha;
+	for (size_t n = 0; n < sizeof(pad); ++n)
+		pad[n] = block[n] ^ 0x36;
+	sha.update(pad, sizeof(pad));
+	sha.update(input, size);
+	sha.finish(inner);
+
+	Sha256 outer;
+	for (size_t n = 0; n < sizeof(pad); ++n)
+		pad[n] = block[n] ^ 0x5C;
+	outer.update(pad, sizeof(pad));
+	outer.update(inner, sizeof(inner));
+	outer.finish(output);
+	return 0;
+}
@@ -0,0 +1,74 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MBEDTLS_BASE64_H
+#define MBEDTLS_BASE64_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+#define MBEDTLS_ERR_BASE64_INVALID_CHARACTER -0x002C
+
+// decoder of the host build, mbedTLS isn't needed for anything else
+inline int mbedtls_base64_decode(unsigned char* destination, size_t size, size_t* length, const unsigned char* source, size_t sourceSize)
+{
+	auto value = [](unsigned char c) -> int
+	{
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A';
+		if (c >= 'a' && c <= 'z')
+			return c - 'a' + 26;
+		if (c >= '0' && c <= '9')
+			return c - '0' + 52;
+		if (c == '+')
+			return 62;
+		if (c == '/')
+			return 63;
+		return -1;
+	};
+
+	while (sourceSize && source[sourceSize - 1] == '=')
+		sourceSize--;
+
+	size_t required = sourceSize * 3 / 4;
+	*length = required;
+	if (size < required || !destination)
+		return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+
+	uint32_t bits = 0;
+	int count = 0;
+	size_t written = 0;
+	for (size_t n = 0; n < sourceSize; ++n)
+	{
+		int v = value(source[n]);
+		if (v < 0)
+			return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+
+		bits = (bits << 6) | v;
+		count += 6;
+		if (count >= 8)
+		{
+			count -= 8;
+			destination[written++] = bits >> count;
+		}
+	}
+
+	*length = written;
+	return 0;
+}
+
+#endif
@@ -0,0 +1,38 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef MBEDTLS_MD_H
+#define MBEDTLS_MD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// HMAC of the host build, SHA-256 is the only digest
+typedef enum
+{
+	MBEDTLS_MD_NONE = 0,
+	MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+struct mbedtls_md_info_t
+{
+	mbedtls_md_type_t type;
+};
+
+const mbedtls_md_info_t* mbedtls_md_info_from_type(mbedtls_md_type_t type);
+int mbedtls_md_hmac(const mbedtls_md_info_t* info, const unsigned char* key, size_t keySize, const unsigned char* input, size_t size, unsigned char* output);
+
+#endif
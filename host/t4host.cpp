@@ -0,0 +1,146 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// host build of the firmware: bus client on a pty (or any other serial device), the web interface with the JSON API on
+// a local port and the TCP bridge
+
+#include <Arduino.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "t4.h"
+#include "analyzer.h"
+#include "recorder.h"
+#include "bridge.h"
+#include "watchdog.h"
+#include "web.h"
+
+T4Client t4(Serial2);
+T4Analyzer analyzer;
+T4Recorder recorder(t4);
+T4Bridge bridge(t4);
+T4Watchdog watchdog(t4);
+
+class T4Printer : public T4Subscriber
+{
+public:
+	void onPacket(const T4Packet& packet) override
+	{
+		Serial.printf("%10lu ", (unsigned long)packet.received);
+		for (size_t n = 0; n < packet.size; ++n)
+			Serial.printf(" %02X", packet.data[n]);
+		Serial.println();
+	}
+};
+
+T4Printer printer;
+
+// opens the master side of a new pty, the firmware gets the bus on it, the slave is for the simulator or a recording
+int openPty()
+{
+	int fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0 || grantpt(fd) || unlockpt(fd))
+		return -1;
+
+	struct termios tio;
+	if (!tcgetattr(fd, &tio))
+	{
+		cfmakeraw(&tio);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+
+	fprintf(stderr, "bus: %s\n", ptsname(fd));
+	return fd;
+}
+
+int openDevice(const char* path)
+{
+	int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0)
+	{
+		perror(path);
+		return -1;
+	}
+
+	struct termios tio;
+	if (!tcgetattr(fd, &tio))
+	{
+		cfmakeraw(&tio);
+		cfsetspeed(&tio, B19200);
+		tcsetattr(fd, TCSANOW, &tio);
+	}
+
+	return fd;
+}
+
+int main(int argc, char** argv)
+{
+	const char* device = nullptr;
+	uint16_t port = 8080;
+	uint16_t bridge_port = 5091;
+	bool print = false;
+
+	int option;
+	while ((option = getopt(argc, argv, "d:p:b:v")) != -1)
+	{
+		switch (option)
+		{
+		case 'd':
+			device = optarg;
+			break;
+		case 'p':
+			port = atoi(optarg);
+			break;
+		case 'b':
+			bridge_port = atoi(optarg);
+			break;
+		case 'v':
+			print = true;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d device] [-p port] [-b bridge port] [-v]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// lwIP reports a closed peer by the error of send() only, the same is expected here
+	signal(SIGPIPE, SIG_IGN);
+
+	int fd = device ? openDevice(device) : openPty();
+	if (fd < 0)
+		return EXIT_FAILURE;
+	Serial2.attach(fd, fd);
+
+	analyzer.init();
+
+	t4.setAnalyzer(&analyzer);
+	t4.init();
+	if (print)
+		t4.subscribe("printer", printer);
+
+	recorder.init();
+	bridge.init(bridge_port);
+	watchdog.init();
+
+	webServerInit(port);
+	fprintf(stderr, "web: http://localhost:%u%s\n", port, basePath.c_str());
+
+	for (;;)
+		pause();
+}
@@ -0,0 +1,54 @@
+/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <WiFi.h>
+
+#include "wireless.h"
+
+// Wi-Fi layer of the host build, there's no radio, the network of the host is always up
+
+WiFiClass WiFi;
+
+WifiPowerProfile powerProfile = { POWER_SAVE_NONE, 1 };
+
+void wifiInit()
+{
+}
+
+void wifiOnConnected(WifiCallback callback)
+{
+	callback();
+}
+
+void getWifiStats(WifiStats& stats)
+{
+	stats = {};
+	stats.connected = true;
+}
+
+bool setWifiPowerProfile(const WifiPowerProfile& profile)
+{
+	if (!isValidWifiPowerProfile(profile))
+		return false;
+
+	powerProfile = profile;
+	return true;
+}
+
+WifiPowerProfile getWifiPowerProfile()
+{
+	return powerProfile;
+}
@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+#
+#   https://github.com/gashtaan/nice-bidiwifi-firmware
+#
+#   Copyright (C) 2024, Michal Kovacik
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License version 3, as
+#   published by the Free Software Foundation.
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Generates firmware/assets.h with gzipped static files from assets directory,
+# run it after any change of the assets.
+
+import gzip
+import hashlib
+import os
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+ASSETS = os.path.join(ROOT, 'assets')
+OUTPUT = os.path.join(ROOT, 'firmware', 'assets.h')
+
+CONTENT_TYPES = {
+	'.css': 'text/css',
+	'.js': 'application/javascript',
+}
+
+HEADER = '''/*
+   https://github.com/gashtaan/nice-bidiwifi-firmware
+
+   Copyright (C) 2024, Michal Kovacik
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License version 3, as
+   published by the Free Software Foundation.
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// generated by tools/assets.py, do not edit
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <Arduino.h>
+
+struct WebAsset
+{
+	const char* path;
+	const char* contentType;
+	const char* etag;
+	const uint8_t* data;
+	size_t size;
+};
+'''
+
+def main():
+	assets = []
+	out = HEADER
+
+	for name in sorted(os.listdir(ASSETS)):
+		with open(os.path.join(ASSETS, name), 'rb') as f:
+			content = f.read()
+
+		ident = 'asset_' + name.replace('.', '_').replace('-', '_')
+		data = gzip.compress(content, 9, mtime=0)
+		etag = hashlib.sha1(content).hexdigest()[:8]
+		content_type = CONTENT_TYPES[os.path.splitext(name)[1]]
+
+		out += '\n// %s (%d bytes, %d bytes gzipped)\n' % (name, len(content), len(data))
+		out += 'const uint8_t %s[] PROGMEM =\n{\n' % ident
+		for n in range(0, len(data), 16):
+			out += '\t' + ', '.join('0x%02X' % b for b in data[n:n + 16]) + ',\n'
+		out += '};\n'
+
+		assets.append('\t{ "%s", "%s", "%s", %s, sizeof(%s) },\n' % (name, content_type, etag, ident, ident))
+
+	out += '\nconst WebAsset WebAssets[] =\n{\n' + ''.join(assets) + '};\n\n#endif\n'
+
+	with open(OUTPUT, 'w') as f:
+		f.write(out)
+
+if __name__ == '__main__':
+	main()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+#
+#   https://github.com/gashtaan/nice-bidiwifi-firmware
+#
+#   Copyright (C) 2024, Michal Kovacik
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License version 3, as
+#   published by the Free Software Foundation.
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Measures throughput and latency of the web server with concurrent clients.
+#
+#   tools/bench.py 192.168.1.10 --clients 8 --requests 50 /api/v1/status /analyzer
+#
+# With --profiles, each Wi-Fi power save profile is switched on in turn and UDP echo and HTTP round-trip times are measured
+# with single client, the estimated current is reported by the module.
+#
+#   tools/bench.py 192.168.1.10 --profiles none,min-modem,max-modem --listen-interval 3
+#
+# With --jitter, the frame handling latency of the bus is reset before the load and reported after it, paths touching
+# the bus (like /api/v1/status) make sure there are frames to measure.
+#
+#   tools/bench.py 192.168.1.10 --jitter --clients 8 --requests 100 /api/v1/status /perf
+
+import argparse
+import http.client
+import json
+import socket
+import struct
+import threading
+import time
+
+def client(host, port, paths, count, latencies, errors, auth):
+	connection = http.client.HTTPConnection(host, port, timeout=30)
+	headers = { 'Authorization': auth } if auth else {}
+
+	for n in range(count):
+		path = paths[n % len(paths)]
+		start = time.monotonic()
+		try:
+			connection.request('GET', path, headers=headers)
+			response = connection.getresponse()
+			response.read()
+			if response.status != 200:
+				errors.append(response.status)
+		except Exception as e:
+			errors.append(str(e))
+			connection.close()
+			connection = http.client.HTTPConnection(host, port, timeout=30)
+			continue
+		latencies.append(time.monotonic() - start)
+
+	connection.close()
+
+def percentiles(latencies):
+	latencies.sort()
+	percentile = lambda p: latencies[min(len(latencies) - 1, int(len(latencies) * p / 100))] * 1000
+	return percentile(50), percentile(99), latencies[-1] * 1000
+
+def udp_echo(host, port, count):
+	udp = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+	udp.settimeout(1)
+	latencies = []
+	lost = 0
+
+	for sequence in range(count):
+		datagram = b'T4' + struct.pack('<BBI', 0x08, 0, sequence)
+		start = time.monotonic()
+		udp.sendto(datagram, (host, port))
+		try:
+			# replies to earlier datagrams which came too late are skipped
+			while udp.recv(64) != datagram:
+				pass
+			latencies.append(time.monotonic() - start)
+		except socket.timeout:
+			lost += 1
+		# echoes are limited to 5 per second by the module
+		time.sleep(0.2)
+
+	udp.close()
+	return latencies, lost
+
+def api(host, port, auth, method, path):
+	connection = http.client.HTTPConnection(host, port, timeout=30)
+	headers = { 'Authorization': auth } if auth else {}
+	connection.request(method, path, headers=headers)
+	response = connection.getresponse()
+	body = response.read()
+	connection.close()
+	if response.status != 200:
+		raise RuntimeError('%s %s failed: %d %s' % (method, path, response.status, body))
+	return json.loads(body)
+
+def set_profile(host, port, auth, mode, listen_interval):
+	return api(host, port, auth, 'PUT', '/api/v1/wifi?powerSave=%s&listenInterval=%d' % (mode, listen_interval))
+
+def profiles(args):
+	print('%-10s %8s %8s %8s %6s %8s %8s %8s %8s' % ('profile', 'current', 'udp p50', 'udp p99', 'lost', 'http p50', 'http p99', 'http max', 'failed'))
+
+	for mode in args.profiles.split(','):
+		profile = set_profile(args.host, args.port, args.auth, mode, args.listen_interval)
+		# change of listen interval makes the module reconnect
+		time.sleep(args.settle)
+
+		udp_latencies, lost = udp_echo(args.host, args.udp_port, args.requests)
+		http_latencies = []
+		errors = []
+		client(args.host, args.port, args.paths, args.requests, http_latencies, errors, args.auth)
+
+		udp = percentiles(udp_latencies) if udp_latencies else (0, 0, 0)
+		http = percentiles(http_latencies) if http_latencies else (0, 0, 0)
+		print('%-10s %5.0f mA %5.0f ms %5.0f ms %6d %5.0f ms %5.0f ms %5.0f ms %8d' % (mode, profile['current'], udp[0], udp[1], lost, http[0], http[1], http[2], len(errors)))
+
+def main():
+	parser = argparse.ArgumentParser()
+	parser.add_argument('host')
+	parser.add_argument('paths', nargs='*', default=['/'])
+	parser.add_argument('--port', type=int, default=80)
+	parser.add_argument('--clients', type=int, default=8)
+	parser.add_argument('--requests', type=int, default=50, help='requests per client')
+	parser.add_argument('--auth', help='value of Authorization header')
+	parser.add_argument('--profiles', help='comma separated Wi-Fi power save profiles to compare')
+	parser.add_argument('--listen-interval', type=int, default=3, help='listen interval of max-modem profile')
+	parser.add_argument('--udp-port', type=int, default=5090)
+	parser.add_argument('--settle', type=float, default=5, help='seconds to wait after change of the profile')
+	parser.add_argument('--jitter', action='store_true', help='report frame handling latency of the bus under the load')
+	args = parser.parse_args()
+
+	if args.profiles:
+		return profiles(args)
+
+	if args.jitter:
+		api(args.host, args.port, args.auth, 'GET', '/api/v1/latency?reset=1')
+
+	latencies = []
+	errors = []
+	threads = [threading.Thread(target=client, args=(args.host, args.port, args.paths, args.requests, latencies, errors, args.auth)) for _ in range(args.clients)]
+
+	start = time.monotonic()
+	for thread in threads:
+		thread.start()
+	for thread in threads:
+		thread.join()
+	elapsed = time.monotonic() - start
+
+	if not latencies:
+		print('no successful requests, errors: %s' % errors[:10])
+		return
+
+	print('requests: %d ok, %d failed, %.1f s' % (len(latencies), len(errors), elapsed))
+	print('throughput: %.1f requests/s' % (len(latencies) / elapsed))
+	print('latency: p50 %.0f ms, p99 %.0f ms, max %.0f ms' % percentiles(latencies))
+
+	if args.jitter:
+		frames = api(args.host, args.port, args.auth, 'GET', '/api/v1/latency')
+		print('bus frames: %d, handling p50 %.1f ms, p99 %.1f ms, max %.1f ms' % (frames['frames'], frames['latency50'] / 1000, frames['latency99'] / 1000, frames['latencyMax'] / 1000))
+
+if __name__ == '__main__':
+	main()
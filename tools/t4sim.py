@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+#   https://github.com/gashtaan/nice-bidiwifi-firmware
+#
+#   Copyright (C) 2024, Michal Kovacik
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU General Public License version 3, as
+#   published by the Free Software Foundation.
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU General Public License for more details.
+#   You should have received a copy of the GNU General Public License
+#   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Simulates a control unit on the other side of the host build's pty, it answers the scan of the bus client and
+# requests for status and position, so the API can be exercised and benchmarked without a unit.
+#
+#   build/t4host &
+#   tools/t4sim.py /dev/pts/3
+#
+# Time of the request and the reply on the bus at 19200 baud and the reaction time of the unit are added before each
+# reply, so requests are serialized the way they are on a real bus.
+
+import argparse
+import os
+import termios
+import time
+import tty
+
+STANDARD = 0
+CONTROLLER = 4
+DMP = 8
+
+FIN = 0x01
+GET = 0x10
+REQ = 0x80
+
+BYTE_TIME = 10 / 19200
+
+def xor(data):
+	h = 0
+	for byte in data:
+		h ^= byte
+	return h
+
+def packet(to, source, message):
+	header = bytes(to) + bytes(source) + bytes([DMP, len(message) + 1])
+	header += bytes([xor(header)])
+	body = header + bytes(message) + bytes([xor(message)])
+	return bytes([0x00, 0x55, len(body)]) + body + bytes([len(body)])
+
+def frames(fd):
+	# same framing as T4Client::uartTask, yields complete frames without the leading zero and the trailing size
+	while True:
+		if os.read(fd, 1) != b'\x00':
+			continue
+		head = os.read(fd, 2)
+		while len(head) < 2:
+			head += os.read(fd, 2 - len(head))
+		if head[0] != 0x55 or head[1] > 60:
+			continue
+		data = b''
+		while len(data) < head[1] + 1:
+			data += os.read(fd, head[1] + 1 - len(data))
+		if xor(data[:-2]) != data[-2]:
+			continue
+		yield head + data[:-1]
+
+class Unit:
+	def __init__(self, address, endpoint):
+		self.source = (address, endpoint)
+		self.position = 0
+
+	def reply(self, frame):
+		to = (frame[2], frame[3])
+		source = (frame[4], frame[5])
+		device, command, flags = frame[9], frame[10], frame[11]
+
+		if frame[6] != DMP or not (flags & REQ) or to not in (self.source, (0xFF, 0xFF)):
+			return None
+
+		data = self.answer(device, command, flags)
+		if data is None:
+			return None
+
+		# sequence carries the size of info replies and the end of the menu records
+		sequence = data[0]
+		message = [device, command, (flags & GET) | FIN, sequence, 0x00] + data[1:]
+		return packet(source, self.source, message)
+
+	def answer(self, device, command, flags):
+		if device == CONTROLLER and command == 0x00 and flags & GET:
+			# CTRL_AUTOMATION_TYPE
+			return [1, 0x01]
+		if device == CONTROLLER and command == 0x08 and not flags & GET:
+			# info CTRL_STR_COMMANDS, count of the commands at data[4]
+			commands = [0x01, 0x11]
+			data = [0, 0, 0, 0, len(commands)] + commands
+			return [len(data)] + data
+		if device == STANDARD and command == 0x10 and flags & GET:
+			# STD_MENU, root record only
+			return [2, 0x00, 0x00]
+		if device == CONTROLLER and command == 0x01 and flags & GET:
+			# CTRL_AUTOMATION_STATUS: status, flags, last manoeuvre
+			return [3, 0x02, 0x1F, 0x00]
+		if device == CONTROLLER and command == 0x11 and flags & GET:
+			# CTRL_POSITION_CURRENT
+			self.position = (self.position + 1) & 0xFFF
+			return [2, self.position >> 8, self.position & 0xFF]
+		return None
+
+def main():
+	parser = argparse.ArgumentParser()
+	parser.add_argument('device', help='pty printed by the host build')
+	parser.add_argument('--address', type=lambda x: int(x, 0), default=0x03)
+	parser.add_argument('--endpoint', type=lambda x: int(x, 0), default=0x05)
+	parser.add_argument('--reaction', type=float, default=10, help='reaction time of the unit in milliseconds')
+	args = parser.parse_args()
+
+	fd = os.open(args.device, os.O_RDWR | os.O_NOCTTY)
+	tty.setraw(fd, termios.TCSANOW)
+
+	unit = Unit(args.address, args.endpoint)
+	for frame in frames(fd):
+		reply = unit.reply(frame)
+		if reply is None:
+			continue
+		time.sleep(args.reaction / 1000 + (len(frame) + 2 + len(reply)) * BYTE_TIME)
+		os.write(fd, reply)
+
+if __name__ == '__main__':
+	main()